@@ -0,0 +1,49 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEAACCUMULATE_H
+#define XIMEAACCUMULATE_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <ximea_export.h>
+
+#include "XimeaStripeWorkers.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Widening sum of sensor frames into a 32 bit frame of width x height
+		// contiguous pixels: dst = src for the first frame, dst += src after.
+		// src holds unsigned pixels of pixel_size bytes (1, 2 or 4), rows
+		// being src_stride bytes apart. 32 bit sums wrap around.
+		XIMEA_EXPORT void accumulateFrame(uint32_t* dst, const void* src, int pixel_size, int width, int height,
+			size_t src_stride, bool first, StripeWorkers& workers);
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAACCUMULATE_H
@@ -25,6 +25,9 @@
 #ifndef XIMEAACQTHREAD_H
 #define XIMEAACQTHREAD_H
 
+#include <vector>
+#include <deque>
+
 #include <ximea_export.h>
 
 #include "XimeaCamera.h"
@@ -47,12 +50,70 @@ namespace lima
 				virtual void threadFunction();
 			
 			private:
+				// Converts the raw frames of the ring into Lima buffers and
+				// hands them to Lima, in order, off the grab loop
+				class DemosaicThread : public Thread
+				{
+					DEB_CLASS_NAMESPC(DebModCamera, "DemosaicThread", "Ximea");
+
+				public:
+					DemosaicThread(AcqThread& acq);
+					virtual ~DemosaicThread();
+
+					// next ring slot, waits while all are in use; NULL once
+					// Lima refused a frame
+					void* getSlot();
+					// valid is false for failed reads, passed on unconverted
+					void push(const XI_IMG& image, const HwFrameInfoType& frame_info, bool valid);
+					// all pushed frames delivered, thread finished
+					void drain();
+
+				protected:
+					virtual void threadFunction();
+
+				private:
+					struct Job
+					{
+						XI_IMG image;
+						HwFrameInfoType frame_info;
+						bool valid;
+					};
+
+					AcqThread& m_acq;
+					Cond m_cond;
+					std::deque<Job> m_jobs;		// the front one is in progress
+					int m_next_slot;
+					bool m_stop;
+					bool m_done;
+					bool m_failed;
+				};
+
+				// read into m_buffer, false when asked to quit
+				bool _read_frame();
+				void _process_frame(Timestamp& last_frame_time);
+				// a trigger mode read timeout worth an event
+				bool _timeout_overdue(int nb_timeouts);
+				// frames missing between this one and the previous
+				void _check_frame_gap();
+				// fill the ring until the event, then commit it to Lima;
+				// false when the acquisition must stop
+				bool _run_pretrigger(StdBufferCbMgr& buffer_mgr, Timestamp& last_frame_time);
+
 				Camera& m_cam;
 
 				bool m_quit;
 				XI_IMG m_buffer;
 				int m_timeout;
 				bool m_thread_started;
+				bool m_first_frame;
+				unsigned int m_last_nframe;
+				unsigned int m_last_acq_nframe;
+				Timestamp m_sdk_queue_sample_time;
+				std::vector<char> m_ring;
+				std::vector<FrameMetadata> m_ring_metadata;
+				std::vector<char> m_sensor_frame;
+				std::vector<char> m_raw_ring;
+				DemosaicThread m_demosaic_thread;
 		};
 	} // namespace Ximea
 } // namespace lima
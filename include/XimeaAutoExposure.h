@@ -0,0 +1,94 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEAAUTOEXPOSURE_H
+#define XIMEAAUTOEXPOSURE_H
+
+#include <ximea_export.h>
+
+#include "XimeaFrameStats.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Closed-loop exposure/gain controller driven by the per-frame
+		// histogram. The chosen percentile of the histogram is steered to
+		// target_level (fraction of full scale) while the fraction of pixels
+		// in the top histogram bin is kept below max_saturation.
+		// Exposure is adjusted first, gain only once exposure is at a limit.
+		class XIMEA_EXPORT AutoExposure
+		{
+		public:
+			struct Params
+			{
+				double percentile;		// 0..1
+				double target_level;	// 0..1 of full scale
+				double max_saturation;	// 0..1 of pixels
+				double tolerance;		// relative, on target_level
+				double max_step;		// max exposure ratio per update
+				double min_exp_time;	// s
+				double max_exp_time;	// s
+				double max_gain;		// dB
+
+				Params();
+			};
+
+			AutoExposure();
+
+			void setParams(const Params& params);
+			void getParams(Params& params) const { params = this->m_params; }
+
+			// restart convergence measurement
+			void reset();
+
+			// Feed one frame acquired with exp_time/gain. Returns true if
+			// new values must be applied to the camera.
+			bool update(const FrameStats& stats, double exp_time, double gain, double& new_exp_time, double& new_gain);
+
+			// Convergence measurement only, used when the camera AEAG is
+			// driving exposure
+			void track(const FrameStats& stats);
+
+			// number of frames needed to reach the target, -1 if not reached yet
+			int getConvergenceFrames() const { return this->m_convergence_frames; }
+			double getLevel() const { return this->m_level; }
+			double getSaturation() const { return this->m_saturation; }
+
+		private:
+			void _measure(const FrameStats& stats);
+			bool _is_on_target() const;
+
+			Params m_params;
+			int m_nb_frames;
+			int m_convergence_frames;
+			double m_level;
+			double m_saturation;
+			double m_pending_exp_time;
+			int m_pending_frames;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAAUTOEXPOSURE_H
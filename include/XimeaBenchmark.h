@@ -0,0 +1,174 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEABENCHMARK_H
+#define XIMEABENCHMARK_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <random>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/SizeUtils.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Settings one benchmark point is measured at
+		struct XIMEA_EXPORT BenchmarkPoint
+		{
+			int mode;
+			Roi roi;			// inactive for full frame
+			int bit_depth;
+
+			BenchmarkPoint();
+			BenchmarkPoint(int mode, const Roi& roi, int bit_depth);
+		};
+
+		// Measured at minimum exposure with the beam off
+		struct XIMEA_EXPORT BenchmarkResult
+		{
+			BenchmarkPoint point;
+			bool ok;
+			std::string error;		// why the point was not measured
+			int width;
+			int height;
+			double frame_rate;		// frames/s
+			double readout_time;	// s, median frame period less the exposure
+			double dark_mean;		// ADU
+			double dark_noise;		// temporal rms, ADU
+			double dynamic_range;	// dB, full scale above dark over noise
+			double bandwidth;		// MB/s
+			double bandwidth_use;	// fraction of the link
+
+			BenchmarkResult();
+		};
+
+		// Sensor mode characterization: every point is configured in turn,
+		// free run frames are read and summarised, the report is JSON
+		class XIMEA_EXPORT Benchmark
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "Benchmark", "Ximea");
+
+		public:
+			// what the benchmark runs against, the camera or a stand-in
+			class Backend
+			{
+			public:
+				struct Frame
+				{
+					const void* data;
+					int pixel_size;		// bytes, unsigned
+					int width;
+					int height;
+					size_t stride;
+					double timestamp;	// device clock, s
+				};
+
+				virtual ~Backend() {}
+				// everything the device may accept, points it refuses fail
+				// in configure()
+				virtual void getModes(std::vector<int>& modes) = 0;
+				virtual void configure(const BenchmarkPoint& point) = 0;
+				// s, the frame period above it is the readout
+				virtual double getExposureTime() = 0;
+				virtual double getLinkBandwidth() = 0;	// MB/s
+				virtual void start() = 0;
+				// valid until the next call
+				virtual void readFrame(Frame& frame) = 0;
+				virtual void stop() = 0;
+			};
+
+			Benchmark();
+
+			void setNbFrames(int n);
+			int getNbFrames() const { return this->m_nb_frames; }
+
+			// every combination, empty modes meaning all the backend lists
+			// and empty rois full frame
+			static void getPoints(Backend& backend, const std::vector<int>& modes, const std::vector<Roi>& rois,
+				const std::vector<int>& bit_depths, std::vector<BenchmarkPoint>& points);
+
+			// a point that fails is reported in its result, not thrown
+			void run(Backend& backend, const std::vector<BenchmarkPoint>& points);
+			const std::vector<BenchmarkResult>& getResults() const { return this->m_results; }
+			void writeReport(const std::string& path) const;
+
+		private:
+			void _measure(Backend& backend, BenchmarkResult& result);
+
+			int m_nb_frames;
+			std::vector<BenchmarkResult> m_results;
+		};
+
+		// Stand-in sensor: gaussian dark frames timed by a line time model
+		// and the link bandwidth, so that the benchmark runs without a camera
+		class XIMEA_EXPORT SimulatedBenchmarkBackend : public Benchmark::Backend
+		{
+		public:
+			SimulatedBenchmarkBackend(int width, int height, double link_bandwidth = 400);
+
+			// line_time in s, dark offset and noise in ADU at 12 bits
+			void addMode(int mode, double line_time, double dark_offset, double dark_noise);
+
+			virtual void getModes(std::vector<int>& modes);
+			virtual void configure(const BenchmarkPoint& point);
+			virtual double getExposureTime() { return 0; }
+			virtual double getLinkBandwidth() { return this->m_link_bandwidth; }
+			virtual void start();
+			virtual void readFrame(Frame& frame);
+			virtual void stop() {}
+
+		private:
+			double _readout_time() const;
+
+			struct Mode
+			{
+				int mode;
+				double line_time;
+				double dark_offset;
+				double dark_noise;
+			};
+
+			int m_width;
+			int m_height;
+			double m_link_bandwidth;
+			std::vector<Mode> m_modes;
+
+			const Mode* m_mode;
+			Roi m_roi;
+			int m_bit_depth;
+			double m_time;
+			std::vector<char> m_frame;
+			std::mt19937 m_random;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEABENCHMARK_H
@@ -0,0 +1,132 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEABUFFERCTRLOBJ_H
+#define XIMEABUFFERCTRLOBJ_H
+
+#include <cstddef>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/HwBufferMgr.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Frame buffers in one block, optionally on 2 MB pages: explicit
+		// hugepages from the system pool if any, else transparent hugepages,
+		// else normal pages. Frames are 64 byte aligned.
+		class XIMEA_EXPORT MappedBufferAllocMgr : public BufferAllocMgr
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "MappedBufferAllocMgr", "Ximea");
+
+		public:
+			enum Pages { Normal, TransparentHuge, Huge };
+
+			MappedBufferAllocMgr();
+			virtual ~MappedBufferAllocMgr();
+
+			virtual int getMaxNbBuffers(const FrameDim& frame_dim);
+			virtual void allocBuffers(int nb_buffers, const FrameDim& frame_dim);
+			virtual const FrameDim& getFrameDim();
+			virtual void getNbBuffers(int& nb_buffers);
+			virtual void releaseBuffers();
+			virtual void* getBufferPtr(int buffer_nb);
+
+			// used by the next allocation
+			void setHugePages(bool huge_pages) { this->m_huge_pages = huge_pages; }
+			bool getHugePages() const { return this->m_huge_pages; }
+			Pages getPages() const { return this->m_pages; }
+			// NUMA node preferred for the buffers, -1 for the default
+			// policy; buffers already faulted in are moved
+			void setNumaNode(int node);
+			// node holding the first buffer, -1 if none
+			int getBufferNode() const;
+
+			// touch every page once per allocation, false if already done
+			bool prefault();
+			void setLocked(bool locked);
+			bool isLocked() const { return this->m_locked; }
+
+		private:
+			void _alloc(size_t size);
+
+			bool m_huge_pages;
+			bool m_alloc_huge_pages;	// m_huge_pages of the current allocation
+			int m_numa_node;
+			FrameDim m_frame_dim;
+			int m_nb_buffers;
+			size_t m_frame_stride;
+
+			char* m_data;
+			size_t m_size;
+			Pages m_pages;
+			bool m_prefaulted;
+			bool m_locked;
+		};
+
+		// SoftBufferCtrlObj equivalent on MappedBufferAllocMgr
+		class XIMEA_EXPORT BufferCtrlObj : public HwBufferCtrlObj
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "BufferCtrlObj", "Ximea");
+
+		public:
+			BufferCtrlObj();
+			virtual ~BufferCtrlObj();
+
+			virtual void setFrameDim(const FrameDim& frame_dim);
+			virtual void getFrameDim(FrameDim& frame_dim);
+
+			virtual void setNbBuffers(int nb_buffers);
+			virtual void getNbBuffers(int& nb_buffers);
+
+			virtual void setNbConcatFrames(int nb_concat_frames);
+			virtual void getNbConcatFrames(int& nb_concat_frames);
+
+			virtual void getMaxNbBuffers(int& max_nb_buffers);
+
+			virtual void* getBufferPtr(int buffer_nb, int concat_frame_nb = 0);
+			virtual void* getFramePtr(int acq_frame_nb);
+
+			virtual void getStartTimestamp(Timestamp& start_ts);
+			virtual void getFrameInfo(int acq_frame_nb, HwFrameInfoType& info);
+
+			virtual void registerFrameCallback(HwFrameCallback& frame_cb);
+			virtual void unregisterFrameCallback(HwFrameCallback& frame_cb);
+
+			StdBufferCbMgr& getBuffer() { return this->m_buffer_cb_mgr; }
+			MappedBufferAllocMgr& getAllocMgr() { return this->m_alloc_mgr; }
+
+		private:
+			MappedBufferAllocMgr m_alloc_mgr;
+			StdBufferCbMgr m_buffer_cb_mgr;
+			BufferCtrlMgr m_mgr;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEABUFFERCTRLOBJ_H
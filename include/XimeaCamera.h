@@ -27,8 +27,12 @@
 
 #include <limits>
 #include <string>
+#include <vector>
+#include <map>
+#include <set>
 #include <cmath>
 #include <sstream>
+#include <cstring>
 #include <unistd.h>
 
 #include "lima/Debug.h"
@@ -36,6 +40,7 @@
 #include "lima/HwMaxImageSizeCallback.h"
 #include "lima/HwBufferMgr.h"
 #include "lima/Event.h"
+#include "lima/ThreadUtils.h"
 
 #ifdef WIN32
 #	include "xiApi.h"
@@ -49,19 +54,53 @@
 
 // Additional headers
 #include "MagicNumbers.h"
+#include "XimeaFrameStats.h"
+#include "XimeaAutoExposure.h"
+#include "XimeaCorrection.h"
+#include "XimeaAccumulate.h"
+#include "XimeaHdrMerge.h"
+#include "XimeaLiveView.h"
+#include "XimeaFrameRateModel.h"
+#include "XimeaDarkLibrary.h"
+#include "XimeaBenchmark.h"
+#include "XimeaDemosaic.h"
+#include "XimeaFormat.h"
+#include "XimeaStripeWorkers.h"
+#include "XimeaBufferCtrlObj.h"
+#include "XimeaNuma.h"
+#include "XimeaFrameMetadata.h"
+#include "XimeaSensorMonitor.h"
+#include "XimeaEventQueue.h"
+#include "XimeaProfile.h"
+#include "XimeaClockSync.h"
+#include "XimeaTriggerDiag.h"
 
 namespace lima
 {
 	namespace Ximea
 	{
 		class AcqThread;
-		class XIMEA_EXPORT Camera : public EventCallbackGen
+
+		// Device configuration read in one pass, keyed by getter name
+		// without "get" (e.g. "GpiMode")
+		struct XIMEA_EXPORT ParamSnapshot
+		{
+			double timestamp;						// s since epoch
+			double read_time;						// s
+			std::map<std::string, int> ints;		// int, bool and enum parameters
+			std::map<std::string, double> doubles;
+
+			ParamSnapshot();
+		};
+
+		class XIMEA_EXPORT Camera : public EventCallbackGen, public HwMaxImageSizeCallbackGen
 		{
 			DEB_CLASS_NAMESPC(DebModCamera, "Camera", "Ximea");
 
 			friend class Interface;
 			friend class SyncCtrlObj;
 			friend class AcqThread;
+			friend class EventCtrlObj;
 
 		public:
 			static const unsigned int TIMEOUT_MAX = std::numeric_limits<unsigned int>::max();
@@ -239,7 +278,8 @@ namespace lima
 				CounterSelector_Skipped_Frames_API = XI_CNT_SEL_API_SKIPPED_FRAMES,
 				CounterSelector_Missed_Trigger_Overlap = XI_CNT_SEL_FRAME_MISSED_TRIGGER_DUETO_OVERLAP,
 				CounterSelector_Missed_Trigger_Buffer_Full = XI_CNT_SEL_FRAME_MISSED_TRIGGER_DUETO_FRAME_BUFFER_OVR,
-				CounterSelector_Frame_Buffer_Full = XI_CNT_SEL_FRAME_BUFFER_OVERFLOW
+				CounterSelector_Frame_Buffer_Full = XI_CNT_SEL_FRAME_BUFFER_OVERFLOW,
+				CounterSelector_Transferred_Frames = XI_CNT_SEL_TRANSPORT_TRANSFERRED_FRAMES
 			};
 
 			enum AcqTimingMode {
@@ -248,6 +288,12 @@ namespace lima
 				AcqTimingMode_Frame_Rate_Limit = XI_ACQ_TIMING_MODE_FRAME_RATE_LIMIT
 			};
 
+			enum TriggerOverlap {
+				TriggerOverlap_Off = XI_TRG_OVERLAP_OFF,
+				TriggerOverlap_Read_Out = XI_TRG_OVERLAP_READ_OUT,
+				TriggerOverlap_Prev_Frame = XI_TRG_OVERLAP_PREV_FRAME
+			};
+
 			enum FeatureSelector {
 				FeatureSelector_Zero_ROT_Enable = XI_SENSOR_FEATURE_ZEROROT_ENABLE,
 				FeatureSelector_Black_Level_Clamp = XI_SENSOR_FEATURE_BLACK_LEVEL_CLAMP,
@@ -340,6 +386,42 @@ namespace lima
 				LEDMode_Blink = XI_LED_BLINK
 			};
 
+			enum AutoExposureEngine {
+				AutoExposureEngine_Hardware, AutoExposureEngine_Software
+			};
+
+			enum PreTriggerSource {
+				PreTriggerSource_Gpi, PreTriggerSource_Software
+			};
+
+			enum LiveViewMode {
+				LiveViewMode_Off = LiveView::Off,
+				LiveViewMode_Every_Nth = LiveView::EveryNth,
+				LiveViewMode_Fixed_Rate = LiveView::FixedRate
+			};
+
+			enum DemosaicAlgorithm {
+				DemosaicAlgorithm_Bilinear = Demosaic::Bilinear,
+				DemosaicAlgorithm_Edge_Aware = Demosaic::EdgeAware
+			};
+
+			enum DarkMatch {
+				DarkMatch_None = DarkLibrary::None,
+				DarkMatch_Exact = DarkLibrary::Exact,
+				DarkMatch_Interpolated = DarkLibrary::Interpolated
+			};
+
+			enum MetadataSidecarFormat {
+				MetadataSidecarFormat_Raw = MetadataSidecar::Raw,
+				MetadataSidecarFormat_Npy = MetadataSidecar::Npy
+			};
+
+			enum BufferPages {
+				BufferPages_Normal = MappedBufferAllocMgr::Normal,
+				BufferPages_Transparent_Huge = MappedBufferAllocMgr::TransparentHuge,
+				BufferPages_Huge = MappedBufferAllocMgr::Huge
+			};
+
 			Camera(
 				int camera_id,
 				GPISelector trigger_gpi_port, unsigned int timeout,
@@ -357,7 +439,10 @@ namespace lima
 			// Version info
 			void getPluginVersion(std::string& version);
 
-			// DetInfoCtrlObj
+			// DetInfoCtrlObj; the image type follows the image format: the
+			// bit depth for mono and raw ones, Bpp32F for Raw32_Float and
+			// Bpp32 packed B G R A for colour ones, converted when the
+			// camera layout differs
 			void getImageType(ImageType& type);
 			void setImageType(ImageType type);
 
@@ -401,6 +486,16 @@ namespace lima
 			void getTriggerPolarity(TriggerPolarity& p);
 			void setTriggerPolarity(TriggerPolarity p);
 
+			// ExtTrigMult trigger overlap: Read_Out accepts the next trigger
+			// during readout, Prev_Frame also latches one arriving earlier
+			void getTriggerOverlap(TriggerOverlap& o);
+			void setTriggerOverlap(TriggerOverlap o);
+			// expected external trigger period, checked by prepareAcq
+			// against the sensor timing; 0 to skip the check
+			void getTriggerPeriod(double& t);
+			void setTriggerPeriod(double t);
+			void getMaxTriggerRate(double& r);
+
 			// Software trigger
 			void getSoftwareTrigger(bool &t);
 			void setSoftwareTrigger(bool t);
@@ -431,6 +526,312 @@ namespace lima
 			void getLedMode(LEDMode& m);
 			void setLedMode(LEDMode m);
 
+			// Frame statistics
+			void getStatsEnabled(bool& e);
+			void setStatsEnabled(bool e);
+			void getStatsWindow(int& n);
+			void setStatsWindow(int n);
+			void getFrameStats(FrameStats& s);
+			void getStatsMin(double& v);
+			void getStatsMax(double& v);
+			void getStatsMean(double& v);
+			void getStatsSum(double& v);
+			void getStatsHistogram(std::vector<int>& h);
+			void getStatsRollingMin(double& v);
+			void getStatsRollingMax(double& v);
+			void getStatsRollingMean(double& v);
+			void getStatsTime(double& t);
+			void getStatsTimeFraction(double& f);
+
+			// Auto exposure
+			void getAutoExposureEngine(AutoExposureEngine& e);
+			void setAutoExposureEngine(AutoExposureEngine e);
+			void getAutoExposureMode(bool& on);
+			void setAutoExposureMode(bool on);
+			void getSoftAePercentile(double& p);
+			void setSoftAePercentile(double p);
+			void getSoftAeTargetLevel(double& l);
+			void setSoftAeTargetLevel(double l);
+			void getSoftAeMaxSaturation(double& s);
+			void setSoftAeMaxSaturation(double s);
+			void getSoftAeTolerance(double& t);
+			void setSoftAeTolerance(double t);
+			void getSoftAeMaxExposure(double& e);
+			void setSoftAeMaxExposure(double e);
+			void getSoftAeMaxGain(double& g);
+			void setSoftAeMaxGain(double g);
+			void getAutoExposureConvergence(int& nb_frames);
+			void getAutoExposureLevel(double& l);
+
+			// Dark / flat field correction
+			void getCorrectionEnabled(bool& e);
+			void setCorrectionEnabled(bool e);
+			void loadDarkMap(const std::string& path);
+			void loadFlatMap(const std::string& path);
+			void clearDarkMap();
+			void clearFlatMap();
+			// stripe workers of correction, accumulation, HDR merge and format
+			// conversion, fixed while acquiring
+			void getProcessingThreads(int& n);
+			void setProcessingThreads(int n);
+			void getCorrectionTime(double& t);
+			void getCorrectionThroughput(double& t);
+
+			// Pre-trigger ring buffer: acquisition runs free into a ring of
+			// pretrigger frames, the event commits them then the following
+			// frames up to the requested number of frames
+			void getPreTriggerMode(bool& on);
+			void setPreTriggerMode(bool on);
+			void getPreTriggerFrames(int& n);
+			void setPreTriggerFrames(int n);
+			void getPreTriggerSource(PreTriggerSource& s);
+			void setPreTriggerSource(PreTriggerSource s);
+			void firePreTrigger();
+			void getPreTriggerEventFrame(int& n);
+
+			// Frame accumulation: each Lima frame (Bpp32) is the sum of
+			// nb_frames sensor frames, 1 to disable
+			void getAccumulationFrames(int& nb_frames);
+			void setAccumulationFrames(int nb_frames);
+			void getAccumulationHwFrames(int frame_nb, int& first_hw_frame, int& last_hw_frame);
+
+			// HDR merge of the high and low gain channels of the HL modes into
+			// one linear frame in high gain units, Bpp16 (clipped) or Bpp32.
+			// Gain ratio and knee (ADU above black) at 0 use the calibration
+			// cached for the mode and sensor temperature, measured on the
+			// first frame when missing.
+			void getHdrMergeEnabled(bool& on);
+			void setHdrMergeEnabled(bool on);
+			void getHdrOutputDepth(int& bits);
+			void setHdrOutputDepth(int bits);
+			void getHdrGainRatio(double& r);
+			void setHdrGainRatio(double r);
+			void getHdrKnee(double& k);
+			void setHdrKnee(double k);
+			// in use by the current acquisition, 0 until calibrated
+			void getHdrCalibration(double& gain_ratio, double& knee);
+			void clearHdrCalibration();
+			void getHdrMergeTime(double& t);
+
+			// Bayer demosaic of the Raw8 / Raw16 frames of colour models into
+			// Bpp32 Lima buffers of B G R A 8 bit pixels. Raw frames wait in
+			// a small ring and are converted by a thread of their own with
+			// its own stripe workers, so the grab loop only reads. Enabling
+			// and the thread count are fixed while acquiring, the algorithm
+			// is taken up by the next frame.
+			void getDemosaicEnabled(bool& on);
+			void setDemosaicEnabled(bool on);
+			void getDemosaicAlgorithm(DemosaicAlgorithm& a);
+			void setDemosaicAlgorithm(DemosaicAlgorithm a);
+			void getDemosaicThreads(int& n);
+			void setDemosaicThreads(int n);
+			void getDemosaicTime(double& t);
+			// Mpixels/s
+			void getDemosaicThroughput(double& t);
+			// synthetic frames of the current ROI size, every algorithm at
+			// 8 and 12 bits
+			void benchmarkDemosaic(int nb_frames, std::vector<DemosaicThroughput>& results);
+
+			// Live view side channel, decoupled from the Lima buffers
+			void getLiveViewMode(LiveViewMode& m);
+			void setLiveViewMode(LiveViewMode m);
+			void getLiveViewDecimation(int& n);
+			void setLiveViewDecimation(int n);
+			void getLiveViewRate(double& r);
+			void setLiveViewRate(double r);
+			void getLiveViewDownscale(int& d);
+			void setLiveViewDownscale(int d);
+			void getLiveView8Bit(bool& c);
+			void setLiveView8Bit(bool c);
+			// frame_nb is -1 until a frame was published
+			void getLiveImage(LiveView::Frame& frame);
+
+			// Frame rate model; sensor timing is calibrated from the camera
+			// per mode, bit depth, binning, shutter and taps, on request only
+			// since it rewrites height, offset and exposure. Until then the
+			// camera frame rate limit for the settings in place seeds it.
+			void getExpTimeRange(double& min_exp_time, double& max_exp_time);
+			// what-if query, roi in binned pixels (empty for full frame)
+			void predictTiming(double exp_time, const Roi& roi, const Bin& bin, ImageType type, TimingPrediction& prediction);
+			// for the current settings
+			void getTimingPrediction(TimingPrediction& prediction);
+			void calibrateTiming();
+
+			// Sensor mode characterization, beam off: frame rate, readout,
+			// dark level and noise and link use at minimum exposure for
+			// every mode x ROI x bit depth. Empty lists mean all modes, full
+			// frame and the current bit depth; settings are restored after.
+			void getBenchmarkModes(std::vector<int>& modes);
+			void setBenchmarkModes(const std::vector<int>& modes);
+			void getBenchmarkRois(std::vector<Roi>& rois);
+			void setBenchmarkRois(const std::vector<Roi>& rois);
+			void getBenchmarkBitDepths(std::vector<int>& bit_depths);
+			void setBenchmarkBitDepths(const std::vector<int>& bit_depths);
+			void getBenchmarkFrames(int& n);
+			void setBenchmarkFrames(int n);
+			// JSON report, none if report_path is empty; throws once done if
+			// the settings in place before could not all be restored
+			void runBenchmark(const std::string& report_path);
+			void getBenchmarkResults(std::vector<BenchmarkResult>& results);
+
+			// Dark frame cache, replaces the dark map when a dark matches
+			void getDarkCacheEnabled(bool& e);
+			void setDarkCacheEnabled(bool e);
+			void getDarkCacheDir(std::string& dir);
+			void setDarkCacheDir(const std::string& dir);
+			void getDarkTempTolerance(double& t);
+			void setDarkTempTolerance(double t);
+			void getDarkCacheSize(int& n);
+			void acquireDark(int nb_frames);
+			void clearDarkCache();
+			void getDarkMatch(DarkMatch& m);
+			void getDarkStale(bool& s);
+
+			// SDK queue and transport buffers, sized at prepareAcq to absorb
+			// burst_time seconds at the camera maximum frame rate; overrides of 0
+			// let the size follow the frame size and rate
+			void getSdkBurstTime(double& t);
+			void setSdkBurstTime(double t);
+			void getSdkQueueSizeOverride(int& nb_frames);
+			void setSdkQueueSizeOverride(int nb_frames);
+			void getSdkAcqBufferSizeOverride(int& size_mb);
+			void setSdkAcqBufferSizeOverride(int size_mb);
+			void getSdkTransportBufferSizeOverride(int& size);
+			void setSdkTransportBufferSizeOverride(int size);
+			// sizes in use
+			void getSdkQueueSize(int& nb_frames);
+			void getSdkAcqBufferSize(int& size_mb);
+			void getSdkTransportBufferSize(int& size);
+			// frames received by the SDK not read yet, and the highest
+			// value the grab thread saw since prepareAcq
+			void getSdkQueueOccupancy(int& nb_frames);
+			void getSdkQueueHighWater(int& nb_frames);
+
+			// Lima frame buffers: 2 MB pages for the next allocation,
+			// prefaulting and locking in memory at prepareAcq
+			void getBufferHugePages(bool& h);
+			void setBufferHugePages(bool h);
+			void getBufferPrefault(bool& p);
+			void setBufferPrefault(bool p);
+			void getBufferLock(bool& l);
+			void setBufferLock(bool l);
+			void getBufferPages(BufferPages& p);
+			void getBufferPrefaultTime(double& t);
+
+			// NUMA placement of frame buffers, SDK buffers, acquisition
+			// and processing threads; node -1 follows the camera PCIe
+			// device, placement is applied at prepareAcq
+			void getNumaNbNodes(int& n);
+			void getNumaDeviceNode(int& node);
+			void getNumaNode(int& node);
+			void setNumaNode(int node);
+			// as applied and as observed, -1 if unknown
+			void getNumaPlacementNode(int& node);
+			void getNumaBufferNode(int& node);
+			void getNumaAcqThreadNode(int& node);
+
+			// Exposure and gain set while acquiring are queued and applied
+			// by the acquisition thread between two frames; values in
+			// effect are reported per frame, -1 when unknown
+			void getFrameParams(int frame_nb, double& exp_time, double& gain);
+			void getLastFrameExpTime(double& exp_time);
+			void getLastFrameGain(double& gain);
+
+			// Exposure sequence: frame n of an acquisition gets exposure and
+			// gain (dB, empty list to keep the gain) n modulo the sequence
+			// length. Applied by the grab thread between frames, IntTrig
+			// frames being software triggered once their settings are
+			// written; per-frame metadata tells the step and what the
+			// camera reports. Empty exp_times to disable.
+			void setExposureSequence(const std::vector<double>& exp_times, const std::vector<double>& gains);
+			void getExposureSequence(std::vector<double>& exp_times, std::vector<double>& gains);
+			// frames whose reported exposure or gain differs from their step,
+			// each also raised as a (coalesced) warning event
+			void getSequenceMismatches(int& n);
+
+			// Per-frame metadata from XI_IMG, kept for the frames still in
+			// the Lima buffers and optionally written to a sidecar file,
+			// empty path to disable. Each acquisition gets its own file,
+			// numbered after the path stem (metadata_0000.npy, ...)
+			void getFrameMetadata(int frame_nb, FrameMetadata& metadata);
+			void getMetadataSidecarPath(std::string& path);
+			void setMetadataSidecarPath(const std::string& path);
+			// the file of the last prepareAcq
+			void getMetadataSidecarFile(std::string& path);
+			void getMetadataSidecarFormat(MetadataSidecarFormat& f);
+			void setMetadataSidecarFormat(MetadataSidecarFormat f);
+
+			// Sensor monitor: temperatures, acquisition status and counter
+			// are sampled in the background, their getters read the last
+			// snapshot while it runs
+			void getMonitorEnabled(bool& e);
+			void setMonitorEnabled(bool e);
+			void getMonitorRate(double& r);
+			void setMonitorRate(double r);
+			void getMonitorHistorySize(int& n);
+			void setMonitorHistorySize(int n);
+			void getMonitorSnapshot(SensorSnapshot& snapshot);
+			void getMonitorHistory(std::vector<SensorSnapshot>& history);
+
+			// Events: queued from the acquisition loop, merged and rate
+			// limited on their way to Lima
+			void getEventMaxRate(double& r);
+			void setEventMaxRate(double r);
+			void getEventCoalesceTime(double& t);
+			void setEventCoalesceTime(double t);
+			void getEventsDelivered(int& n);
+			void getEventsCoalesced(int& n);
+			void getEventsSuppressed(int& n);
+			void getEventsLost(int& n);
+			// sensor board temperature raising an event, 0 to disable
+			void getTempAlarm(double& t);
+			void setTempAlarm(double t);
+
+
+			// Camera to host clock sync, off by default: camera timestamp
+			// counter reads paired with host clocks every interval, frame
+			// timestamps are taken from the camera through the fit instead
+			// of the arrival time. Frame stamps (XI_IMG tsSec/tsUSec) are
+			// assumed to count on the XI_PRM_TIMESTAMP clock; the first
+			// frame of each acquisition checks it and disables the sync if not
+			void getClockSyncEnabled(bool& e);
+			void setClockSyncEnabled(bool e);
+			void getClockSyncInterval(double& t);
+			void setClockSyncInterval(double t);
+			void getClockSyncWindow(int& n);
+			void setClockSyncWindow(int n);
+			void getClockSyncNbSamples(int& n);
+			void getClockSyncDrift(double& ppm);
+			void getClockSyncOffset(double& t);
+			void getClockSyncError(double& t);
+			void syncClock();
+
+			// External trigger diagnostics: latency from the trigger edge to
+			// the host, its jitter and the missed triggers, measured over
+			// each ExtTrigSingle / ExtTrigMult acquisition
+			void getTriggerDiagEnabled(bool& e);
+			void setTriggerDiagEnabled(bool e);
+			void getTriggerDiagBinWidth(double& w);
+			void setTriggerDiagBinWidth(double w);
+			void getTriggerDiagStats(TriggerDiagStats& stats);
+			void getTriggerDiagHistogram(std::vector<int>& histogram);
+			void resetTriggerDiag();
+
+			// Configuration profiles: camera settings saved by name in the
+			// profile directory (or to a path), loading writes only the
+			// settings that differ, in dependency order
+			void getProfileDir(std::string& dir);
+			void setProfileDir(const std::string& dir);
+			void saveProfile(const std::string& name);
+			void loadProfile(const std::string& name);
+			void getProfileList(std::vector<std::string>& names);
+			void getProfileName(std::string& name);
+			void getProfileSwitchTime(double& t);
+			void getProfileNbWrites(int& n);
+
+			// All device configuration parameters in one call; parameters
+			// this model does not support are left out
+			void getSnapshot(ParamSnapshot& snapshot);
 
 			// ========== Extra attributes ==========
 
@@ -477,6 +878,8 @@ namespace lima
 			void setTestPattern(TestPattern p);
 			void getImageFormat(ImageFormat& f);
 			void setImageFormat(ImageFormat f);
+			// conversion of the last frame to the Lima layout, 0 if none
+			void getFormatConversionTime(double& t);
 			void getShutter(Shutter& s);
 			void setShutter(Shutter s);
 			void getTaps(Taps& t);
@@ -535,6 +938,9 @@ namespace lima
 			void getFeatureValue(int& v);
 			void setFeatureValue(int v);
 
+		protected:
+			virtual void setMaxImageSizeCallbackActive(bool cb_active);
+
 		private:
 			int cam_id;
 			HANDLE xiH;
@@ -550,7 +956,7 @@ namespace lima
 			int m_image_number;
 			size_t m_buffer_size;
 			AcqThread* m_acq_thread;
-			SoftBufferCtrlObj m_buffer_ctrl_obj;
+			BufferCtrlObj m_buffer_ctrl_obj;
 			TrigMode m_trigger_mode;
 			int m_max_height;
 			int m_max_width;
@@ -558,10 +964,245 @@ namespace lima
 			
 			// internal
 			TriggerPolarity m_trig_polarity;
+			TriggerOverlap m_trigger_overlap;
+			double m_trigger_period;
 			GPISelector m_trigger_gpi_port;
 			unsigned int m_timeout;
 			bool m_soft_trigger_issued;
 
+			// frame statistics
+			bool m_stats_enabled;
+			int m_stats_bit_depth;
+			FrameStats m_frame_stats;
+			RollingStats m_rolling_stats;
+			double m_stats_time;
+			double m_stats_time_fraction;
+			Mutex m_stats_mutex;
+
+			// auto exposure
+			AutoExposureEngine m_ae_engine;
+			bool m_soft_ae_enabled;
+			bool m_hw_ae_enabled;
+			AutoExposure m_auto_exposure;
+			Mutex m_ae_mutex;
+
+			// dark / flat correction
+			bool m_correction_enabled;
+			Correction m_correction;
+			StripeWorkers m_workers;
+			double m_correction_time;
+			double m_correction_throughput;
+			Mutex m_correction_mutex;
+
+			// pre-trigger
+			bool m_pretrigger_mode;
+			int m_pretrigger_frames;
+			PreTriggerSource m_pretrigger_source;
+			volatile bool m_pretrigger_fired;
+			int m_pretrigger_event_frame;
+
+			// accumulation
+			struct AccumulatedFrame
+			{
+				int frame_nb;
+				int first_hw_frame;
+				int last_hw_frame;
+			};
+			int m_accumulation_frames;
+			int m_sensor_frame_size;
+			std::vector<AccumulatedFrame> m_accumulated_frames;	// per Lima buffer
+			Mutex m_accumulation_mutex;
+
+			// HDR merge
+			bool m_hdr_enabled;
+			int m_hdr_output_depth;
+			double m_hdr_gain_ratio;	// 0: calibrated
+			double m_hdr_knee;			// 0: calibrated
+			HdrCalibrationCache m_hdr_cache;
+			HdrCalibration m_hdr_calib;
+			int m_hdr_mode;
+			double m_hdr_temperature;
+			bool m_hdr_temperature_valid;	// false: calibration not cached
+			bool m_hdr_warned;
+			double m_hdr_merge_time;
+			Mutex m_hdr_mutex;
+
+			// demosaic
+			bool m_demosaic_enabled;
+			Demosaic m_demosaic;				// demosaic thread only while acquiring
+			Demosaic::Algorithm m_demosaic_algorithm;
+			Demosaic::Pattern m_demosaic_pattern;
+			int m_demosaic_bit_depth;
+			StripeWorkers m_demosaic_workers;
+			double m_demosaic_time;
+			double m_demosaic_throughput;
+			Mutex m_demosaic_mutex;
+
+			// format conversion
+			bool m_format_convert;
+			ColourLayout m_format_layout;
+			int m_format_bit_depth;
+			double m_format_conversion_time;
+
+			// live view
+			LiveView m_live_view;
+
+			// frame rate model, key is mode, bits, bin x/y, shutter, taps
+			typedef std::vector<int> TimingKey;
+			std::map<TimingKey, SensorTiming> m_sensor_timings;
+
+			// mode characterization
+			class BenchmarkDevice : public Benchmark::Backend
+			{
+			public:
+				BenchmarkDevice(Camera& cam) : m_cam(cam) {}
+				virtual void getModes(std::vector<int>& modes);
+				virtual void configure(const BenchmarkPoint& point);
+				virtual double getExposureTime();
+				virtual double getLinkBandwidth();
+				virtual void start();
+				virtual void readFrame(Frame& frame);
+				virtual void stop();
+
+			private:
+				Camera& m_cam;
+				std::vector<char> m_buffer;
+				XI_IMG m_image;
+				int m_timeout;
+			};
+			Benchmark m_benchmark;
+			std::vector<int> m_benchmark_modes;
+			std::vector<Roi> m_benchmark_rois;
+			std::vector<int> m_benchmark_bit_depths;
+
+			// dark frame cache
+			bool m_dark_cache_enabled;
+			DarkLibrary m_dark_library;
+			DarkMatch m_dark_match;
+			DarkKey m_dark_key;
+
+			// SDK buffers
+			double m_sdk_burst_time;
+			int m_sdk_queue_size_override;
+			int m_sdk_acq_buffer_size_override;
+			int m_sdk_transport_buffer_size_override;
+			volatile int m_sdk_frames_read;
+			int m_sdk_queue_high_water;
+
+			// frame buffers
+			bool m_buffer_prefault;
+			bool m_buffer_lock;
+			double m_buffer_prefault_time;
+
+			// NUMA
+			int m_numa_node;
+			int m_numa_device_node;
+			int m_numa_placement_node;
+			volatile int m_numa_acq_thread_node;
+
+			// parameter updates while acquiring
+			volatile bool m_params_pending;
+			bool m_exp_pending;
+			int m_pending_exp;
+			bool m_gain_pending;
+			int m_pending_gain;
+			Mutex m_params_mutex;
+
+			// exposure sequence
+			std::vector<double> m_sequence_exp;		// s
+			std::vector<double> m_sequence_gain;	// dB
+			bool m_sequence_active;
+			bool m_sequence_soft_trigger;
+			int m_sequence_applied;				// step in the camera, -1 if none
+			int m_sequence_mismatches;
+			int m_sequence_saved_exp;
+			double m_sequence_saved_gain;
+
+			// frame metadata, per Lima buffer
+			std::vector<FrameMetadata> m_frame_metadata;
+			FrameMetadata m_last_frame_metadata;
+			Mutex m_frame_metadata_mutex;
+			std::string m_sidecar_path;
+			MetadataSidecarFormat m_sidecar_format;
+			MetadataSidecar m_sidecar;
+			int m_sidecar_index;
+			std::string m_sidecar_file;
+
+			// sensor monitor
+			class MonitorSampler : public SensorMonitor::Sampler
+			{
+			public:
+				MonitorSampler(Camera& cam) : m_cam(cam) {}
+				virtual bool sample(SensorSnapshot& snapshot);
+
+			private:
+				Camera& m_cam;
+			};
+			MonitorSampler m_monitor_sampler;
+			SensorMonitor m_monitor;
+			// thermometer and counter selectors vs their values
+			Mutex m_selector_mutex;
+
+			// events
+			class EventSink : public EventQueue::Sink
+			{
+			public:
+				EventSink(Camera& cam) : m_cam(cam) {}
+				virtual void deliver(Event* event);
+
+			private:
+				Camera& m_cam;
+			};
+			EventSink m_event_sink;
+			EventQueue m_event_queue;
+			double m_temp_alarm;
+			bool m_temp_alarm_raised;
+
+			// parameter snapshot
+			Mutex m_snapshot_mutex;
+			std::set<std::string> m_snapshot_unsupported;
+
+			// clock sync, pairings taken on a thread of their own
+			class ClockSyncSampler : public SensorMonitor::Sampler
+			{
+			public:
+				ClockSyncSampler(Camera& cam) : m_cam(cam) {}
+				virtual bool sample(SensorSnapshot&) { return this->m_cam._sync_clock(); }
+
+			private:
+				Camera& m_cam;
+			};
+			ClockSyncSampler m_clock_sync_sampler;
+			SensorMonitor m_clock_sync_thread;
+			ClockSync m_clock_sync;
+			Mutex m_clock_sync_mutex;
+			bool m_clock_sync_enabled;
+			bool m_clock_sync_supported;
+			bool m_clock_sync_checked;		// first frame of the acquisition
+			double m_clock_sync_interval;
+			double m_start_timestamp;
+
+			// trigger diagnostics
+			TriggerDiag m_trigger_diag;
+			bool m_trigger_diag_enabled;
+			bool m_trigger_diag_active;		// this acquisition is measured
+			double m_trigger_diag_delay;	// s
+			int m_missed_overlap_start;
+			int m_missed_buffer_full_start;
+
+			// profiles
+			struct ProfileWalk
+			{
+				Profile* read;				// saving: current values
+				const Profile* target;		// loading: values to reach
+				int nb_writes;
+				std::vector<std::string> errors;
+			};
+			std::string m_profile_dir;
+			std::string m_profile_name;
+			double m_profile_switch_time;
+			int m_profile_nb_writes;
+
 			void _startup(void);
 			bool _check_model(std::string model);
 
@@ -576,8 +1217,65 @@ namespace lima
 			int _get_param_min(const char* param);
 			int _get_param_max(const char* param);
 			int _get_param_inc(const char* param);
+			double _get_param_dbl_min(const char* param);
+			double _get_param_dbl_max(const char* param);
 
 			void _read_image(XI_IMG* image, int timeout);
+			bool _update_frame_stats(const XI_IMG* image, double frame_period, FrameStats& stats);
+			bool _auto_exposure_active(void);
+			void _update_auto_exposure(const XI_IMG* image, const FrameStats& stats);
+			void _set_soft_ae_param(double AutoExposure::Params::*param, double value);
+			void _apply_correction(const XI_IMG* image);
+			static int _get_pixel_size(int format);
+			void _get_dark_key(DarkKey& key);
+			void _accumulate_frame(const XI_IMG* image, void* frame_ptr, int frame_nb, bool first);
+			void _merge_hdr(const XI_IMG* image, void* frame_ptr);
+			void _calibrate_hdr(const XI_IMG* image, const uint16_t* hg, const uint16_t* lg, size_t stride);
+			void _demosaic_frame(const XI_IMG* image, void* frame_ptr);
+			void _image_type_changed(void);
+			void _publish_live_view(const XI_IMG* image, int frame_nb);
+			void _publish_live_view(const void* frame_ptr, int width, int height, int frame_nb);
+			void _get_sensor_image_type(ImageType& type);
+			void _get_format_type(ImageFormat format, ImageType& type, bool& convert, ColourLayout& layout);
+			void _convert_frame(const XI_IMG* image, void* frame_ptr);
+			void _get_timing_key(int bits, const Bin& bin, TimingKey& key);
+			void _calibrate_timing(SensorTiming& timing);
+			void _seed_timing(SensorTiming& timing);
+			double _get_bandwidth(void);
+			bool _is_acquiring(void);
+			void _size_sdk_buffers(void);
+			// false when the counter cannot be read
+			bool _get_counter(CounterSelector s, int& value);
+			bool _get_sdk_queue_occupancy(int& nb_frames);
+			// high-water mark, at most every SDK_QUEUE_SAMPLE_PERIOD
+			void _sample_sdk_queue(Timestamp& last_sample);
+			void _apply_pending_params(void);
+			// InvalidValue outside the camera limits
+			void _check_param_range(const char* param, int value);
+			// while acquiring: a rejected value is a warning event
+			bool _apply_param(const char* param, int value);
+			void _start_sequence(void);
+			void _apply_sequence_step(int frame_nb, bool trigger);
+			void _check_sequence_step(FrameMetadata& metadata);
+			void _end_sequence(void);
+			void _fill_frame_metadata(const XI_IMG* image, FrameMetadata& metadata);
+			void _store_frame_metadata(const FrameMetadata& metadata);
+			void _open_sidecar(void);
+			bool _query_int(const char* param, int& value);
+			double _query_dbl(const char* param);
+			void _snap_int(ParamSnapshot& snapshot, const char* name, const char* param, bool boolean);
+			void _snap_dbl(ParamSnapshot& snapshot, const char* name, const char* param);
+			bool _sync_clock(void);
+			bool _host_timestamp(unsigned int ts_sec, unsigned int ts_usec, Timestamp& ts);
+			void _start_trigger_diag(void);
+			void _record_trigger_diag(const XI_IMG* image);
+			std::string _profile_path(const std::string& name);
+			void _walk_profile(ProfileWalk& walk);
+			template <typename T, typename U>
+			void _profile_param(ProfileWalk& walk, const std::string& name, void (Camera::*getter)(T&), void (Camera::*setter)(U));
+			template <typename S, typename T, typename U>
+			void _profile_ports(ProfileWalk& walk, const char* name, void (Camera::*get_selector)(S&), void (Camera::*set_selector)(S),
+				S first, int nb, void (Camera::*getter)(T&), void (Camera::*setter)(U));
 			
 			void _generate_soft_trigger(void);
 			bool _soft_trigger_issued(void);
@@ -588,7 +1286,9 @@ namespace lima
 
 			void _set_status(Camera::Status status);
 
-			void reportException(Exception& e, std::string name);
+			void reportException(Exception& e, const char* where);
+			void _report_event(EventQueue::Type type, const char* msg, long value = 1);
+			void _report_event(const EventQueue::Record& event);
 		};
 
 	} // namespace Ximea
@@ -0,0 +1,96 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEACLOCKSYNC_H
+#define XIMEACLOCKSYNC_H
+
+#include <deque>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Maps camera timestamps to host time. Readings of the camera
+		// counter are paired with CLOCK_MONOTONIC around them, a line
+		// (offset and drift) is fitted over a sliding window of pairs and
+		// CLOCK_REALTIME follows from its offset to CLOCK_MONOTONIC at the
+		// last pair, so wall clock steps do not disturb the fit.
+		class XIMEA_EXPORT ClockSync
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "ClockSync", "Ximea");
+
+		public:
+			ClockSync();
+
+			void reset();
+			// camera time and host clocks read just before and after it;
+			// the camera clock going back (reset) restarts the fit
+			void addSample(double camera, double mono_before, double mono_after, double real);
+
+			void setWindow(int nb_samples);
+			int getWindow() const { return this->m_window; }
+
+			bool isValid();
+			// CLOCK_REALTIME seconds, false without any sample
+			bool toHost(double camera, double& real);
+
+			int getNbSamples();
+			double getDrift();		// ppm, camera slower > 0
+			double getOffset();		// s, host realtime - camera time
+			// s, half the round trip of the samples plus the worst fit
+			// residual
+			double getError();
+
+		private:
+			struct Sample
+			{
+				double camera;
+				double mono;		// middle of the read
+				double half_rtt;
+				double real_offset;	// realtime - monotonic
+			};
+
+			void _fit();
+
+			Mutex m_mutex;
+			int m_window;
+			std::deque<Sample> m_samples;
+
+			// host mono = m_mono0 + (camera - m_camera0) * m_rate
+			double m_camera0;
+			double m_mono0;
+			double m_rate;
+			double m_real_offset;
+			double m_error;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEACLOCKSYNC_H
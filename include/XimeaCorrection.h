@@ -0,0 +1,91 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEACORRECTION_H
+#define XIMEACORRECTION_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/SizeUtils.h"
+#include "XimeaStripeWorkers.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Dark subtraction and flat-field normalisation applied in place:
+		//   out = (raw - dark) / flat, flat being normalised to its mean
+		// Maps are given at full sensor resolution and cropped/binned to the
+		// acquisition geometry by prepare().
+		class XIMEA_EXPORT Correction
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "Correction", "Ximea");
+
+		public:
+			Correction();
+
+			// full sensor maps, raw float32 files of width x height pixels
+			void loadDarkMap(const std::string& path, int width, int height);
+			void loadFlatMap(const std::string& path, int width, int height);
+			void setDarkMap(const std::vector<float>& dark, int width, int height);
+			void setFlatMap(const std::vector<float>& flat, int width, int height);
+			void clearDarkMap();
+			void clearFlatMap();
+			bool hasDarkMap() const { return !this->m_dark.empty(); }
+			bool hasFlatMap() const { return !this->m_gain.empty(); }
+
+			// crop and bin maps; roi is given in binned pixels, binning sums
+			void prepare(const Roi& roi, const Bin& bin);
+			// dark already matching the prepared geometry (e.g. averaged frames)
+			void setPreparedDark(const std::vector<float>& dark);
+			bool isPrepared() const { return this->m_prepared; }
+
+			// pixel_size in bytes: 1, 2 or 4 (unsigned integers)
+			void apply(void* data, int pixel_size, int width, int height, size_t stride, StripeWorkers& workers);
+
+		private:
+			class ApplyTask;
+
+			void _load_map(const std::string& path, int width, int height, std::vector<float>& map);
+
+			int m_width;
+			int m_height;
+			std::vector<float> m_dark;	// full sensor
+			std::vector<float> m_gain;	// full sensor, 1 / flat
+
+			bool m_prepared;
+			int m_frame_width;
+			int m_frame_height;
+			std::vector<float> m_frame_dark;
+			std::vector<float> m_frame_gain;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEACORRECTION_H
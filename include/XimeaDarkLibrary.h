@@ -0,0 +1,106 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEADARKLIBRARY_H
+#define XIMEADARKLIBRARY_H
+
+#include <vector>
+#include <string>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/SizeUtils.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Acquisition settings a dark frame is valid for
+		struct XIMEA_EXPORT DarkKey
+		{
+			double exp_time;	// s
+			double gain;		// dB
+			int mode;
+			Roi roi;			// binned pixels
+			Bin bin;
+			double temperature;	// sensor board, *C, NaN if not read
+
+			DarkKey();
+			// everything but exposure and temperature must match
+			bool isCompatible(const DarkKey& other) const;
+		};
+
+		// Averaged dark frames indexed by DarkKey, optionally persisted in a
+		// directory: one raw float32 file per dark plus a text index.
+		class XIMEA_EXPORT DarkLibrary
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "DarkLibrary", "Ximea");
+
+		public:
+			enum Match { None, Exact, Interpolated };
+
+			DarkLibrary();
+
+			// empty to keep darks in memory only
+			void setCacheDir(const std::string& dir);
+			const std::string& getCacheDir() const { return this->m_cache_dir; }
+			void setTempTolerance(double t) { this->m_temp_tolerance = t; }
+			double getTempTolerance() const { return this->m_temp_tolerance; }
+
+			void store(const DarkKey& key, int nb_frames, const std::vector<float>& dark);
+			// exact exposure match, or linear interpolation between the two
+			// closest exposures around key.exp_time; darks within the
+			// temperature tolerance are preferred. dark_key is the (nearest)
+			// dark actually used.
+			Match lookup(const DarkKey& key, std::vector<float>& dark, DarkKey& dark_key);
+			// never without both temperatures
+			bool isStale(const DarkKey& dark_key, double temperature) const;
+
+			void clear();
+			int getNbEntries() const { return int(this->m_entries.size()); }
+
+		private:
+			struct Entry
+			{
+				DarkKey key;
+				int nb_frames;
+				std::string file;
+				std::vector<float> data;	// loaded on first use
+			};
+
+			void _load_index();
+			void _save_index();
+			void _load_data(Entry& entry);
+			std::string _file_name(const DarkKey& key) const;
+			std::string _path(const std::string& file) const;
+
+			std::string m_cache_dir;
+			double m_temp_tolerance;
+			std::vector<Entry> m_entries;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEADARKLIBRARY_H
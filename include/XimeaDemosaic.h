@@ -0,0 +1,93 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEADEMOSAIC_H
+#define XIMEADEMOSAIC_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "XimeaStripeWorkers.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Demosaic speed on one frame geometry
+		struct XIMEA_EXPORT DemosaicThroughput
+		{
+			int algorithm;		// Demosaic::Algorithm
+			int bit_depth;
+			double frame_time;	// s, mean
+			double throughput;	// Mpixels/s
+
+			DemosaicThroughput();
+		};
+
+		// Bayer raw frames to packed 8 bit colour pixels, B G R A in memory
+		// as the SDK's RGB32. Bilinear averages the nearest sites of each
+		// colour; edge aware interpolates green along the smoother
+		// direction, then red and blue on the colour differences to green.
+		// Borders are mirrored.
+		class XIMEA_EXPORT Demosaic
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "Demosaic", "Ximea");
+
+		public:
+			enum Algorithm { Bilinear, EdgeAware };
+			// colours of the top left 2x2 cell, row by row
+			enum Pattern { RGGB, GRBG, GBRG, BGGR };
+
+			Demosaic();
+
+			void setAlgorithm(Algorithm a) { this->m_algorithm = a; }
+			Algorithm getAlgorithm() const { return this->m_algorithm; }
+
+			// scratch for frames up to width x height, so that process()
+			// does not allocate
+			void prepare(int width, int height);
+			// src holds unsigned pixels of pixel_size bytes (1 or 2) with
+			// bit_depth significant bits, rows stride bytes apart; dst
+			// width x height contiguous pixels
+			void process(uint32_t* dst, const void* src, int pixel_size, int bit_depth, int width, int height,
+				size_t stride, Pattern pattern, StripeWorkers& workers);
+
+			// every algorithm on nb_frames synthetic width x height frames,
+			// 8 bit and 12 bit in 16 bit pixels
+			static void benchmark(int width, int height, int nb_frames, StripeWorkers& workers,
+				std::vector<DemosaicThroughput>& results);
+
+		private:
+			std::vector<uint16_t> m_green;
+			Algorithm m_algorithm;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEADEMOSAIC_H
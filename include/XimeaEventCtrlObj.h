@@ -28,13 +28,16 @@
 #include <ximea_export.h>
 
 #include "lima/HwEventCtrlObj.h"
+#include "XimeaEventQueue.h"
 
 namespace lima
 {
 	namespace Ximea
 	{
 		class Camera;
-		class EventCtrlObj : public HwEventCtrlObj
+		// Lima end of the camera event queue: the drain thread reports
+		// here instead of the camera's own callback
+		class EventCtrlObj : public HwEventCtrlObj, public EventQueue::Sink
 		{
 			DEB_CLASS(DebModCamera, "EventCtrlObj");
 
@@ -42,6 +45,8 @@ namespace lima
 			EventCtrlObj(Camera&);
 			virtual ~EventCtrlObj();
 
+			virtual void deliver(Event* event);
+
 		private:
 			Camera& m_cam;
 		};
@@ -0,0 +1,195 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEAEVENTQUEUE_H
+#define XIMEAEVENTQUEUE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/Event.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Events raised from the acquisition loop. push() never blocks nor
+		// formats: typed records go into a fixed lock-free ring, a drain
+		// thread writes their messages and turns them into Lima events,
+		// merging identical ones over the coalesce time and limiting the
+		// rate of each type.
+		class XIMEA_EXPORT EventQueue
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "EventQueue", "Ximea");
+
+		public:
+			enum Type {
+				Error,				// exception in the acquisition path
+				DroppedFrames,		// lost before reaching the host, value: frames
+				QueueOverrun,		// discarded by the SDK queue, value: frames
+				TemperatureAlarm,
+				Timeout,			// no image within the read timeout
+				Warning,			// setting rejected, acquisition goes on
+				NbTypes
+			};
+
+			// what a record says, its message is written by the drain thread
+			enum Code {
+				Text,				// text
+				Failure,			// text: where, detail: exception description
+				ReadFailed,			// text: where, status: xi_status
+				FrameNotReady,		// text: where, Lima refused the frame
+				ParamRejected,		// text: parameter, value, status: xi_status
+				TemperatureAbove	// reading above limit, *C
+			};
+
+			struct Record
+			{
+				Type type;
+				Code code;
+				const char* text;		// static storage, never copied
+				long value;
+				int status;
+				double reading;
+				double limit;
+				std::string* detail;	// owned by the queue once pushed
+
+				Record(Type type = Error, Code code = Text, const char* text = "", long value = 1);
+			};
+
+			// where the drain thread delivers events, which it then owns
+			class Sink
+			{
+			public:
+				virtual ~Sink() {}
+				virtual void deliver(Event* event) = 0;
+			};
+
+			struct Counts
+			{
+				unsigned long pushed;
+				unsigned long delivered;
+				unsigned long coalesced;	// merged into another event
+				unsigned long suppressed;	// over the rate limit
+				unsigned long lost;			// queue full
+
+				Counts();
+			};
+
+			EventQueue(Sink& sink, int capacity = 1024);
+			~EventQueue();
+
+			void start();
+			// delivers what is still queued
+			void stop();
+
+			// any thread, lock-free; false if the event was lost
+			bool push(const Record& record);
+			bool push(Type type, const char* text, long value = 1);
+			// an exception caught at where, only this one allocates: the
+			// description is kept whole
+			bool pushFailure(const char* where, const std::string& description);
+
+			// NULL restores the default sink; waits for a delivery in progress
+			void setSink(Sink* sink);
+
+			void setMaxRate(double rate);		// events/s per type, 0: no limit
+			double getMaxRate() const { return this->m_max_rate; }
+			void setCoalesceTime(double t);		// s
+			double getCoalesceTime() const { return this->m_coalesce_time; }
+			void getCounts(Counts& counts);
+
+			static const char* typeName(Type type);
+			static std::string format(const Record& record);
+
+		private:
+			struct Slot
+			{
+				std::atomic<size_t> seq;
+				Record record;
+			};
+
+			struct Group
+			{
+				Type type;
+				std::string msg;
+				int count;
+				long value;
+			};
+
+			class DrainThread : public Thread
+			{
+			public:
+				DrainThread(EventQueue& queue) : m_queue(queue) {}
+				virtual ~DrainThread() {}
+
+			protected:
+				virtual void threadFunction();
+
+			private:
+				EventQueue& m_queue;
+			};
+			friend class DrainThread;
+
+			bool _pop(Record& record);
+			void _drain(double now);
+			void _deliver(Type type, const std::string& msg);
+
+			Sink& m_default_sink;
+			Sink* m_sink;
+			Mutex m_sink_mutex;
+
+			Slot* m_slots;
+			size_t m_mask;
+			std::atomic<size_t> m_enqueue_pos;
+			size_t m_dequeue_pos;
+			std::atomic<unsigned long> m_nb_pushed;
+			std::atomic<unsigned long> m_nb_lost;
+
+			DrainThread* m_thread;
+			Cond m_cond;
+			bool m_quit;
+			double m_max_rate;
+			double m_coalesce_time;
+
+			// drain thread only
+			std::vector<Group> m_groups;
+			double m_tokens[NbTypes];
+			double m_token_time;
+			unsigned long m_pending_suppressed[NbTypes];
+			unsigned long m_reported_lost;
+			unsigned long m_nb_delivered;
+			unsigned long m_nb_coalesced;
+			unsigned long m_nb_suppressed;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAEVENTQUEUE_H
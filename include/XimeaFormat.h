@@ -0,0 +1,59 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEAFORMAT_H
+#define XIMEAFORMAT_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <ximea_export.h>
+
+#include "XimeaStripeWorkers.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Camera colour layouts Lima cannot take as they are. Lima colour
+		// frames are Bpp32 pixels packed B G R A, 8 bit per channel, as
+		// the SDK's RGB32.
+		enum ColourLayout {
+			ColourLayout_Rgb24,			// B G R, 8 bit
+			ColourLayout_Rgb48,			// B G R, 16 bit
+			ColourLayout_Rgb64,			// B G R x, 16 bit
+			ColourLayout_RgbPlanar,		// R, G then B planes, 8 bit
+			ColourLayout_Rgb16Planar	// R, G then B planes, 16 bit
+		};
+
+		// src rows are src_stride bytes apart, planes src_stride x height
+		// bytes; 16 bit channels hold bit_depth significant bits and are
+		// shifted down to 8. dst is width x height contiguous pixels.
+		XIMEA_EXPORT void convertToRgb32(uint32_t* dst, const void* src, ColourLayout layout, int bit_depth,
+			int width, int height, size_t src_stride, StripeWorkers& workers);
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAFORMAT_H
@@ -0,0 +1,98 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEAFRAMEMETADATA_H
+#define XIMEAFRAMEMETADATA_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Fixed 80 byte record of the XI_IMG fields of one frame, the
+		// sidecar layout; unknown values are 0
+		struct XIMEA_EXPORT FrameMetadata
+		{
+			double host_time;			// s since epoch, when read
+			double data_saturation;
+			int32_t frame_nb;			// Lima frame, -1 if none
+			uint32_t acq_nframe;		// camera frames since acquisition start
+			uint32_t nframe;			// camera frame counter
+			uint32_t ts_sec;			// camera timestamp
+			uint32_t ts_usec;
+			uint32_t exposure_time_us;
+			float gain_db;
+			uint32_t black_level;
+			uint32_t gpi_level;			// one bit per input, GPI 1 being bit 0
+			uint32_t flags;
+			uint32_t image_user_data;
+			uint32_t width;
+			uint32_t height;
+			uint32_t offset_x;			// absolute, sensor pixels
+			uint32_t offset_y;
+			int32_t sequence_step;		// exposure sequence step, -1 if none
+
+			FrameMetadata();
+		};
+
+		// Records appended as they are read: raw records, or a numpy .npy
+		// structured array (numpy.load, then h5py for HDF5). Buffered, the
+		// .npy header gets the final record count at close().
+		class XIMEA_EXPORT MetadataSidecar
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "MetadataSidecar", "Ximea");
+
+		public:
+			enum Format { Raw, Npy };
+
+			MetadataSidecar();
+			~MetadataSidecar();
+
+			void open(const std::string& path, Format format);
+			void append(const FrameMetadata& metadata);
+			void close();
+			bool isOpen() const { return this->m_file != NULL; }
+			long getNbRecords() const { return this->m_nb_records; }
+
+		private:
+			void _write_npy_header();
+
+			FILE* m_file;
+			Format m_format;
+			long m_nb_records;
+			std::vector<char> m_buffer;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAFRAMEMETADATA_H
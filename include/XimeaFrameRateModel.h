@@ -0,0 +1,81 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEAFRAMERATEMODEL_H
+#define XIMEAFRAMERATEMODEL_H
+
+#include <ximea_export.h>
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Timing of one sensor configuration (mode, bit depth, binning,
+		// shutter, taps), calibrated from the camera frame rate limits:
+		// readout time = frame_overhead + rows * line_time
+		struct XIMEA_EXPORT SensorTiming
+		{
+			double line_time;		// s
+			double frame_overhead;	// s
+			double min_exp_time;	// s
+			double max_exp_time;	// s
+			// exposure of the next frame runs during readout
+			bool overlap;
+
+			SensorTiming();
+		};
+
+		struct XIMEA_EXPORT TimingPrediction
+		{
+			double min_exp_time;
+			double max_exp_time;
+			// shortest latency giving the predicted frame rate at this exposure
+			double min_lat_time;
+			double readout_time;
+			double max_fps_sensor;
+			double max_fps_bandwidth;
+			double max_fps;
+			// external triggers (ExtTrigMult) the camera accepts
+			double min_trigger_period;
+			double max_trigger_rate;
+			// false when this configuration was not calibrated, the timing
+			// of another one or the model defaults were used
+			bool calibrated;
+
+			TimingPrediction();
+		};
+
+		namespace FrameRateModel
+		{
+			// rows: sensor rows read out, frame_bytes: transport payload,
+			// bandwidth in bytes/s (0 when unknown), trigger_overlap: a
+			// trigger is accepted while the previous frame is read out
+			XIMEA_EXPORT void predict(const SensorTiming& timing, double exp_time, int rows,
+				double frame_bytes, double bandwidth, bool trigger_overlap, TimingPrediction& prediction);
+		} // namespace FrameRateModel
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAFRAMERATEMODEL_H
@@ -0,0 +1,90 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEAFRAMESTATS_H
+#define XIMEAFRAMESTATS_H
+
+#include <deque>
+#include <cstddef>
+#include <stdint.h>
+
+#include <ximea_export.h>
+
+namespace lima
+{
+	namespace Ximea
+	{
+		struct XIMEA_EXPORT FrameStats
+		{
+			static const int HISTOGRAM_BINS = 256;
+
+			double min;
+			double max;
+			double sum;
+			double mean;
+			uint64_t nb_pixels;
+			// coarse histogram, pixel value scaled down to 8 bits
+			unsigned int histogram[HISTOGRAM_BINS];
+
+			FrameStats() { reset(); }
+			void reset();
+		};
+
+		// Statistics of a frame of width x height pixels of type T, rows
+		// being stride bytes apart. bit_depth is the significant bit depth of
+		// the data, used to scale the histogram.
+		template <typename T>
+		void computeFrameStats(const T* data, int width, int height, size_t stride, int bit_depth, FrameStats& stats);
+
+		// Min/max/mean over the last frames
+		class XIMEA_EXPORT RollingStats
+		{
+		public:
+			RollingStats(int window = 10);
+
+			void setWindow(int window);
+			int getWindow() const { return this->m_window; }
+
+			void push(const FrameStats& stats);
+			void clear();
+
+			double getMin() const;
+			double getMax() const;
+			double getMean() const;
+
+		private:
+			struct Entry
+			{
+				double min;
+				double max;
+				double mean;
+			};
+
+			int m_window;
+			std::deque<Entry> m_entries;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAFRAMESTATS_H
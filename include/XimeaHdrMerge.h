@@ -0,0 +1,93 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEAHDRMERGE_H
+#define XIMEAHDRMERGE_H
+
+#include <map>
+#include <utility>
+#include <cstddef>
+#include <stdint.h>
+
+#include <ximea_export.h>
+
+#include "XimeaStripeWorkers.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Dual gain combination, levels in ADU of the high gain channel
+		struct XIMEA_EXPORT HdrCalibration
+		{
+			double gain_ratio;	// high gain / low gain
+			double knee;		// black subtracted high gain level handing over to low gain
+			double hg_black;
+			double lg_black;
+
+			HdrCalibration();
+			bool isValid() const { return this->gain_ratio > 0 && this->knee > 0; }
+		};
+
+		// Gain ratio fitted through the origin over the pixels both channels
+		// see linearly (high gain between a tenth of the knee and the knee);
+		// black levels and knee must be set. False with too few pixels.
+		XIMEA_EXPORT bool fitHdrGainRatio(const uint16_t* hg, const uint16_t* lg, int width, int height,
+			size_t stride, HdrCalibration& calib);
+
+		// Linear frame: high gain below the knee, low gain times the ratio
+		// above, blended just under the knee so that no seam shows. dst
+		// holds width x height contiguous pixels of dst_pixel_size bytes,
+		// 2 (clipped to 16 bits) or 4; both channels have rows stride bytes
+		// apart.
+		XIMEA_EXPORT void mergeHdr(void* dst, int dst_pixel_size, const uint16_t* hg, const uint16_t* lg,
+			int width, int height, size_t stride, const HdrCalibration& calib, StripeWorkers& workers);
+
+		// Calibrations by sensor mode and temperature, one per temperature
+		// step
+		class XIMEA_EXPORT HdrCalibrationCache
+		{
+		public:
+			HdrCalibrationCache();
+
+			void setTempStep(double step) { this->m_temp_step = step; }
+			double getTempStep() const { return this->m_temp_step; }
+
+			bool lookup(int mode, double temperature, HdrCalibration& calib) const;
+			void store(int mode, double temperature, const HdrCalibration& calib);
+			void clear() { this->m_entries.clear(); }
+			int getNbEntries() const { return int(this->m_entries.size()); }
+
+		private:
+			typedef std::pair<int, int> Key;
+
+			Key _key(int mode, double temperature) const;
+
+			double m_temp_step;		// *C
+			std::map<Key, HdrCalibration> m_entries;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAHDRMERGE_H
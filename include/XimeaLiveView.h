@@ -0,0 +1,109 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEALIVEVIEW_H
+#define XIMEALIVEVIEW_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+#include "lima/Timestamp.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Decimated copy of the frame stream for display clients. The grab
+		// thread publishes into a back buffer and swaps it with the front
+		// one; readers take the front buffer into their own slot, so they
+		// never hold a lock while copying and never touch Lima buffers.
+		class XIMEA_EXPORT LiveView
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "LiveView", "Ximea");
+
+		public:
+			enum Mode { Off, EveryNth, FixedRate };
+
+			struct Frame
+			{
+				int frame_nb;
+				int width;
+				int height;
+				int depth;	// bytes per pixel
+				std::vector<char> data;
+
+				Frame() : frame_nb(-1), width(0), height(0), depth(0) {}
+			};
+
+			LiveView();
+
+			void setMode(Mode mode) { this->m_mode = mode; }
+			Mode getMode() const { return this->m_mode; }
+			void setDecimation(int n);
+			int getDecimation() const { return this->m_decimation; }
+			void setRate(double rate);
+			double getRate() const { return this->m_rate; }
+			// power of two, pixels are averaged over downscale x downscale blocks
+			void setDownscale(int downscale);
+			int getDownscale() const { return this->m_downscale; }
+			void setConvert8Bit(bool convert) { this->m_convert_8bit = convert; }
+			bool getConvert8Bit() const { return this->m_convert_8bit; }
+
+			// start of acquisition; bit_depth is used for the 8 bit conversion
+			void reset(int bit_depth);
+			// cheap test, called for every frame
+			bool isDue(int frame_nb);
+			// pixel_size of data is 1, 2 or 4 bytes, unsigned
+			void publish(const void* data, int pixel_size, int width, int height, size_t stride, int frame_nb);
+			// false until a frame was published
+			bool getLatest(Frame& frame);
+
+		private:
+			Mode m_mode;
+			int m_decimation;
+			double m_rate;
+			int m_downscale;
+			bool m_convert_8bit;
+			int m_bit_depth;
+			Timestamp m_last_publish;
+			std::vector<uint64_t> m_acc;	// downscale row sums
+
+			Frame m_frames[3];
+			int m_back;
+			int m_front;
+			int m_reader;
+			bool m_fresh;
+			Mutex m_swap_mutex;
+			Mutex m_reader_mutex;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEALIVEVIEW_H
@@ -0,0 +1,80 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEANUMA_H
+#define XIMEANUMA_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// NUMA placement through sysfs and the memory policy system calls,
+		// without libnuma. Nodes are -1 when unknown; everything is a no-op
+		// on a negative node.
+		namespace Numa
+		{
+			XIMEA_EXPORT int getNbNodes();
+			// node of the PCI device found in a device path such as
+			// ".../0000:00:01.0/0000:03:00.0", -1 if none
+			XIMEA_EXPORT int getDeviceNode(const std::string& device_path);
+			// node of the CPU running the calling thread
+			XIMEA_EXPORT int getCurrentNode();
+			// node holding the page at addr
+			XIMEA_EXPORT int getMemoryNode(const void* addr);
+
+			// run the calling thread on the CPUs of node only
+			XIMEA_EXPORT bool bindThread(int node);
+			// prefer node for the pages of [addr, addr + size), moving the
+			// pages already faulted in
+			XIMEA_EXPORT bool bindMemory(void* addr, size_t size, int node);
+
+			// prefer node for the allocations of the calling thread while
+			// in scope, then restore the policy it had
+			class XIMEA_EXPORT PreferredNode
+			{
+				DEB_CLASS_NAMESPC(DebModCamera, "PreferredNode", "Ximea");
+
+			public:
+				PreferredNode(int node);
+				~PreferredNode();
+
+			private:
+				bool m_set;
+				int m_old_mode;
+				std::vector<unsigned long> m_old_mask;
+			};
+		} // namespace Numa
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEANUMA_H
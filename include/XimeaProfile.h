@@ -0,0 +1,67 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEAPROFILE_H
+#define XIMEAPROFILE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Camera settings by name, values as text, kept in the order they
+		// were set. Saved as one "<name> <value>" line per setting, lines
+		// starting with # are comments.
+		class XIMEA_EXPORT Profile
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "Profile", "Ximea");
+
+		public:
+			void clear() { this->m_values.clear(); }
+			void set(const std::string& name, const std::string& value);
+			bool get(const std::string& name, std::string& value) const;
+			int getNbValues() const { return int(this->m_values.size()); }
+
+			void load(const std::string& path);
+			void save(const std::string& path, const std::string& comment = "") const;
+
+			// same numbers, floating point ones within a relative tolerance
+			static bool sameValue(const std::string& a, const std::string& b);
+
+		private:
+			typedef std::vector<std::pair<std::string, std::string> > Values;
+			Values m_values;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEAPROFILE_H
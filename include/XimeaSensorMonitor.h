@@ -0,0 +1,121 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#ifndef XIMEASENSORMONITOR_H
+#define XIMEASENSORMONITOR_H
+
+#include <deque>
+#include <vector>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Slow changing camera state, sampled together
+		struct XIMEA_EXPORT SensorSnapshot
+		{
+			double timestamp;		// s since epoch
+			double temperature;		// selected thermometer, *C
+			double temp_chip;
+			double temp_housing;
+			double temp_back;
+			double temp_sensor;
+			bool acq_status;
+			int counter_value;		// selected counter
+
+			SensorSnapshot();
+		};
+
+		// Low priority thread sampling the camera at a fixed rate into a
+		// snapshot and a bounded history, so that readers never query the
+		// device themselves
+		class XIMEA_EXPORT SensorMonitor
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "SensorMonitor", "Ximea");
+
+		public:
+			class Sampler
+			{
+			public:
+				virtual ~Sampler() {}
+				// false if the snapshot could not be taken
+				virtual bool sample(SensorSnapshot& snapshot) = 0;
+			};
+
+			SensorMonitor(Sampler& sampler);
+			~SensorMonitor();
+
+			void start();
+			void stop();
+			bool isRunning() const { return this->m_thread != NULL; }
+
+			void setRate(double rate);			// Hz
+			double getRate() const { return this->m_rate; }
+			void setHistorySize(int size);
+			int getHistorySize() const { return this->m_history_size; }
+
+			// false until a sample was taken since start or invalidate
+			bool getSnapshot(SensorSnapshot& snapshot);
+			void getHistory(std::vector<SensorSnapshot>& history);
+			// sampled values are out of date (e.g. selector changed),
+			// sample again now
+			void invalidate();
+
+		private:
+			class MonitorThread : public Thread
+			{
+			public:
+				MonitorThread(SensorMonitor& monitor) : m_monitor(monitor) {}
+				virtual ~MonitorThread() {}
+
+			protected:
+				virtual void threadFunction();
+
+			private:
+				SensorMonitor& m_monitor;
+			};
+			friend class MonitorThread;
+
+			Sampler& m_sampler;
+			MonitorThread* m_thread;
+			Cond m_cond;
+			bool m_quit;
+			bool m_wake;
+			double m_rate;
+			int m_history_size;
+
+			bool m_valid;
+			SensorSnapshot m_snapshot;
+			std::deque<SensorSnapshot> m_history;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEASENSORMONITOR_H
@@ -0,0 +1,56 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEASIMD_H
+#define XIMEASIMD_H
+
+// AVX2 kernels are compiled with a per-function target attribute and
+// selected at runtime, so the library still loads on CPUs without AVX2
+// and no global -mavx2 flag is needed.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#	define XIMEA_HAVE_AVX2_KERNELS 1
+#	define XIMEA_TARGET_AVX2 __attribute__((target("avx2")))
+#	include <immintrin.h>
+#endif
+
+namespace lima
+{
+	namespace Ximea
+	{
+		namespace Simd
+		{
+			inline bool hasAvx2()
+			{
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+				static const bool avx2 = __builtin_cpu_supports("avx2");
+				return avx2;
+#else
+				return false;
+#endif
+			}
+		} // namespace Simd
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEASIMD_H
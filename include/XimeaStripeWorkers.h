@@ -0,0 +1,103 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEASTRIPEWORKERS_H
+#define XIMEASTRIPEWORKERS_H
+
+#include <vector>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Small pool of threads splitting per-frame processing in
+		// horizontal stripes. The calling thread processes stripes too and
+		// run() returns once the whole frame is done.
+		class XIMEA_EXPORT StripeWorkers
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "StripeWorkers", "Ximea");
+
+		public:
+			class Task
+			{
+			public:
+				virtual ~Task() {}
+				virtual void process(int first_row, int last_row) = 0;
+			};
+
+			StripeWorkers(int nb_threads = 1);
+			~StripeWorkers();
+
+			// total number of threads, including the caller of run()
+			void setNbThreads(int nb_threads);
+			int getNbThreads() const { return int(this->m_workers.size()) + 1; }
+			// workers run on the CPUs of node, -1 for any
+			void setNumaNode(int node);
+			int getNumaNode() const { return this->m_numa_node; }
+
+			void run(Task& task, int nb_rows);
+
+		private:
+			class Worker : public Thread
+			{
+			public:
+				Worker(StripeWorkers& pool) : m_pool(pool) {}
+				virtual ~Worker() {}
+
+			protected:
+				virtual void threadFunction();
+
+			private:
+				StripeWorkers& m_pool;
+			};
+			friend class Worker;
+
+			void _start_workers(int nb_threads);
+			void _stop_workers();
+			// take the next stripe of the current task, false if none left
+			bool _next_stripe(int& first_row, int& last_row);
+			void _process_stripes();
+
+			Cond m_cond;
+			std::vector<Worker*> m_workers;
+			int m_nb_running;
+			bool m_quit;
+			unsigned long m_generation;
+			int m_numa_node;
+
+			Task* m_task;
+			int m_nb_rows;
+			int m_stripe_rows;
+			int m_next_row;
+			int m_nb_busy;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEASTRIPEWORKERS_H
@@ -0,0 +1,124 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#ifndef XIMEATRIGGERDIAG_H
+#define XIMEATRIGGERDIAG_H
+
+#include <vector>
+
+#include <ximea_export.h>
+
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+	namespace Ximea
+	{
+		// Trigger timing over an acquisition, times in s. Latency runs from
+		// the trigger edge (exposure start less the trigger delay) to the
+		// frame reaching the host, readout from the exposure end; both need
+		// the camera clock mapped to the host. The period is measured on
+		// the camera clock.
+		struct XIMEA_EXPORT TriggerDiagStats
+		{
+			int nb_frames;
+			int nb_latency;			// frames with a host mapped exposure
+			double latency_min;
+			double latency_mean;
+			double latency_max;
+			double latency_jitter;	// standard deviation
+			double latency_p50;		// from the histogram
+			double latency_p99;
+			double readout_mean;
+			double readout_jitter;
+			double period_mean;
+			double period_jitter;
+			// trigger input still active at exposure start / end
+			int level_start_active;
+			int level_end_active;
+			// camera counters since the acquisition started
+			int missed_overlap;
+			int missed_buffer_full;
+
+			TriggerDiagStats();
+		};
+
+		class XIMEA_EXPORT TriggerDiag
+		{
+			DEB_CLASS_NAMESPC(DebModCamera, "TriggerDiag", "Ximea");
+
+		public:
+			static const int HISTOGRAM_BINS = 1000;
+
+			TriggerDiag();
+
+			void reset();
+			// latency histogram resolution, the last bin collects overflows
+			void setBinWidth(double width);
+			double getBinWidth();
+
+			// camera_start on the camera clock, host_start (NaN when the
+			// clocks are not synced) and arrival on the host clock; levels
+			// are 1 for active, 0 inactive and -1 unknown
+			void addFrame(double camera_start, double host_start, double exp_time, double trigger_delay,
+				double arrival, int level_start, int level_end);
+
+			// missed trigger counters are left to the caller
+			void getStats(TriggerDiagStats& stats);
+			void getHistogram(std::vector<int>& histogram);
+
+		private:
+			// running mean and variance (Welford)
+			struct Moments
+			{
+				int n;
+				double mean;
+				double m2;
+				double min;
+				double max;
+
+				Moments() { reset(); }
+				void reset();
+				void add(double x);
+				double stddev() const;
+			};
+
+			double _percentile(double p);
+
+			Mutex m_mutex;
+			double m_bin_width;
+			std::vector<int> m_histogram;
+			Moments m_latency;
+			Moments m_readout;
+			Moments m_period;
+			int m_nb_frames;
+			int m_level_start_active;
+			int m_level_end_active;
+			double m_last_camera_start;
+		};
+	} // namespace Ximea
+} // namespace lima
+
+#endif // XIMEATRIGGERDIAG_H
@@ -0,0 +1,150 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cstring>
+
+#include "XimeaAccumulate.h"
+#include "XimeaSimd.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+namespace
+{
+	template <typename T>
+	void _accumulate_row(uint32_t* dst, const T* src, int n, bool first)
+	{
+		if(first)
+			for(int i = 0; i < n; ++i)
+				dst[i] = src[i];
+		else
+			for(int i = 0; i < n; ++i)
+				dst[i] += src[i];
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	XIMEA_TARGET_AVX2 inline void _store_sum_avx2(uint32_t* dst, __m256i v, bool first)
+	{
+		if(!first)
+			v = _mm256_add_epi32(v, _mm256_loadu_si256((const __m256i*)dst));
+		_mm256_storeu_si256((__m256i*)dst, v);
+	}
+
+	XIMEA_TARGET_AVX2 void _accumulate_row_avx2(uint32_t* dst, const uint16_t* src, int n, bool first)
+	{
+		int i = 0;
+		for(; i + 16 <= n; i += 16)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+			_store_sum_avx2(dst + i, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)), first);
+			_store_sum_avx2(dst + i + 8, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)), first);
+		}
+		_accumulate_row(dst + i, src + i, n - i, first);
+	}
+
+	XIMEA_TARGET_AVX2 void _accumulate_row_avx2(uint32_t* dst, const uint8_t* src, int n, bool first)
+	{
+		int i = 0;
+		for(; i + 32 <= n; i += 32)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+			__m128i lo = _mm256_castsi256_si128(v);
+			__m128i hi = _mm256_extracti128_si256(v, 1);
+			_store_sum_avx2(dst + i, _mm256_cvtepu8_epi32(lo), first);
+			_store_sum_avx2(dst + i + 8, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)), first);
+			_store_sum_avx2(dst + i + 16, _mm256_cvtepu8_epi32(hi), first);
+			_store_sum_avx2(dst + i + 24, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)), first);
+		}
+		_accumulate_row(dst + i, src + i, n - i, first);
+	}
+
+	XIMEA_TARGET_AVX2 void _accumulate_row_avx2(uint32_t* dst, const uint32_t* src, int n, bool first)
+	{
+		int i = 0;
+		for(; i + 8 <= n; i += 8)
+			_store_sum_avx2(dst + i, _mm256_loadu_si256((const __m256i*)(src + i)), first);
+		_accumulate_row(dst + i, src + i, n - i, first);
+	}
+#endif
+
+	template <typename T>
+	void _accumulate(uint32_t* dst, const T* src, int n, bool first)
+	{
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+		if(Simd::hasAvx2())
+		{
+			_accumulate_row_avx2(dst, src, n, first);
+			return;
+		}
+#endif
+		_accumulate_row(dst, src, n, first);
+	}
+
+	class AccumulateTask : public StripeWorkers::Task
+	{
+	public:
+		AccumulateTask(uint32_t* dst, const void* src, int pixel_size, int width, size_t src_stride, bool first)
+			: m_dst(dst), m_src((const char*)src), m_pixel_size(pixel_size), m_width(width),
+			  m_src_stride(src_stride), m_first(first)
+		{
+		}
+
+		virtual void process(int first_row, int last_row)
+		{
+			for(int y = first_row; y < last_row; ++y)
+			{
+				uint32_t* dst = this->m_dst + size_t(y) * this->m_width;
+				const char* src = this->m_src + y * this->m_src_stride;
+				switch(this->m_pixel_size)
+				{
+					case 1:
+						_accumulate(dst, (const uint8_t*)src, this->m_width, this->m_first);
+						break;
+					case 2:
+						_accumulate(dst, (const uint16_t*)src, this->m_width, this->m_first);
+						break;
+					case 4:
+						_accumulate(dst, (const uint32_t*)src, this->m_width, this->m_first);
+						break;
+				}
+			}
+		}
+
+	private:
+		uint32_t* m_dst;
+		const char* m_src;
+		int m_pixel_size;
+		int m_width;
+		size_t m_src_stride;
+		bool m_first;
+	};
+} // namespace
+
+void lima::Ximea::accumulateFrame(uint32_t* dst, const void* src, int pixel_size, int width, int height,
+	size_t src_stride, bool first, StripeWorkers& workers)
+{
+	AccumulateTask task(dst, src, pixel_size, width, src_stride, first);
+	workers.run(task, height);
+}
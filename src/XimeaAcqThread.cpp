@@ -20,19 +20,46 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //###########################################################################
 
+#include <algorithm>
+
 #include "XimeaAcqThread.h"
 
 using namespace lima;
 using namespace lima::Ximea;
 
+// raw frames waiting for or in the demosaic thread
+#define DEMOSAIC_SLOTS	4
+
+// consecutive read timeouts making a missing trigger worth an event when
+// no trigger period is set
+#define TRIGGER_TIMEOUTS	10
+
 AcqThread::AcqThread(Camera& cam, int timeout)
 	: m_cam(cam),
 	  m_quit(false),
 	  m_timeout(timeout),
-	  m_thread_started(false)
+	  m_thread_started(false),
+	  m_first_frame(true),
+	  m_last_nframe(0),
+	  m_last_acq_nframe(0),
+	  m_demosaic_thread(*this)
 {
 	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
 	memset((void*)&this->m_buffer, 0, sizeof(XI_IMG));
+
+	// pre-trigger frames plus the one carrying the event; allocated
+	// (and zeroed) here so that no page fault hits the grab loop
+	if(cam.m_pretrigger_mode)
+	{
+		this->m_ring.resize(size_t(cam.m_pretrigger_frames + 1) * cam.m_buffer_size);
+		this->m_ring_metadata.resize(cam.m_pretrigger_frames + 1);
+	}
+	// same for the sensor frame when Lima buffers hold sums, merges or
+	// conversions
+	if(cam.m_accumulation_frames > 1 || cam.m_hdr_enabled || cam.m_format_convert)
+		this->m_sensor_frame.resize(cam.m_sensor_frame_size);
+	if(cam.m_demosaic_enabled)
+		this->m_raw_ring.resize(size_t(DEMOSAIC_SLOTS) * cam.m_sensor_frame_size);
 }
 
 AcqThread::~AcqThread()
@@ -40,19 +67,301 @@ AcqThread::~AcqThread()
 	this->m_quit = true;
 }
 
+AcqThread::DemosaicThread::DemosaicThread(AcqThread& acq)
+	: m_acq(acq),
+	  m_next_slot(0),
+	  m_stop(false),
+	  m_done(false),
+	  m_failed(false)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+AcqThread::DemosaicThread::~DemosaicThread()
+{
+	this->drain();
+}
+
+void* AcqThread::DemosaicThread::getSlot()
+{
+	AutoMutex lock(this->m_cond.mutex());
+	// jobs are done in order, the oldest slot is the first freed
+	while(this->m_jobs.size() >= DEMOSAIC_SLOTS && !this->m_failed)
+		this->m_cond.wait();
+	if(this->m_failed)
+		return NULL;
+	size_t slot = this->m_next_slot++ % DEMOSAIC_SLOTS;
+	return &this->m_acq.m_raw_ring[slot * this->m_acq.m_cam.m_sensor_frame_size];
+}
+
+void AcqThread::DemosaicThread::push(const XI_IMG& image, const HwFrameInfoType& frame_info, bool valid)
+{
+	Job job;
+	job.image = image;
+	job.frame_info = frame_info;
+	job.valid = valid;
+
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_jobs.push_back(job);
+	this->m_cond.broadcast();
+}
+
+void AcqThread::DemosaicThread::drain()
+{
+	if(!this->hasStarted())
+		return;
+
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_stop = true;
+	this->m_cond.broadcast();
+	while(!this->m_done)
+		this->m_cond.wait();
+}
+
+void AcqThread::DemosaicThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+
+	Camera& cam = this->m_acq.m_cam;
+	// next to the grab thread and the frame buffers
+	Numa::bindThread(cam.m_numa_placement_node);
+	StdBufferCbMgr& buffer_mgr = cam.m_buffer_ctrl_obj.getBuffer();
+
+	AutoMutex lock(this->m_cond.mutex());
+	while(!this->m_failed)
+	{
+		if(this->m_jobs.empty())
+		{
+			if(this->m_stop)
+				break;
+			this->m_cond.wait();
+			continue;
+		}
+		// the slot stays in use until the job is popped
+		Job job = this->m_jobs.front();
+		lock.unlock();
+
+		if(job.valid)
+			cam._demosaic_frame(&job.image, buffer_mgr.getFrameBufferPtr(job.frame_info.acq_frame_nb));
+		bool ok = buffer_mgr.newFrameReady(job.frame_info);
+		DEB_TRACE() << DEB_VAR2(job.frame_info.acq_frame_nb, ok);
+		if(!ok)
+		{
+			cam._set_status(Camera::Fault);
+			cam._report_event(EventQueue::Record(EventQueue::Error, EventQueue::FrameNotReady, "Ximea/AcqThread/newFrameReady"));
+		}
+
+		lock.lock();
+		this->m_jobs.pop_front();
+		this->m_failed = !ok;
+		this->m_cond.broadcast();
+	}
+	this->m_done = true;
+	this->m_cond.broadcast();
+}
+
+bool AcqThread::_read_frame()
+{
+	this->m_cam._set_status(Camera::Exposure);
+	int nb_timeouts = 0;
+	while(true)
+	{
+		this->m_cam._read_image(&this->m_buffer, this->m_timeout);
+		if(this->m_quit)
+			return false;
+		if(this->m_cam.xi_status != XI_TIMEOUT)
+			break;
+		if(this->_timeout_overdue(++nb_timeouts))
+			this->m_cam._report_event(EventQueue::Timeout, "Image read timed out");
+	}
+	if(this->m_cam.xi_status == XI_OK)
+	{
+		++this->m_cam.m_sdk_frames_read;
+		this->m_cam._sample_sdk_queue(this->m_sdk_queue_sample_time);
+		if(this->m_cam.m_trigger_diag_active)
+			this->m_cam._record_trigger_diag(&this->m_buffer);
+		this->_check_frame_gap();
+	}
+	return true;
+}
+
+bool AcqThread::_timeout_overdue(int nb_timeouts)
+{
+	// free running, the frame is late
+	TrigMode mode = this->m_cam.m_trigger_mode;
+	if(mode == IntTrig)
+		return true;
+
+	// triggered: waiting is normal until the trigger is overdue; the
+	// software trigger of IntTrigMult is waited for before the read
+	double waited = nb_timeouts * this->m_timeout * 1e-3;
+	double period = this->m_cam.m_trigger_period;
+	if(mode == ExtTrigMult && period > 0)
+		return waited > period;
+	return nb_timeouts % TRIGGER_TIMEOUTS == 0;
+}
+
+void AcqThread::_check_frame_gap()
+{
+	// acq_nframe counts frames reaching the host, nframe the ones sent by
+	// the camera; nframe restarts on some parameter changes
+	unsigned int nframe = this->m_buffer.nframe;
+	unsigned int acq_nframe = this->m_buffer.acq_nframe;
+	if(!this->m_first_frame)
+	{
+		long overrun = long(acq_nframe) - long(this->m_last_acq_nframe) - 1;
+		long lost = long(nframe) - long(this->m_last_nframe) - 1 - std::max(overrun, 0L);
+		if(overrun > 0)
+			this->m_cam._report_event(EventQueue::QueueOverrun, "Frames discarded by the SDK queue", overrun);
+		if(lost > 0 && nframe > this->m_last_nframe)
+			this->m_cam._report_event(EventQueue::DroppedFrames, "Frames lost before the host", lost);
+	}
+	this->m_first_frame = false;
+	this->m_last_nframe = nframe;
+	this->m_last_acq_nframe = acq_nframe;
+}
+
+void AcqThread::_process_frame(Timestamp& last_frame_time)
+{
+	// run on the frame while it is still in cache
+	Timestamp now = Timestamp::now();
+	double frame_period = last_frame_time.isSet() ? double(now - last_frame_time) : 0;
+	last_frame_time = now;
+	if(this->m_cam.m_correction_enabled)
+		this->m_cam._apply_correction(&this->m_buffer);
+	bool auto_exposure = this->m_cam._auto_exposure_active();
+	if(this->m_cam.m_stats_enabled || auto_exposure)
+	{
+		FrameStats stats;
+		if(this->m_cam._update_frame_stats(&this->m_buffer, frame_period, stats) && auto_exposure)
+			this->m_cam._update_auto_exposure(&this->m_buffer, stats);
+	}
+	// queued exposure / gain, in effect from one of the next frames
+	if(this->m_cam.m_params_pending)
+		this->m_cam._apply_pending_params();
+}
+
+bool AcqThread::_run_pretrigger(StdBufferCbMgr& buffer_mgr, Timestamp& last_frame_time)
+{
+	DEB_MEMBER_FUNCT();
+
+	Camera& cam = this->m_cam;
+	size_t frame_size = cam.m_buffer_size;
+	int nb_slots = cam.m_pretrigger_frames + 1;
+
+	// GPI_level of XI_IMG has one bit per input, GPI 1 being bit 0
+	bool gpi = cam.m_pretrigger_source == Camera::PreTriggerSource_Gpi;
+	unsigned int gpi_mask = 1u << (cam.m_trigger_gpi_port - 1);
+	bool active_level = cam.m_trig_polarity == Camera::TriggerPolarity_High_Rising;
+	int last_level = -1;
+
+	int nb_read = 0;
+	while(true)
+	{
+		// software event raised before this frame was read: it is the first
+		// post-trigger frame
+		bool fired = !gpi && cam.m_pretrigger_fired;
+
+		this->m_buffer.bp = &this->m_ring[(nb_read % nb_slots) * frame_size];
+		this->m_buffer.bp_size = frame_size;
+		if(!this->_read_frame())
+			return false;
+		if(cam.xi_status != XI_OK)
+		{
+			cam._set_status(Camera::Fault);
+			EventQueue::Record event(EventQueue::Error, EventQueue::ReadFailed, "Ximea/Camera/_read_image");
+			event.status = cam.xi_status;
+			cam._report_event(event);
+			continue;
+		}
+		this->_process_frame(last_frame_time);
+		cam._fill_frame_metadata(&this->m_buffer, this->m_ring_metadata[nb_read % nb_slots]);
+
+		if(gpi)
+		{
+			int level = (this->m_buffer.GPI_level & gpi_mask) ? 1 : 0;
+			fired = last_level >= 0 && level != last_level && bool(level) == active_level;
+			last_level = level;
+		}
+		if(fired)
+			break;
+		++nb_read;
+	}
+
+	// commit the ring, oldest first, then the event frame
+	cam._set_status(Camera::Readout);
+	int nb_pre = std::min(nb_read, cam.m_pretrigger_frames);
+	cam.m_pretrigger_event_frame = nb_pre;
+	for(int n = nb_read - nb_pre; n <= nb_read; ++n)
+	{
+		if(cam.m_nb_frames && cam.m_image_number >= cam.m_nb_frames)
+			break;
+
+		memcpy(buffer_mgr.getFrameBufferPtr(cam.m_image_number), &this->m_ring[(n % nb_slots) * frame_size], frame_size);
+		FrameMetadata& metadata = this->m_ring_metadata[n % nb_slots];
+		metadata.frame_nb = cam.m_image_number;
+		cam._store_frame_metadata(metadata);
+		HwFrameInfoType frame_info;
+		frame_info.acq_frame_nb = cam.m_image_number;
+		cam._host_timestamp(metadata.ts_sec, metadata.ts_usec, frame_info.frame_timestamp);
+		if(!buffer_mgr.newFrameReady(frame_info))
+		{
+			cam._set_status(Camera::Fault);
+			cam._report_event(EventQueue::Record(EventQueue::Error, EventQueue::FrameNotReady, "Ximea/AcqThread/newFrameReady"));
+			return false;
+		}
+		++cam.m_image_number;
+	}
+	DEB_TRACE() << "Pre-trigger event after " << nb_read << " frames, " << nb_pre << " committed";
+	cam._set_status(Camera::Ready);
+	return true;
+}
+
 void AcqThread::threadFunction()
 {
 	DEB_MEMBER_FUNCT();
 	this->m_thread_started = true;
 
+	// next to the camera and the frame buffers
+	Numa::bindThread(this->m_cam.m_numa_placement_node);
+	this->m_cam.m_numa_acq_thread_node = Numa::getCurrentNode();
+
 	StdBufferCbMgr& buffer_mgr = this->m_cam.m_buffer_ctrl_obj.getBuffer();
 
 	bool continueAcq = true;
+	Timestamp last_frame_time;
+	if(this->m_cam.m_pretrigger_mode && !this->_run_pretrigger(buffer_mgr, last_frame_time))
+		this->m_quit = true;
+
+	bool accumulate = this->m_cam.m_accumulation_frames > 1;
+	bool hdr = this->m_cam.m_hdr_enabled;
+	bool demosaic = this->m_cam.m_demosaic_enabled;
+	bool convert = this->m_cam.m_format_convert;
+	if(demosaic)
+		this->m_demosaic_thread.start();
+	int nb_accumulated = 0;
 	while(!this->m_quit && (this->m_cam.m_nb_frames == 0 || this->m_cam.m_image_number < this->m_cam.m_nb_frames))
 	{
 		// set up acq buffers
-		this->m_buffer.bp = buffer_mgr.getFrameBufferPtr(this->m_cam.m_image_number);
-		this->m_buffer.bp_size = this->m_cam.m_buffer_size;
+		void* frame_ptr = buffer_mgr.getFrameBufferPtr(this->m_cam.m_image_number);
+		if(accumulate || hdr || convert)
+		{
+			this->m_buffer.bp = &this->m_sensor_frame[0];
+			this->m_buffer.bp_size = this->m_sensor_frame.size();
+		}
+		else if(demosaic)
+		{
+			// NULL once Lima refused a frame, already reported
+			this->m_buffer.bp = this->m_demosaic_thread.getSlot();
+			if(!this->m_buffer.bp)
+				break;
+			this->m_buffer.bp_size = this->m_cam.m_sensor_frame_size;
+		}
+		else
+		{
+			this->m_buffer.bp = frame_ptr;
+			this->m_buffer.bp_size = this->m_cam.m_buffer_size;
+		}
 
 		bool do_break = false;
 
@@ -70,24 +379,64 @@ void AcqThread::threadFunction()
 				break;
 		}
 		
-		this->m_cam._set_status(Camera::Exposure);
-		do
+		// settings of this frame's sequence step, then its trigger
+		if(this->m_cam.m_sequence_active)
+			this->m_cam._apply_sequence_step(this->m_cam.m_image_number, this->m_cam.m_sequence_soft_trigger);
+
+		if(!this->_read_frame() || this->m_quit)
+			break;
+
+		if(this->m_cam.xi_status == XI_OK)
 		{
-			this->m_cam._read_image(&this->m_buffer, this->m_timeout);
-			if(this->m_quit)
+			this->_process_frame(last_frame_time);
+			if(accumulate)
 			{
-				do_break = true;
-				break;
+				this->m_cam._accumulate_frame(&this->m_buffer, frame_ptr, this->m_cam.m_image_number, nb_accumulated == 0);
+				if(++nb_accumulated < this->m_cam.m_accumulation_frames)
+					continue;
 			}
+			else if(hdr)
+				this->m_cam._merge_hdr(&this->m_buffer, frame_ptr);
+			else if(convert)
+				this->m_cam._convert_frame(&this->m_buffer, frame_ptr);
+			if(this->m_cam.m_live_view.isDue(this->m_cam.m_image_number))
+			{
+				// the sum or merged frame, not the last sensor frame read
+				if(accumulate || hdr)
+					this->m_cam._publish_live_view(frame_ptr, this->m_buffer.width, this->m_buffer.height,
+						this->m_cam.m_image_number);
+				else
+					this->m_cam._publish_live_view(&this->m_buffer, this->m_cam.m_image_number);
+			}
+			FrameMetadata metadata;
+			this->m_cam._fill_frame_metadata(&this->m_buffer, metadata);
+			metadata.frame_nb = this->m_cam.m_image_number;
+			if(this->m_cam.m_sequence_active)
+				this->m_cam._check_sequence_step(metadata);
+			this->m_cam._store_frame_metadata(metadata);
 		}
-		while(this->m_cam.xi_status == XI_TIMEOUT);
-		if(do_break || this->m_quit)
-			break;
+		else if(accumulate)
+		{
+			// a sum missing a sensor frame never reaches Lima, it starts
+			// over into the same buffer
+			this->m_cam._report_event(EventQueue::DroppedFrames, "Accumulated frame restarted after a failed read",
+				nb_accumulated + 1);
+			nb_accumulated = 0;
+			continue;
+		}
+		nb_accumulated = 0;
 		
 		this->m_cam._set_status(Camera::Readout);
 		HwFrameInfoType frame_info;
 		frame_info.acq_frame_nb = this->m_cam.m_image_number;
-		continueAcq = buffer_mgr.newFrameReady(frame_info);
+		// camera exposure time on the host clock, else Lima stamps the
+		// frame on arrival
+		if(this->m_cam.xi_status == XI_OK)
+			this->m_cam._host_timestamp(this->m_buffer.tsSec, this->m_buffer.tsUSec, frame_info.frame_timestamp);
+		if(demosaic)
+			this->m_demosaic_thread.push(this->m_buffer, frame_info, this->m_cam.xi_status == XI_OK);
+		else
+			continueAcq = buffer_mgr.newFrameReady(frame_info);
 		DEB_TRACE() << DEB_VAR1(continueAcq);
 		++this->m_cam.m_image_number;
 
@@ -100,19 +449,24 @@ void AcqThread::threadFunction()
 		if(!continueAcq)
 		{
 			this->m_cam._set_status(Camera::Fault);
-			Exception e = LIMA_CTL_EXC(Error, "Frame not ready");
-			this->m_cam.reportException(e, "Ximea/AcqThread/newFrameReady");
+			this->m_cam._report_event(EventQueue::Record(EventQueue::Error, EventQueue::FrameNotReady, "Ximea/AcqThread/newFrameReady"));
 			break;
 		}
 		if(this->m_cam.xi_status != XI_OK)
 		{
 			this->m_cam._set_status(Camera::Fault);
-			Exception e = LIMA_HW_EXC(Error, "Image read failed, status: " + std::to_string(this->m_cam.xi_status));
-			this->m_cam.reportException(e, "Ximea/Camera/_read_image");
+			EventQueue::Record event(EventQueue::Error, EventQueue::ReadFailed, "Ximea/Camera/_read_image");
+			event.status = this->m_cam.xi_status;
+			this->m_cam._report_event(event);
 			continue;
 		}
 		this->m_cam._set_status(Camera::Ready);
 	}
 	// when leaving the thread stop acqusition no matter what
 	xiStopAcquisition(this->m_cam.xiH);
+	// frames already read still reach Lima
+	this->m_demosaic_thread.drain();
+	if(this->m_cam.m_sequence_active)
+		this->m_cam._end_sequence();
+	this->m_cam.m_sidecar.close();
 }
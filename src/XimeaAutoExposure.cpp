@@ -0,0 +1,161 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cmath>
+#include <algorithm>
+
+#include "XimeaAutoExposure.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+// frames to wait for a new exposure to show up in XI_IMG before giving up
+#define MAX_PENDING_FRAMES	3
+
+AutoExposure::Params::Params()
+	: percentile(0.99),
+	  target_level(0.7),
+	  max_saturation(0.001),
+	  tolerance(0.05),
+	  max_step(4),
+	  min_exp_time(1e-5),
+	  max_exp_time(1),
+	  max_gain(0)
+{
+}
+
+AutoExposure::AutoExposure()
+{
+	this->reset();
+}
+
+void AutoExposure::setParams(const Params& params)
+{
+	this->m_params = params;
+	this->m_params.max_step = std::max(1.01, params.max_step);
+	this->reset();
+}
+
+void AutoExposure::reset()
+{
+	this->m_nb_frames = 0;
+	this->m_convergence_frames = -1;
+	this->m_level = 0;
+	this->m_saturation = 0;
+	this->m_pending_exp_time = 0;
+	this->m_pending_frames = 0;
+}
+
+void AutoExposure::_measure(const FrameStats& stats)
+{
+	++this->m_nb_frames;
+	if(!stats.nb_pixels)
+		return;
+
+	// histogram bin holding the requested percentile, upper edge
+	double threshold = this->m_params.percentile * stats.nb_pixels;
+	double count = 0;
+	int bin = 0;
+	for(; bin < FrameStats::HISTOGRAM_BINS - 1; ++bin)
+	{
+		count += stats.histogram[bin];
+		if(count >= threshold)
+			break;
+	}
+	this->m_level = double(bin + 1) / FrameStats::HISTOGRAM_BINS;
+	this->m_saturation = double(stats.histogram[FrameStats::HISTOGRAM_BINS - 1]) / stats.nb_pixels;
+
+	if(this->m_convergence_frames < 0 && this->_is_on_target())
+		this->m_convergence_frames = this->m_nb_frames;
+}
+
+bool AutoExposure::_is_on_target() const
+{
+	if(this->m_saturation > this->m_params.max_saturation)
+		return false;
+	return std::fabs(this->m_level - this->m_params.target_level) <= this->m_params.tolerance * this->m_params.target_level;
+}
+
+void AutoExposure::track(const FrameStats& stats)
+{
+	this->_measure(stats);
+}
+
+bool AutoExposure::update(const FrameStats& stats, double exp_time, double gain, double& new_exp_time, double& new_gain)
+{
+	this->_measure(stats);
+
+	// a change is in flight: frames still carry the previous exposure
+	if(this->m_pending_exp_time > 0)
+	{
+		bool applied = std::fabs(exp_time - this->m_pending_exp_time) <= 0.01 * this->m_pending_exp_time;
+		if(!applied && this->m_pending_frames < MAX_PENDING_FRAMES)
+		{
+			++this->m_pending_frames;
+			return false;
+		}
+		this->m_pending_exp_time = 0;
+	}
+
+	if(this->_is_on_target())
+		return false;
+
+	const Params& p = this->m_params;
+	double ratio;
+	if(this->m_saturation > p.max_saturation)
+		// percentile is meaningless once clipped, back off by a fixed step
+		ratio = 0.5;
+	else
+		ratio = p.target_level / std::max(this->m_level, 1. / FrameStats::HISTOGRAM_BINS);
+	ratio = std::min(p.max_step, std::max(1 / p.max_step, ratio));
+
+	double e = exp_time;
+	double g = gain;
+
+	// when darkening, drop gain before shortening the exposure
+	if(ratio < 1 && g > 0)
+	{
+		double g_new = std::max(0., g + 20 * std::log10(ratio));
+		ratio /= std::pow(10, (g_new - g) / 20);
+		g = g_new;
+	}
+
+	e *= ratio;
+	if(e > p.max_exp_time)
+	{
+		g = std::min(p.max_gain, g + 20 * std::log10(e / p.max_exp_time));
+		e = p.max_exp_time;
+	}
+	e = std::max(p.min_exp_time, e);
+
+	new_exp_time = e;
+	new_gain = g;
+	if(e == exp_time && g == gain)
+		// stuck at a limit
+		return false;
+
+	this->m_pending_exp_time = e;
+	this->m_pending_frames = 0;
+	return true;
+}
@@ -0,0 +1,371 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include <stdint.h>
+
+#include "lima/Exceptions.h"
+#include "XimeaBenchmark.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+using namespace std;
+
+// frame differences cancel the fixed pattern, the first frames are
+// needed to measure the rate
+#define BENCHMARK_MIN_FRAMES	3
+
+BenchmarkPoint::BenchmarkPoint()
+	: mode(0),
+	  bit_depth(0)
+{
+}
+
+BenchmarkPoint::BenchmarkPoint(int mode, const Roi& roi, int bit_depth)
+	: mode(mode),
+	  roi(roi),
+	  bit_depth(bit_depth)
+{
+}
+
+BenchmarkResult::BenchmarkResult()
+	: ok(false),
+	  width(0),
+	  height(0),
+	  frame_rate(0),
+	  readout_time(0),
+	  dark_mean(0),
+	  dark_noise(0),
+	  dynamic_range(0),
+	  bandwidth(0),
+	  bandwidth_use(0)
+{
+}
+
+namespace
+{
+	// frame sum, and sum and sum of squares of its difference to the
+	// previous frame, which replaces it in prev
+	template <typename T>
+	void _summarise(const Benchmark::Backend::Frame& frame, vector<double>& prev, bool first,
+		double& sum, double& diff_sum, double& diff_sum2)
+	{
+		sum = diff_sum = diff_sum2 = 0;
+		for(int y = 0; y < frame.height; ++y)
+		{
+			const T* row = (const T*)((const char*)frame.data + y * frame.stride);
+			double* p = &prev[size_t(y) * frame.width];
+			for(int x = 0; x < frame.width; ++x)
+			{
+				double v = row[x];
+				sum += v;
+				if(!first)
+				{
+					double d = v - p[x];
+					diff_sum += d;
+					diff_sum2 += d * d;
+				}
+				p[x] = v;
+			}
+		}
+	}
+
+	string _json_string(const string& s)
+	{
+		string out = "\"";
+		for(string::const_iterator it = s.begin(); it != s.end(); ++it)
+		{
+			if(*it == '"' || *it == '\\')
+				out += '\\';
+			out += (*it == '\n') ? ' ' : *it;
+		}
+		return out + "\"";
+	}
+} // namespace
+
+Benchmark::Benchmark()
+	: m_nb_frames(20)
+{
+}
+
+void Benchmark::setNbFrames(int n)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(n);
+
+	if(n < BENCHMARK_MIN_FRAMES)
+		THROW_HW_ERROR(InvalidValue) << "At least " << BENCHMARK_MIN_FRAMES << " frames per point are needed";
+	this->m_nb_frames = n;
+}
+
+void Benchmark::getPoints(Backend& backend, const vector<int>& modes, const vector<Roi>& rois,
+	const vector<int>& bit_depths, vector<BenchmarkPoint>& points)
+{
+	vector<int> all_modes = modes;
+	if(all_modes.empty())
+		backend.getModes(all_modes);
+	vector<Roi> all_rois = rois;
+	if(all_rois.empty())
+		all_rois.push_back(Roi());
+
+	points.clear();
+	for(vector<int>::const_iterator m = all_modes.begin(); m != all_modes.end(); ++m)
+		for(vector<Roi>::const_iterator r = all_rois.begin(); r != all_rois.end(); ++r)
+			for(vector<int>::const_iterator b = bit_depths.begin(); b != bit_depths.end(); ++b)
+				points.push_back(BenchmarkPoint(*m, *r, *b));
+}
+
+void Benchmark::run(Backend& backend, const vector<BenchmarkPoint>& points)
+{
+	DEB_MEMBER_FUNCT();
+
+	this->m_results.clear();
+	for(vector<BenchmarkPoint>::const_iterator it = points.begin(); it != points.end(); ++it)
+	{
+		BenchmarkResult result;
+		result.point = *it;
+		try
+		{
+			this->_measure(backend, result);
+			result.ok = true;
+		}
+		catch(Exception& e)
+		{
+			result.error = e.getErrMsg();
+			DEB_WARNING() << "Mode " << it->mode << ", " << it->bit_depth << " bits not measured: " << result.error;
+		}
+		this->m_results.push_back(result);
+	}
+}
+
+void Benchmark::_measure(Backend& backend, BenchmarkResult& result)
+{
+	DEB_MEMBER_FUNCT();
+
+	backend.configure(result.point);
+	double exp_time = backend.getExposureTime();
+	double link_bandwidth = backend.getLinkBandwidth();
+
+	vector<double> prev;
+	vector<double> periods;
+	double sum = 0, diff_var = 0;
+	double first_ts = 0, last_ts = 0;
+	int pixel_size = 0;
+	backend.start();
+	try
+	{
+		for(int i = 0; i < this->m_nb_frames; ++i)
+		{
+			Backend::Frame frame;
+			backend.readFrame(frame);
+			if(!i)
+			{
+				result.width = frame.width;
+				result.height = frame.height;
+				pixel_size = frame.pixel_size;
+				first_ts = frame.timestamp;
+				prev.resize(size_t(frame.width) * frame.height);
+			}
+			else if(frame.width != result.width || frame.height != result.height)
+				THROW_HW_ERROR(Error) << "Frame size changed during the measurement";
+			else
+				periods.push_back(frame.timestamp - last_ts);
+			last_ts = frame.timestamp;
+
+			double frame_sum, diff_sum, diff_sum2;
+			switch(frame.pixel_size)
+			{
+				case 1:
+					_summarise<uint8_t>(frame, prev, !i, frame_sum, diff_sum, diff_sum2);
+					break;
+				case 2:
+					_summarise<uint16_t>(frame, prev, !i, frame_sum, diff_sum, diff_sum2);
+					break;
+				case 4:
+					_summarise<uint32_t>(frame, prev, !i, frame_sum, diff_sum, diff_sum2);
+					break;
+				default:
+					THROW_HW_ERROR(Error) << "Unsupported pixel size " << frame.pixel_size;
+			}
+			double nb_pixels = double(prev.size());
+			sum += frame_sum;
+			if(i)
+				diff_var += diff_sum2 / nb_pixels - (diff_sum / nb_pixels) * (diff_sum / nb_pixels);
+		}
+	}
+	catch(Exception& e)
+	{
+		backend.stop();
+		throw;
+	}
+	backend.stop();
+
+	if(last_ts <= first_ts)
+		THROW_HW_ERROR(Error) << "Frame timestamps do not increase";
+
+	double nb_pixels = double(result.width) * result.height;
+	result.frame_rate = (this->m_nb_frames - 1) / (last_ts - first_ts);
+	// the median ignores the odd frame the host was late for
+	nth_element(periods.begin(), periods.begin() + periods.size() / 2, periods.end());
+	result.readout_time = std::max(periods[periods.size() / 2] - exp_time, 0.);
+	result.dark_mean = sum / (nb_pixels * this->m_nb_frames);
+	// a difference of two frames has twice the temporal variance
+	result.dark_noise = sqrt(diff_var / (this->m_nb_frames - 1) / 2);
+	double full_scale = ldexp(1., result.point.bit_depth) - 1;
+	if(result.dark_noise > 0 && full_scale > result.dark_mean)
+		result.dynamic_range = 20 * log10((full_scale - result.dark_mean) / result.dark_noise);
+	result.bandwidth = result.frame_rate * nb_pixels * pixel_size / 1e6;
+	result.bandwidth_use = link_bandwidth > 0 ? result.bandwidth / link_bandwidth : 0;
+
+	DEB_TRACE() << DEB_VAR4(result.point.mode, result.frame_rate, result.dark_noise, result.bandwidth);
+}
+
+void Benchmark::writeReport(const string& path) const
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(path);
+
+	ofstream f(path.c_str());
+	if(!f)
+		THROW_HW_ERROR(Error) << "Could not write benchmark report " << path;
+
+	f.precision(9);
+	f << "{\n  \"nb_frames\": " << this->m_nb_frames << ",\n  \"results\": [";
+	for(vector<BenchmarkResult>::const_iterator it = this->m_results.begin(); it != this->m_results.end(); ++it)
+	{
+		const BenchmarkResult& r = *it;
+		const Roi& roi = r.point.roi;
+		f << (it == this->m_results.begin() ? "\n" : ",\n")
+		  << "    {\"mode\": " << r.point.mode
+		  << ", \"roi\": [" << roi.getTopLeft().x << ", " << roi.getTopLeft().y << ", "
+		  << roi.getSize().getWidth() << ", " << roi.getSize().getHeight() << "]"
+		  << ", \"bit_depth\": " << r.point.bit_depth
+		  << ", \"ok\": " << (r.ok ? "true" : "false")
+		  << ", \"error\": " << _json_string(r.error)
+		  << ", \"width\": " << r.width
+		  << ", \"height\": " << r.height
+		  << ", \"frame_rate\": " << r.frame_rate
+		  << ", \"readout_time\": " << r.readout_time
+		  << ", \"dark_mean\": " << r.dark_mean
+		  << ", \"dark_noise\": " << r.dark_noise
+		  << ", \"dynamic_range\": " << r.dynamic_range
+		  << ", \"bandwidth\": " << r.bandwidth
+		  << ", \"bandwidth_use\": " << r.bandwidth_use << "}";
+	}
+	f << "\n  ]\n}\n";
+	if(!f)
+		THROW_HW_ERROR(Error) << "Could not write benchmark report " << path;
+}
+
+SimulatedBenchmarkBackend::SimulatedBenchmarkBackend(int width, int height, double link_bandwidth)
+	: m_width(width),
+	  m_height(height),
+	  m_link_bandwidth(link_bandwidth),
+	  m_mode(NULL),
+	  m_bit_depth(0),
+	  m_time(0)
+{
+}
+
+void SimulatedBenchmarkBackend::addMode(int mode, double line_time, double dark_offset, double dark_noise)
+{
+	Mode m = {mode, line_time, dark_offset, dark_noise};
+	this->m_modes.push_back(m);
+}
+
+void SimulatedBenchmarkBackend::getModes(vector<int>& modes)
+{
+	modes.clear();
+	for(vector<Mode>::const_iterator it = this->m_modes.begin(); it != this->m_modes.end(); ++it)
+		modes.push_back(it->mode);
+}
+
+void SimulatedBenchmarkBackend::configure(const BenchmarkPoint& point)
+{
+	DEB_MEMBER_FUNCT();
+
+	this->m_mode = NULL;
+	for(vector<Mode>::const_iterator it = this->m_modes.begin(); it != this->m_modes.end(); ++it)
+		if(it->mode == point.mode)
+			this->m_mode = &*it;
+	if(!this->m_mode)
+		THROW_HW_ERROR(InvalidValue) << "Unknown mode " << point.mode;
+	if(point.bit_depth < 8 || point.bit_depth > 16)
+		THROW_HW_ERROR(InvalidValue) << "Unsupported bit depth " << point.bit_depth;
+
+	this->m_roi = point.roi.isActive() ? point.roi : Roi(0, 0, this->m_width, this->m_height);
+	Point tl = this->m_roi.getTopLeft();
+	Size size = this->m_roi.getSize();
+	if(tl.x < 0 || tl.y < 0 || tl.x + size.getWidth() > this->m_width || tl.y + size.getHeight() > this->m_height)
+		THROW_HW_ERROR(InvalidValue) << "ROI outside the " << this->m_width << "x" << this->m_height << " sensor";
+	this->m_bit_depth = point.bit_depth;
+}
+
+double SimulatedBenchmarkBackend::_readout_time() const
+{
+	return this->m_mode ? this->m_roi.getSize().getHeight() * this->m_mode->line_time : 0;
+}
+
+void SimulatedBenchmarkBackend::start()
+{
+	this->m_time = 0;
+	this->m_random.seed(this->m_mode ? this->m_mode->mode : 0);
+	int pixel_size = this->m_bit_depth > 8 ? 2 : 1;
+	this->m_frame.assign(size_t(this->m_roi.getSize().getWidth()) * this->m_roi.getSize().getHeight() * pixel_size, 0);
+}
+
+void SimulatedBenchmarkBackend::readFrame(Frame& frame)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_mode || this->m_frame.empty())
+		THROW_HW_ERROR(Error) << "Simulated sensor not started";
+
+	frame.width = this->m_roi.getSize().getWidth();
+	frame.height = this->m_roi.getSize().getHeight();
+	frame.pixel_size = this->m_bit_depth > 8 ? 2 : 1;
+	frame.stride = size_t(frame.width) * frame.pixel_size;
+	frame.data = &this->m_frame[0];
+
+	// readout bound unless the link is slower
+	double bytes = double(this->m_frame.size());
+	this->m_time += std::max(this->_readout_time(), bytes / (this->m_link_bandwidth * 1e6));
+	frame.timestamp = this->m_time;
+
+	double scale = ldexp(1., this->m_bit_depth - 12);
+	double max_val = ldexp(1., this->m_bit_depth) - 1;
+	normal_distribution<double> noise(this->m_mode->dark_offset * scale, this->m_mode->dark_noise * scale);
+	size_t nb_pixels = size_t(frame.width) * frame.height;
+	for(size_t i = 0; i < nb_pixels; ++i)
+	{
+		double v = std::min(std::max(floor(noise(this->m_random) + 0.5), 0.), max_val);
+		if(frame.pixel_size == 1)
+			((uint8_t*)&this->m_frame[0])[i] = uint8_t(v);
+		else
+			((uint16_t*)&this->m_frame[0])[i] = uint16_t(v);
+	}
+}
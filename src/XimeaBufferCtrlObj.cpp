@@ -0,0 +1,301 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "lima/Exceptions.h"
+#include "XimeaBufferCtrlObj.h"
+#include "XimeaNuma.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+#define HUGE_PAGE_SIZE	(2 << 20)
+// SIMD loads on frame starts
+#define FRAME_ALIGNMENT	64
+// part of the physical memory frame buffers may take, the rest is left
+// to the SDK queue, the process and the system
+#define BUFFER_MEM_FRACTION	0.7
+
+static size_t _round_up(size_t size, size_t unit)
+{
+	return (size + unit - 1) / unit * unit;
+}
+
+MappedBufferAllocMgr::MappedBufferAllocMgr()
+	: m_huge_pages(false),
+	  m_alloc_huge_pages(false),
+	  m_numa_node(-1),
+	  m_nb_buffers(0),
+	  m_frame_stride(0),
+	  m_data(NULL),
+	  m_size(0),
+	  m_pages(Normal),
+	  m_prefaulted(false),
+	  m_locked(false)
+{
+}
+
+MappedBufferAllocMgr::~MappedBufferAllocMgr()
+{
+	this->releaseBuffers();
+}
+
+int MappedBufferAllocMgr::getMaxNbBuffers(const FrameDim& frame_dim)
+{
+	size_t mem = size_t(sysconf(_SC_PHYS_PAGES) * BUFFER_MEM_FRACTION) * sysconf(_SC_PAGESIZE);
+	return int(mem / _round_up(frame_dim.getMemSize(), FRAME_ALIGNMENT));
+}
+
+void MappedBufferAllocMgr::_alloc(size_t size)
+{
+	DEB_MEMBER_FUNCT();
+
+	void* data = NULL;
+	if(this->m_huge_pages)
+	{
+		size = _round_up(size, HUGE_PAGE_SIZE);
+		data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(data != MAP_FAILED)
+		{
+			this->m_data = (char*)data;
+			this->m_size = size;
+			this->m_pages = Huge;
+			return;
+		}
+		DEB_TRACE() << "No hugepages reserved for " << size << " bytes, trying transparent hugepages";
+
+		if(posix_memalign(&data, HUGE_PAGE_SIZE, size))
+			THROW_HW_ERROR(Error) << "Could not allocate " << size << " bytes of frame buffers";
+		this->m_pages = madvise(data, size, MADV_HUGEPAGE) ? Normal : TransparentHuge;
+		if(this->m_pages == Normal)
+			DEB_WARNING() << "Hugepages not available, using normal pages";
+	}
+	else
+	{
+		if(posix_memalign(&data, sysconf(_SC_PAGESIZE), size))
+			THROW_HW_ERROR(Error) << "Could not allocate " << size << " bytes of frame buffers";
+		this->m_pages = Normal;
+	}
+	this->m_data = (char*)data;
+	this->m_size = size;
+}
+
+void MappedBufferAllocMgr::allocBuffers(int nb_buffers, const FrameDim& frame_dim)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(nb_buffers, frame_dim);
+
+	if(this->m_data && nb_buffers == this->m_nb_buffers && frame_dim == this->m_frame_dim &&
+	   this->m_alloc_huge_pages == this->m_huge_pages)
+		return;
+
+	this->releaseBuffers();
+	if(nb_buffers <= 0)
+		return;
+
+	size_t stride = _round_up(frame_dim.getMemSize(), FRAME_ALIGNMENT);
+	this->_alloc(stride * nb_buffers);
+	// before any page is faulted in
+	if(this->m_numa_node >= 0 && !Numa::bindMemory(this->m_data, this->m_size, this->m_numa_node))
+		DEB_WARNING() << "Could not bind frame buffers to NUMA node " << this->m_numa_node;
+	this->m_frame_stride = stride;
+	this->m_frame_dim = frame_dim;
+	this->m_nb_buffers = nb_buffers;
+	this->m_alloc_huge_pages = this->m_huge_pages;
+	DEB_TRACE() << DEB_VAR3(this->m_size, stride, this->m_pages);
+}
+
+const FrameDim& MappedBufferAllocMgr::getFrameDim()
+{
+	return this->m_frame_dim;
+}
+
+void MappedBufferAllocMgr::getNbBuffers(int& nb_buffers)
+{
+	nb_buffers = this->m_nb_buffers;
+}
+
+void MappedBufferAllocMgr::releaseBuffers()
+{
+	if(!this->m_data)
+		return;
+
+	if(this->m_locked)
+		munlock(this->m_data, this->m_size);
+	if(this->m_pages == Huge)
+		munmap(this->m_data, this->m_size);
+	else
+		free(this->m_data);
+
+	this->m_data = NULL;
+	this->m_size = 0;
+	this->m_nb_buffers = 0;
+	this->m_frame_dim = FrameDim();
+	this->m_pages = Normal;
+	this->m_prefaulted = false;
+	this->m_locked = false;
+}
+
+void* MappedBufferAllocMgr::getBufferPtr(int buffer_nb)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(buffer_nb < 0 || buffer_nb >= this->m_nb_buffers)
+		THROW_HW_ERROR(InvalidValue) << "Invalid " << DEB_VAR2(buffer_nb, this->m_nb_buffers);
+	return this->m_data + buffer_nb * this->m_frame_stride;
+}
+
+void MappedBufferAllocMgr::setNumaNode(int node)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(node);
+
+	if(node == this->m_numa_node)
+		return;
+	this->m_numa_node = node;
+	if(node >= 0 && this->m_data && !Numa::bindMemory(this->m_data, this->m_size, node))
+		DEB_WARNING() << "Could not move frame buffers to NUMA node " << node;
+}
+
+int MappedBufferAllocMgr::getBufferNode() const
+{
+	return Numa::getMemoryNode(this->m_data);
+}
+
+bool MappedBufferAllocMgr::prefault()
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_data || this->m_prefaulted)
+		return false;
+
+	// one write per page is enough to fault it in
+	long page_size = sysconf(_SC_PAGESIZE);
+	for(size_t offset = 0; offset < this->m_size; offset += page_size)
+		((volatile char*)this->m_data)[offset] = 0;
+	this->m_prefaulted = true;
+	return true;
+}
+
+void MappedBufferAllocMgr::setLocked(bool locked)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(locked);
+
+	if(!this->m_data || locked == this->m_locked)
+		return;
+
+	if(!locked)
+	{
+		munlock(this->m_data, this->m_size);
+		this->m_locked = false;
+	}
+	else if(mlock(this->m_data, this->m_size))
+		DEB_WARNING() << "Could not lock " << this->m_size << " bytes of frame buffers: " << strerror(errno)
+			<< ", check the memlock limit";
+	else
+		// mlock faults all pages in
+		this->m_locked = this->m_prefaulted = true;
+}
+
+BufferCtrlObj::BufferCtrlObj()
+	: m_buffer_cb_mgr(m_alloc_mgr),
+	  m_mgr(m_buffer_cb_mgr)
+{
+}
+
+BufferCtrlObj::~BufferCtrlObj()
+{
+}
+
+void BufferCtrlObj::setFrameDim(const FrameDim& frame_dim)
+{
+	this->m_mgr.setFrameDim(frame_dim);
+}
+
+void BufferCtrlObj::getFrameDim(FrameDim& frame_dim)
+{
+	this->m_mgr.getFrameDim(frame_dim);
+}
+
+void BufferCtrlObj::setNbBuffers(int nb_buffers)
+{
+	this->m_mgr.setNbBuffers(nb_buffers);
+}
+
+void BufferCtrlObj::getNbBuffers(int& nb_buffers)
+{
+	this->m_mgr.getNbBuffers(nb_buffers);
+}
+
+void BufferCtrlObj::setNbConcatFrames(int nb_concat_frames)
+{
+	this->m_mgr.setNbConcatFrames(nb_concat_frames);
+}
+
+void BufferCtrlObj::getNbConcatFrames(int& nb_concat_frames)
+{
+	this->m_mgr.getNbConcatFrames(nb_concat_frames);
+}
+
+void BufferCtrlObj::getMaxNbBuffers(int& max_nb_buffers)
+{
+	this->m_mgr.getMaxNbBuffers(max_nb_buffers);
+}
+
+void* BufferCtrlObj::getBufferPtr(int buffer_nb, int concat_frame_nb)
+{
+	return this->m_mgr.getBufferPtr(buffer_nb, concat_frame_nb);
+}
+
+void* BufferCtrlObj::getFramePtr(int acq_frame_nb)
+{
+	return this->m_mgr.getFramePtr(acq_frame_nb);
+}
+
+void BufferCtrlObj::getStartTimestamp(Timestamp& start_ts)
+{
+	this->m_mgr.getStartTimestamp(start_ts);
+}
+
+void BufferCtrlObj::getFrameInfo(int acq_frame_nb, HwFrameInfoType& info)
+{
+	this->m_mgr.getFrameInfo(acq_frame_nb, info);
+}
+
+void BufferCtrlObj::registerFrameCallback(HwFrameCallback& frame_cb)
+{
+	this->m_mgr.registerFrameCallback(frame_cb);
+}
+
+void BufferCtrlObj::unregisterFrameCallback(HwFrameCallback& frame_cb)
+{
+	this->m_mgr.unregisterFrameCallback(frame_cb);
+}
@@ -22,6 +22,10 @@
 // along with this program; if not, see <http://www.gnu.org/licenses/>.
 //###########################################################################
 
+#include <algorithm>
+#include <dirent.h>
+#include <unistd.h>
+
 #include "XimeaCamera.h"
 #include "XimeaAcqThread.h"
 
@@ -29,6 +33,33 @@ using namespace lima;
 using namespace lima::Ximea;
 using namespace std;
 
+// cooling needed before a temperature alarm is raised again, *C
+#define TEMP_ALARM_HYSTERESIS	1.0
+
+// camera clock reads per sync, the fastest one is kept
+#define CLOCK_SYNC_READS		5
+// first frame time on the host clock later than its arrival by more than
+// this, s: the frame stamps do not follow the clock XI_PRM_TIMESTAMP reads
+#define CLOCK_SYNC_CHECK_TOLERANCE	0.01
+
+// relative margin of the sensor timing model on the trigger period
+#define TRIGGER_PERIOD_TOLERANCE	0.01
+
+// timing calibration: with the probe exposure the period grows by less
+// than this part of it on a sensor exposing during readout
+#define OVERLAP_PROBE_FRACTION		0.5
+
+// SDK queue occupancy sampling from the grab thread, s
+#define SDK_QUEUE_SAMPLE_PERIOD		0.1
+
+// exposure sequence values differing by more than this from the frame
+// metadata are reported as mismatches (relative, dB)
+#define SEQUENCE_EXP_TOLERANCE		0.01
+#define SEQUENCE_GAIN_TOLERANCE		0.1
+
+// default HDR knee, part of the high gain range
+#define HDR_KNEE_FRACTION	0.9
+
 //---------------------------
 //- Ctor
 //---------------------------
@@ -41,6 +72,8 @@ Camera::Camera(int camera_id, GPISelector trigger_gpi_port, unsigned int timeout
 	  m_buffer_size(0),
 	  m_acq_thread(nullptr),
 	  m_trig_polarity(Camera::TriggerPolarity_High_Rising),
+	  m_trigger_overlap(Camera::TriggerOverlap_Off),
+	  m_trigger_period(0),
 	  m_trigger_gpi_port(trigger_gpi_port),
 	  m_timeout(timeout),
 	  m_startup_temp_control_mode(startup_temp_control_mode),
@@ -49,9 +82,95 @@ Camera::Camera(int camera_id, GPISelector trigger_gpi_port, unsigned int timeout
 	  m_soft_trigger_issued(false),
 	  m_max_height(0),
 	  m_max_width(0),
-	  m_latency_time(0)
+	  m_latency_time(0),
+	  m_stats_enabled(false),
+	  m_stats_bit_depth(8),
+	  m_stats_time(0),
+	  m_stats_time_fraction(0),
+	  m_ae_engine(Camera::AutoExposureEngine_Hardware),
+	  m_soft_ae_enabled(false),
+	  m_hw_ae_enabled(false),
+	  m_correction_enabled(false),
+	  m_correction_time(0),
+	  m_correction_throughput(0),
+	  m_pretrigger_mode(false),
+	  m_pretrigger_frames(100),
+	  m_pretrigger_source(PreTriggerSource_Gpi),
+	  m_pretrigger_fired(false),
+	  m_pretrigger_event_frame(-1),
+	  m_accumulation_frames(1),
+	  m_sensor_frame_size(0),
+	  m_hdr_enabled(false),
+	  m_hdr_output_depth(16),
+	  m_hdr_gain_ratio(0),
+	  m_hdr_knee(0),
+	  m_hdr_mode(-1),
+	  m_hdr_temperature(0),
+	  m_hdr_temperature_valid(false),
+	  m_hdr_warned(false),
+	  m_hdr_merge_time(0),
+	  m_demosaic_enabled(false),
+	  m_demosaic_algorithm(Demosaic::Bilinear),
+	  m_demosaic_pattern(Demosaic::RGGB),
+	  m_demosaic_bit_depth(8),
+	  m_demosaic_time(0),
+	  m_demosaic_throughput(0),
+	  m_format_convert(false),
+	  m_format_layout(ColourLayout_Rgb24),
+	  m_format_bit_depth(8),
+	  m_format_conversion_time(0),
+	  m_dark_cache_enabled(false),
+	  m_dark_match(DarkMatch_None),
+	  m_sdk_burst_time(0.5),
+	  m_sdk_queue_size_override(0),
+	  m_sdk_acq_buffer_size_override(0),
+	  m_sdk_transport_buffer_size_override(0),
+	  m_sdk_frames_read(0),
+	  m_sdk_queue_high_water(0),
+	  m_buffer_prefault(false),
+	  m_buffer_lock(false),
+	  m_buffer_prefault_time(0),
+	  m_numa_node(-1),
+	  m_numa_device_node(-1),
+	  m_numa_placement_node(-1),
+	  m_numa_acq_thread_node(-1),
+	  m_params_pending(false),
+	  m_exp_pending(false),
+	  m_pending_exp(0),
+	  m_gain_pending(false),
+	  m_pending_gain(0),
+	  m_sequence_active(false),
+	  m_sequence_soft_trigger(false),
+	  m_sequence_applied(-1),
+	  m_sequence_mismatches(0),
+	  m_sequence_saved_exp(0),
+	  m_sequence_saved_gain(0),
+	  m_sidecar_format(MetadataSidecarFormat_Npy),
+	  m_sidecar_index(0),
+	  m_monitor_sampler(*this),
+	  m_monitor(m_monitor_sampler),
+	  m_event_sink(*this),
+	  m_event_queue(m_event_sink),
+	  m_temp_alarm(0),
+	  m_temp_alarm_raised(false),
+	  m_clock_sync_sampler(*this),
+	  m_clock_sync_thread(m_clock_sync_sampler),
+	  m_clock_sync_enabled(false),
+	  m_clock_sync_supported(true),
+	  m_clock_sync_checked(false),
+	  m_clock_sync_interval(10),
+	  m_start_timestamp(0),
+	  m_trigger_diag_enabled(false),
+	  m_trigger_diag_active(false),
+	  m_trigger_diag_delay(0),
+	  m_missed_overlap_start(0),
+	  m_missed_buffer_full_start(0),
+	  m_profile_switch_time(0),
+	  m_profile_nb_writes(0)
 {
 	DEB_CONSTRUCTOR();
+	this->m_clock_sync_thread.setRate(1 / this->m_clock_sync_interval);
+	this->m_clock_sync_thread.setHistorySize(0);
 	this->_startup();
 	DEB_TRACE() << "Camera " << camera_id << " opened; xi_status: " << this->xi_status;
 }
@@ -64,6 +183,9 @@ Camera::~Camera()
 	DEB_DESTRUCTOR();
 
 	this->_stop_acq_thread();
+	this->m_clock_sync_thread.stop();
+	this->m_monitor.stop();
+	this->m_event_queue.stop();
 	if(this->xiH)
 		xiCloseDevice(this->xiH);
 }
@@ -78,6 +200,12 @@ void Camera::_startup()
 
 	this->m_camera_model = this->_get_param_str(XI_PRM_DEVICE_NAME);
 
+	// PCIe cameras have a PCI address in their location, USB ones do not
+	char location[PARAMSTR_LEN];
+	if(xiGetDeviceInfoString(this->cam_id, XI_PRM_DEVICE_LOCATION_PATH, location, PARAMSTR_LEN) == XI_OK)
+		this->m_numa_device_node = Numa::getDeviceNode(location);
+	DEB_TRACE() << DEB_VAR1(this->m_numa_device_node);
+
 	// set debug level
 	this->_set_param_int(XI_PRM_DEBUG_LEVEL, XI_DL_DISABLED);
 
@@ -99,6 +227,25 @@ void Camera::_startup()
 	// read max frame size
 	this->m_max_width = this->_get_param_max(XI_PRM_WIDTH);
 	this->m_max_height = this->_get_param_max(XI_PRM_HEIGHT);
+
+	// software auto exposure is bounded by the camera exposure range
+	AutoExposure::Params ae_params;
+	this->m_auto_exposure.getParams(ae_params);
+	ae_params.min_exp_time = this->_get_param_min(XI_PRM_EXPOSURE) / TIME_HW;
+	ae_params.max_exp_time = std::min(ae_params.max_exp_time, this->_get_param_max(XI_PRM_EXPOSURE) / TIME_HW);
+	this->m_auto_exposure.setParams(ae_params);
+	this->m_hw_ae_enabled = (bool)this->_get_param_int(XI_PRM_AEAG);
+
+	this->m_event_queue.start();
+	this->m_monitor.start();
+
+	// another model after a reset
+	{
+		AutoMutex lock(this->m_snapshot_mutex);
+		this->m_snapshot_unsupported.clear();
+	}
+	this->m_clock_sync_supported = true;
+	this->m_clock_sync.reset();
 }
 
 void Camera::getPluginVersion(string& version)
@@ -116,10 +263,232 @@ void Camera::prepareAcq()
 	DEB_MEMBER_FUNCT();
 
 	this->_stop_acq_thread();
+	// prepared but never started
+	if(this->m_sequence_active)
+		this->_end_sequence();
+	// left over by an acquisition ending before they were applied
+	if(this->m_params_pending)
+		this->_apply_pending_params();
 	this->m_image_number = 0;
+	this->m_sdk_frames_read = 0;
+	this->m_sdk_queue_high_water = 0;
 	this->m_buffer_size = this->m_buffer_ctrl_obj.getBuffer().getFrameDim().getMemSize();
+	{
+		int nb_buffers;
+		this->m_buffer_ctrl_obj.getBuffer().getNbBuffers(nb_buffers);
+		AutoMutex lock(this->m_frame_metadata_mutex);
+		this->m_frame_metadata.assign(nb_buffers, FrameMetadata());
+		this->m_last_frame_metadata = FrameMetadata();
+	}
+	if(!this->m_sidecar_path.empty())
+		// closed by the acquisition thread when it ends
+		this->_open_sidecar();
+	this->m_numa_placement_node = this->m_numa_node >= 0 ? this->m_numa_node : this->m_numa_device_node;
+	this->m_workers.setNumaNode(this->m_numa_placement_node);
+	this->m_demosaic_workers.setNumaNode(this->m_numa_placement_node);
+	{
+		// fault frame buffers in now rather than on the first frames
+		MappedBufferAllocMgr& alloc_mgr = this->m_buffer_ctrl_obj.getAllocMgr();
+		alloc_mgr.setNumaNode(this->m_numa_placement_node);
+		Timestamp start = Timestamp::now();
+		if(this->m_buffer_prefault && alloc_mgr.prefault())
+			this->m_buffer_prefault_time = Timestamp::now() - start;
+		alloc_mgr.setLocked(this->m_buffer_lock);
+	}
+
+	if(this->m_trigger_mode == ExtTrigMult && this->m_trigger_period > 0)
+	{
+		// the camera frame rate limit at these settings bounds the period
+		// by exposure and readout without reconfiguring anything; the
+		// model adds the trigger overlap, never calibrated here
+		double max_rate = this->_get_param_dbl_max(XI_PRM_FRAMERATE);
+		TimingPrediction prediction;
+		this->getTimingPrediction(prediction);
+		if(prediction.max_trigger_rate > 0)
+			max_rate = std::min(max_rate, prediction.max_trigger_rate);
+		if(max_rate > 0 && this->m_trigger_period * max_rate < 1 - TRIGGER_PERIOD_TOLERANCE)
+			THROW_HW_ERROR(InvalidValue) << "Trigger period " << this->m_trigger_period << " s is shorter than "
+				<< 1 / max_rate << " s, the camera accepts at most " << max_rate << " triggers/s with these settings";
+	}
+
+	if(this->m_pretrigger_mode && this->m_trigger_mode != IntTrig)
+		THROW_HW_ERROR(Error) << "Pre-trigger mode needs internal trigger, the camera runs free";
+	this->m_pretrigger_fired = false;
+	this->m_pretrigger_event_frame = -1;
+
+	if(this->m_accumulation_frames > 1)
+	{
+		if(this->m_pretrigger_mode)
+			THROW_HW_ERROR(Error) << "Accumulation cannot be combined with pre-trigger mode";
+		if(this->m_trigger_mode == IntTrigMult)
+			THROW_HW_ERROR(Error) << "Accumulation needs one trigger per sensor frame, not supported with " << this->m_trigger_mode;
+		// sums are taken over single channel 8 or 16 bit pixels
+		ImageFormat format;
+		this->getImageFormat(format);
+		if(format != ImageFormat_Mono8 && format != ImageFormat_Mono16 && format != ImageFormat_Raw8 && format != ImageFormat_Raw16)
+			THROW_HW_ERROR(Error) << "Accumulation needs a Mono or Raw 8/16 bit image format, not " << int(format);
+
+		// sensor frames are read in a separate buffer, Lima ones hold the sums
+		int nb_buffers;
+		this->m_buffer_ctrl_obj.getBuffer().getNbBuffers(nb_buffers);
+		this->m_sensor_frame_size = this->_get_param_int(XI_PRM_IMAGE_PAYLOAD_SIZE);
+		AutoMutex lock(this->m_accumulation_mutex);
+		AccumulatedFrame none = {-1, -1, -1};
+		this->m_accumulated_frames.assign(nb_buffers, none);
+	}
+	else
+	{
+		AutoMutex lock(this->m_accumulation_mutex);
+		this->m_accumulated_frames.clear();
+	}
+
+	if(this->m_hdr_enabled)
+	{
+		Mode mode;
+		this->getMode(mode);
+		if(mode != Mode_2_12_HDR_HL && mode != Mode_4_12_CMS_HDR_HL)
+			THROW_HW_ERROR(Error) << "HDR merge needs both gain channels, mode " << int(mode) << " delivers one";
+		if(this->m_pretrigger_mode || this->m_accumulation_frames > 1 || this->m_correction_enabled)
+			THROW_HW_ERROR(Error) << "HDR merge cannot be combined with pre-trigger, accumulation or correction";
+
+		// sensor frames carry the high gain plane then the low gain one
+		size_t plane_size = size_t(this->_get_param_int(XI_PRM_WIDTH)) * this->_get_param_int(XI_PRM_HEIGHT) * 2;
+		this->m_sensor_frame_size = this->_get_param_int(XI_PRM_IMAGE_PAYLOAD_SIZE);
+		if(size_t(this->m_sensor_frame_size) < 2 * plane_size)
+			THROW_HW_ERROR(Error) << "Sensor frames of " << this->m_sensor_frame_size << " bytes cannot hold two 16 bit channels";
+
+		AutoMutex lock(this->m_hdr_mutex);
+		this->m_hdr_mode = mode;
+		// calibrations are cached per temperature, without a reading
+		// they are measured on the frames and not cached
+		this->m_hdr_temperature_valid = true;
+		try
+		{
+			this->getTempSensor(this->m_hdr_temperature);
+		}
+		catch(Exception& e)
+		{
+			DEB_WARNING() << "Sensor temperature not readable, HDR calibration not cached: " << e.getErrMsg();
+			this->m_hdr_temperature_valid = false;
+		}
+		this->m_hdr_calib = HdrCalibration();
+		this->m_hdr_warned = false;
+		// manual values are completed on the first frame
+		if(this->m_hdr_temperature_valid && this->m_hdr_gain_ratio <= 0 && this->m_hdr_knee <= 0)
+			this->m_hdr_cache.lookup(mode, this->m_hdr_temperature, this->m_hdr_calib);
+	}
+
+	if(this->m_demosaic_enabled)
+	{
+		ImageFormat format;
+		this->getImageFormat(format);
+		if(format != ImageFormat_Raw8 && format != ImageFormat_Raw16)
+			THROW_HW_ERROR(Error) << "Demosaic needs the Raw8 or Raw16 image format, not " << int(format);
+		if(this->m_pretrigger_mode || this->m_accumulation_frames > 1 || this->m_hdr_enabled)
+			THROW_HW_ERROR(Error) << "Demosaic cannot be combined with pre-trigger, accumulation or HDR merge";
+
+		Demosaic::Pattern pattern;
+		int cfa = this->_get_param_int(XI_PRM_COLOR_FILTER_ARRAY);
+		switch(cfa)
+		{
+			case XI_CFA_BAYER_RGGB:
+				pattern = Demosaic::RGGB;
+				break;
+			case XI_CFA_BAYER_GRBG:
+				pattern = Demosaic::GRBG;
+				break;
+			case XI_CFA_BAYER_GBRG:
+				pattern = Demosaic::GBRG;
+				break;
+			case XI_CFA_BAYER_BGGR:
+				pattern = Demosaic::BGGR;
+				break;
+			default:
+				THROW_HW_ERROR(Error) << "Demosaic needs a Bayer sensor, colour filter array is " << cfa;
+		}
+
+		// raw frames are read into the acquisition thread ring, Lima
+		// buffers hold the colour ones
+		this->m_sensor_frame_size = this->_get_param_int(XI_PRM_IMAGE_PAYLOAD_SIZE);
+		AutoMutex lock(this->m_demosaic_mutex);
+		this->m_demosaic_pattern = pattern;
+		this->m_demosaic_bit_depth = this->_get_param_int(XI_PRM_IMAGE_DATA_BIT_DEPTH);
+		this->m_demosaic.prepare(this->_get_param_int(XI_PRM_WIDTH), this->_get_param_int(XI_PRM_HEIGHT));
+	}
+
+	// colour layouts Lima does not take are read aside and converted
+	this->m_format_convert = false;
+	this->m_format_conversion_time = 0;
+	if(this->m_accumulation_frames <= 1 && !this->m_hdr_enabled && !this->m_demosaic_enabled)
+	{
+		ImageFormat format;
+		this->getImageFormat(format);
+		ImageType type;
+		this->_get_format_type(format, type, this->m_format_convert, this->m_format_layout);
+		if(this->m_format_convert)
+		{
+			if(this->m_pretrigger_mode)
+				THROW_HW_ERROR(Error) << "Pre-trigger mode needs an image format Lima takes as it is, not a converted one";
+			this->m_sensor_frame_size = this->_get_param_int(XI_PRM_IMAGE_PAYLOAD_SIZE);
+			this->m_format_bit_depth = this->_get_param_int(XI_PRM_IMAGE_DATA_BIT_DEPTH);
+		}
+	}
+
+	// read once here, not from the acquisition loop
+	this->m_stats_bit_depth = this->_get_param_int(XI_PRM_IMAGE_DATA_BIT_DEPTH);
+	{
+		AutoMutex lock(this->m_stats_mutex);
+		this->m_frame_stats.reset();
+		this->m_rolling_stats.clear();
+	}
+	{
+		// sums of N frames need log2(N) more bits
+		int bit_depth = this->m_stats_bit_depth;
+		for(int n = 1; n < this->m_accumulation_frames; n *= 2)
+			++bit_depth;
+		if(this->m_hdr_enabled)
+			bit_depth = 16;
+		this->m_live_view.reset(bit_depth);
+	}
+	if(this->m_correction_enabled)
+	{
+		Roi roi;
+		Bin bin;
+		this->getRoi(roi);
+		this->getBin(bin);
+
+		vector<float> dark;
+		this->m_dark_match = DarkMatch_None;
+		if(this->m_dark_cache_enabled)
+		{
+			DarkKey key;
+			this->_get_dark_key(key);
+			this->m_dark_match = (DarkMatch)this->m_dark_library.lookup(key, dark, this->m_dark_key);
+			if(this->m_dark_match == DarkMatch_None)
+				DEB_WARNING() << "No cached dark for these settings, using the dark map if any";
+			else if(this->m_dark_library.isStale(this->m_dark_key, key.temperature))
+				DEB_WARNING() << "Cached dark taken at " << this->m_dark_key.temperature << " *C, sensor is at " << key.temperature << " *C";
+		}
+
+		// crop and bin maps to the acquisition geometry
+		AutoMutex lock(this->m_correction_mutex);
+		this->m_correction.prepare(roi, bin);
+		if(!dark.empty())
+			this->m_correction.setPreparedDark(dark);
+	}
+	{
+		// convergence is measured from the start of the acquisition
+		AutoMutex lock(this->m_ae_mutex);
+		this->m_auto_exposure.reset();
+	}
+	this->_size_sdk_buffers();
+	this->_start_sequence();
 	
-	this->m_acq_thread = new AcqThread(*this, this->_get_trigger_timeout());
+	{
+		// the thread scratch buffers
+		Numa::PreferredNode preferred(this->m_numa_placement_node);
+		this->m_acq_thread = new AcqThread(*this, this->_get_trigger_timeout());
+	}
 	this->_set_status(Camera::Ready);
 }
 
@@ -132,9 +501,24 @@ void Camera::startAcq()
 	else
 	{
 		if(!this->m_image_number)
-			this->m_buffer_ctrl_obj.getBuffer().setStartTimestamp(Timestamp::now());
-
-		xiStartAcquisition(this->xiH);
+		{
+			Timestamp start = Timestamp::now();
+			this->m_buffer_ctrl_obj.getBuffer().setStartTimestamp(start);
+			this->m_start_timestamp = double(start);
+		}
+
+		// counters before the first trigger can be taken
+		this->_start_trigger_diag();
+		{
+			// the SDK allocates its buffers here
+			Numa::PreferredNode preferred(this->m_numa_placement_node);
+			xiStartAcquisition(this->xiH);
+		}
+		// fresh pair for the first frames, some models reset their
+		// clock when armed
+		if(this->m_clock_sync_enabled)
+			this->_sync_clock();
+		this->m_clock_sync_checked = false;
 		this->m_acq_thread->m_quit = false;
 		this->m_acq_thread->start();
 		if(this->m_trigger_mode == IntTrigMult)
@@ -165,6 +549,82 @@ void Camera::getImageType(ImageType& type)
 {
 	DEB_MEMBER_FUNCT();
 
+	// Lima buffers hold 32 bit sums of the sensor frames
+	if(this->m_accumulation_frames > 1)
+		type = Bpp32;
+	else if(this->m_hdr_enabled)
+		type = this->m_hdr_output_depth == 16 ? Bpp16 : Bpp32;
+	// packed B G R A
+	else if(this->m_demosaic_enabled)
+		type = Bpp32;
+	else
+	{
+		ImageFormat format;
+		this->getImageFormat(format);
+		bool convert;
+		ColourLayout layout;
+		this->_get_format_type(format, type, convert, layout);
+	}
+}
+
+void Camera::_get_format_type(ImageFormat format, ImageType& type, bool& convert, ColourLayout& layout)
+{
+	DEB_MEMBER_FUNCT();
+
+	convert = false;
+	switch(format)
+	{
+		case ImageFormat_Mono8:
+		case ImageFormat_Raw8:
+			type = Bpp8;
+			break;
+		case ImageFormat_Mono16:
+		case ImageFormat_Raw16:
+			// significant bits in 16 bit pixels
+			this->_get_sensor_image_type(type);
+			if(type == Bpp8 || FrameDim::getImageTypeDepth(type) > 2)
+				type = Bpp16;
+			break;
+		case ImageFormat_Raw32:
+		case ImageFormat_RGB32:
+			type = Bpp32;
+			break;
+		case ImageFormat_Raw32_Float:
+			type = Bpp32F;
+			break;
+
+		case ImageFormat_RGB24:
+			convert = true;
+			layout = ColourLayout_Rgb24;
+			break;
+		case ImageFormat_RGB48:
+			convert = true;
+			layout = ColourLayout_Rgb48;
+			break;
+		case ImageFormat_RGB64:
+			convert = true;
+			layout = ColourLayout_Rgb64;
+			break;
+		case ImageFormat_RGB_Planar:
+			convert = true;
+			layout = ColourLayout_RgbPlanar;
+			break;
+		case ImageFormat_RGB16_Planar:
+			convert = true;
+			layout = ColourLayout_Rgb16Planar;
+			break;
+
+		default:
+			THROW_HW_ERROR(NotSupported) << "Image format " << int(format) << " cannot be stored in Lima buffers";
+	}
+	if(convert)
+		type = Bpp32;
+}
+
+void Camera::_get_sensor_image_type(ImageType& type)
+{
+	DEB_MEMBER_FUNCT();
+
 	XI_BIT_DEPTH depth = (XI_BIT_DEPTH)this->_get_param_int(XI_PRM_IMAGE_DATA_BIT_DEPTH);
 	switch(depth)
 	{
@@ -204,6 +664,20 @@ void Camera::setImageType(ImageType type)
 {
 	DEB_MEMBER_FUNCT();
 
+	ImageFormat format;
+	this->getImageFormat(format);
+	if(format != ImageFormat_Mono8 && format != ImageFormat_Mono16 && format != ImageFormat_Raw8 && format != ImageFormat_Raw16)
+	{
+		// one type only, the bit depth is not Lima's choice
+		ImageType format_type;
+		bool convert;
+		ColourLayout layout;
+		this->_get_format_type(format, format_type, convert, layout);
+		if(type != format_type)
+			THROW_HW_ERROR(InvalidValue) << "Image format " << int(format) << " gives " << format_type << " frames, not " << type;
+		return;
+	}
+
 	XI_BIT_DEPTH depth;
 	switch(type)
 	{
@@ -316,6 +790,10 @@ void Camera::setTrigMode(TrigMode mode)
 			this->_set_param_int(XI_PRM_TRG_SOURCE, XI_TRG_EDGE_RISING);
 
 		this->_set_param_int(XI_PRM_TRG_SELECTOR, XI_TRG_SEL_FRAME_START);
+		// without overlap the sensor finishes readout before accepting
+		// the next trigger
+		if(this->m_trigger_overlap != TriggerOverlap_Off)
+			this->_set_param_int(XI_PRM_TRG_OVERLAP, this->m_trigger_overlap);
 	}
 	else if(mode == ExtGate)
 	{
@@ -345,11 +823,29 @@ void Camera::setExpTime(double exp_time)
 {
 	// convert exposure from s to us
 	int v = int(exp_time * TIME_HW);
+	if(this->_is_acquiring())
+	{
+		// applied later by the grab thread, refuse now what would fail
+		this->_check_param_range(XI_PRM_EXPOSURE, v);
+		AutoMutex lock(this->m_params_mutex);
+		this->m_pending_exp = v;
+		this->m_exp_pending = true;
+		this->m_params_pending = true;
+		return;
+	}
 	this->_set_param_int(XI_PRM_EXPOSURE, v);
 }
 
 void Camera::getExpTime(double& exp_time)
 {
+	{
+		AutoMutex lock(this->m_params_mutex);
+		if(this->m_exp_pending)
+		{
+			exp_time = this->m_pending_exp / TIME_HW;
+			return;
+		}
+	}
 	int r = this->_get_param_int(XI_PRM_EXPOSURE);
 	// convert exposure from us to s
 	exp_time = (double)(r / TIME_HW);
@@ -529,7 +1025,10 @@ void Camera::getSoftwareTrigger(bool& t)
 
 void Camera::setSoftwareTrigger(bool t)
 {
-	this->_generate_soft_trigger();
+	if(this->m_pretrigger_mode)
+		this->firePreTrigger();
+	else
+		this->_generate_soft_trigger();
 }
 
 void Camera::getGpiSelector(GPISelector& s)
@@ -776,6 +1275,20 @@ int Camera::_get_param_inc(const char* param)
 	return this->_get_param_int((param_str + info_str).c_str());
 }
 
+double Camera::_get_param_dbl_min(const char* param)
+{
+	string param_str(param);
+	string info_str(XI_PRM_INFO_MIN);
+	return this->_get_param_dbl((param_str + info_str).c_str());
+}
+
+double Camera::_get_param_dbl_max(const char* param)
+{
+	string param_str(param);
+	string info_str(XI_PRM_INFO_MAX);
+	return this->_get_param_dbl((param_str + info_str).c_str());
+}
+
 void Camera::_read_image(XI_IMG* image, int timeout)
 {
 	DEB_MEMBER_FUNCT();
@@ -790,6 +1303,142 @@ void Camera::_read_image(XI_IMG* image, int timeout)
 	// 	THROW_HW_ERROR(Error) << "Image readout failed; xi_status: " << this->xi_status;
 }
 
+bool Camera::_update_frame_stats(const XI_IMG* image, double frame_period, FrameStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+
+	Timestamp t0 = Timestamp::now();
+
+	int w = image->width;
+	int h = image->height;
+	switch(image->frm)
+	{
+		case XI_MONO8:
+		case XI_RAW8:
+			computeFrameStats((const uint8_t*)image->bp, w, h, w + image->padding_x, this->m_stats_bit_depth, stats);
+			break;
+		case XI_MONO16:
+		case XI_RAW16:
+			computeFrameStats((const uint16_t*)image->bp, w, h, w * 2 + image->padding_x, this->m_stats_bit_depth, stats);
+			break;
+		case XI_RAW32:
+			computeFrameStats((const uint32_t*)image->bp, w, h, w * 4 + image->padding_x, this->m_stats_bit_depth, stats);
+			break;
+		default:
+			// colour and float formats are not handled
+			return false;
+	}
+
+	double dt = Timestamp::now() - t0;
+
+	AutoMutex lock(this->m_stats_mutex);
+	this->m_frame_stats = stats;
+	this->m_rolling_stats.push(stats);
+	this->m_stats_time = dt;
+	this->m_stats_time_fraction = frame_period > 0 ? dt / frame_period : 0;
+	return true;
+}
+
+int Camera::_get_pixel_size(int format)
+{
+	switch(format)
+	{
+		case XI_MONO8:
+		case XI_RAW8:
+			return 1;
+		case XI_MONO16:
+		case XI_RAW16:
+			return 2;
+		case XI_RAW32:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+void Camera::_apply_correction(const XI_IMG* image)
+{
+	DEB_MEMBER_FUNCT();
+
+	int pixel_size = _get_pixel_size(image->frm);
+	if(!pixel_size)
+		return;
+
+	size_t stride = image->width * pixel_size + image->padding_x;
+	try
+	{
+		AutoMutex lock(this->m_correction_mutex);
+		Timestamp t0 = Timestamp::now();
+		this->m_correction.apply(image->bp, pixel_size, image->width, image->height, stride, this->m_workers);
+		double dt = Timestamp::now() - t0;
+		this->m_correction_time = dt;
+		this->m_correction_throughput = dt > 0 ? double(stride) * image->height / dt / 1e9 : 0;
+	}
+	catch(Exception& e)
+	{
+		this->reportException(e, "Ximea/Camera/_apply_correction");
+	}
+}
+
+void Camera::_get_dark_key(DarkKey& key)
+{
+	DEB_MEMBER_FUNCT();
+
+	int gain;
+	Mode mode;
+	this->getExpTime(key.exp_time);
+	this->getGain(gain);
+	this->getMode(mode);
+	this->getRoi(key.roi);
+	this->getBin(key.bin);
+	// NaN: any cached temperature will do
+	try
+	{
+		this->getTempSensor(key.temperature);
+	}
+	catch(Exception& e)
+	{
+		DEB_WARNING() << "Sensor temperature not readable, darks keyed without it: " << e.getErrMsg();
+		key.temperature = std::numeric_limits<double>::quiet_NaN();
+	}
+	key.gain = gain;
+	key.mode = mode;
+}
+
+bool Camera::_auto_exposure_active(void)
+{
+	return this->m_soft_ae_enabled || this->m_hw_ae_enabled;
+}
+
+void Camera::_update_auto_exposure(const XI_IMG* image, const FrameStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+
+	double exp_time = image->exposure_time_us / TIME_HW;
+	double gain = image->gain_db;
+	double new_exp_time, new_gain;
+	bool apply;
+	{
+		AutoMutex lock(this->m_ae_mutex);
+		if(!this->m_soft_ae_enabled)
+		{
+			// camera AEAG drives exposure, only measure convergence
+			this->m_auto_exposure.track(stats);
+			return;
+		}
+		apply = this->m_auto_exposure.update(stats, exp_time, gain, new_exp_time, new_gain);
+	}
+	if(!apply)
+		return;
+
+	// exposure and gain may be changed while the acquisition is running,
+	// the new values are applied before the next frame
+	DEB_TRACE() << "auto exposure: " << DEB_VAR2(new_exp_time, new_gain);
+	this->_apply_param(XI_PRM_EXPOSURE, int(new_exp_time * TIME_HW));
+	if(lround(new_gain) != lround(gain))
+		this->_apply_param(XI_PRM_GAIN, int(lround(new_gain)));
+}
+
 void Camera::_generate_soft_trigger(void)
 {
 	this->_set_param_int(XI_PRM_TRG_SOFTWARE, XI_ON);
@@ -822,6 +1471,8 @@ int Camera::_get_trigger_timeout(void)
 	// timeout + expo time
 	double exp_time = 0;
 	this->getExpTime(exp_time);
+	if(this->m_sequence_active)
+		exp_time = *std::max_element(this->m_sequence_exp.begin(), this->m_sequence_exp.end());
 	int exp_ms = int(exp_time * TIME_HW / 1e3);	// convert to ms
 	int timeout = this->m_timeout + exp_ms;
 	return timeout;
@@ -845,225 +1496,3033 @@ void Camera::_set_status(Camera::Status status)
 	this->m_status = this->xi_status == XI_OK ? status : Camera::Fault;
 }
 
-// Extra attributes
+// Frame statistics
 
-void Camera::getMode(Mode& m)
+void Camera::getStatsEnabled(bool& e)
 {
-	m = (Mode)this->_get_param_int(XI_PRM_USER_SET_SELECTOR);
+	e = this->m_stats_enabled;
 }
 
-void Camera::setMode(Mode m)
+void Camera::setStatsEnabled(bool e)
 {
-	this->_set_param_int(XI_PRM_USER_SET_SELECTOR, (int)m);
-	this->_set_param_int(XI_PRM_USER_SET_LOAD, 0);
+	this->m_stats_enabled = e;
 }
 
-void Camera::getGainSelector(GainSelector &s)
+void Camera::getStatsWindow(int& n)
 {
-	s = (GainSelector)this->_get_param_int(XI_PRM_GAIN_SELECTOR);
+	AutoMutex lock(this->m_stats_mutex);
+	n = this->m_rolling_stats.getWindow();
 }
 
-void Camera::setGainSelector(GainSelector s)
+void Camera::setStatsWindow(int n)
 {
-	this->_set_param_int(XI_PRM_GAIN_SELECTOR, (int)s);
-}
+	DEB_MEMBER_FUNCT();
 
-void Camera::getGain(int& g)
-{
-	g = this->_get_param_int(XI_PRM_GAIN);
+	if(n < 1)
+		THROW_HW_ERROR(InvalidValue) << "Statistics window must be at least 1 frame";
+	AutoMutex lock(this->m_stats_mutex);
+	this->m_rolling_stats.setWindow(n);
 }
 
-void Camera::setGain(int g)
+void Camera::getFrameStats(FrameStats& s)
 {
-	this->_set_param_int(XI_PRM_GAIN, g);
+	AutoMutex lock(this->m_stats_mutex);
+	s = this->m_frame_stats;
 }
 
-void Camera::getIsCooled(bool& c)
+void Camera::getStatsMin(double& v)
 {
-	c = (bool)this->_get_param_int(XI_PRM_IS_COOLED);
+	AutoMutex lock(this->m_stats_mutex);
+	v = this->m_frame_stats.min;
 }
 
-void Camera::getTempControlMode(TempControlMode& m)
+void Camera::getStatsMax(double& v)
 {
-	m = (TempControlMode)this->_get_param_int(XI_PRM_COOLING);
+	AutoMutex lock(this->m_stats_mutex);
+	v = this->m_frame_stats.max;
 }
 
-void Camera::setTempControlMode(TempControlMode m)
+void Camera::getStatsMean(double& v)
 {
-	this->_set_param_int(XI_PRM_COOLING, (int)m);
+	AutoMutex lock(this->m_stats_mutex);
+	v = this->m_frame_stats.mean;
 }
 
-void Camera::getTempTarget(double& t)
+void Camera::getStatsSum(double& v)
 {
-	t = this->_get_param_dbl(XI_PRM_TARGET_TEMP);
+	AutoMutex lock(this->m_stats_mutex);
+	v = this->m_frame_stats.sum;
 }
 
-void Camera::setTempTarget(double t)
+void Camera::getStatsHistogram(std::vector<int>& h)
 {
-	this->_set_param_dbl(XI_PRM_TARGET_TEMP, t);
+	AutoMutex lock(this->m_stats_mutex);
+	h.assign(this->m_frame_stats.histogram, this->m_frame_stats.histogram + FrameStats::HISTOGRAM_BINS);
 }
 
-void Camera::getThermometer(Thermometer& t)
+void Camera::getStatsRollingMin(double& v)
 {
-	t = (Thermometer)this->_get_param_int(XI_PRM_TEMP_SELECTOR);
+	AutoMutex lock(this->m_stats_mutex);
+	v = this->m_rolling_stats.getMin();
 }
 
-void Camera::setThermometer(Thermometer t)
+void Camera::getStatsRollingMax(double& v)
 {
-	this->_set_param_int(XI_PRM_TEMP_SELECTOR, (int)t);
+	AutoMutex lock(this->m_stats_mutex);
+	v = this->m_rolling_stats.getMax();
 }
 
-void Camera::getTemperature(double& t)
+void Camera::getStatsRollingMean(double& v)
 {
-	t = this->_get_param_dbl(XI_PRM_TEMP);
+	AutoMutex lock(this->m_stats_mutex);
+	v = this->m_rolling_stats.getMean();
 }
 
-void Camera::getTempChip(double& t)
+void Camera::getStatsTime(double& t)
 {
-	t = this->_get_param_dbl(XI_PRM_CHIP_TEMP);
+	AutoMutex lock(this->m_stats_mutex);
+	t = this->m_stats_time;
 }
 
-void Camera::getTempHousing(double& t)
+void Camera::getStatsTimeFraction(double& f)
 {
-	t = this->_get_param_dbl(XI_PRM_HOUS_TEMP);
+	AutoMutex lock(this->m_stats_mutex);
+	f = this->m_stats_time_fraction;
 }
 
-void Camera::getTempBack(double& t)
-{
-	t = this->_get_param_dbl(XI_PRM_HOUS_BACK_SIDE_TEMP);
-}
+// Dark / flat field correction
 
-void Camera::getTempSensor(double& t)
+void Camera::getCorrectionEnabled(bool& e)
 {
-	t = this->_get_param_dbl(XI_PRM_SENSOR_BOARD_TEMP);
+	e = this->m_correction_enabled;
 }
 
-void Camera::getThermalElement(ThermalElement& e)
+void Camera::setCorrectionEnabled(bool e)
 {
-	e = (ThermalElement)this->_get_param_int(XI_PRM_TEMP_ELEMENT_SEL);
+	this->m_correction_enabled = e;
 }
 
-void Camera::setThermalElement(ThermalElement e)
+void Camera::loadDarkMap(const std::string& path)
 {
-	this->_set_param_int(XI_PRM_TEMP_ELEMENT_SEL, (int)e);
+	AutoMutex lock(this->m_correction_mutex);
+	this->m_correction.loadDarkMap(path, this->m_max_width, this->m_max_height);
 }
 
-void Camera::getThermalElementValue(double& v)
+void Camera::loadFlatMap(const std::string& path)
 {
-	v = this->_get_param_dbl(XI_PRM_TEMP_ELEMENT_VALUE);
+	AutoMutex lock(this->m_correction_mutex);
+	this->m_correction.loadFlatMap(path, this->m_max_width, this->m_max_height);
 }
 
-void Camera::setThermalElementValue(double v)
+void Camera::clearDarkMap()
 {
-	this->_set_param_dbl(XI_PRM_TEMP_ELEMENT_VALUE, v);
+	AutoMutex lock(this->m_correction_mutex);
+	this->m_correction.clearDarkMap();
 }
 
-void Camera::getExposureSelector(ExposureSelector& s)
+void Camera::clearFlatMap()
 {
-	s = (ExposureSelector)this->_get_param_int(XI_PRM_EXPOSURE_TIME_SELECTOR);
+	AutoMutex lock(this->m_correction_mutex);
+	this->m_correction.clearFlatMap();
 }
 
-void Camera::setExposureSelector(ExposureSelector s)
+void Camera::getProcessingThreads(int& n)
 {
-	this->_set_param_int(XI_PRM_EXPOSURE_TIME_SELECTOR, (int)s);
+	AutoMutex lock(this->m_correction_mutex);
+	n = this->m_workers.getNbThreads();
 }
 
-void Camera::getBurstCount(int& c)
+void Camera::setProcessingThreads(int n)
 {
-	c = this->_get_param_int(XI_PRM_EXPOSURE_BURST_COUNT);
-}
+	DEB_MEMBER_FUNCT();
 
-void Camera::setBurstCount(int c)
-{
-	this->_set_param_int(XI_PRM_EXPOSURE_BURST_COUNT, c);
+	if(n < 1)
+		THROW_HW_ERROR(InvalidValue) << "At least one processing thread is needed";
+	// the grab thread converts and merges frames on the workers
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Cannot change the processing threads during an acquisition";
+	AutoMutex lock(this->m_correction_mutex);
+	this->m_workers.setNbThreads(n);
 }
 
-void Camera::getDownsampling(Downsampling& d)
+void Camera::getCorrectionTime(double& t)
 {
-	d = (Downsampling)this->_get_param_int(XI_PRM_DOWNSAMPLING);
+	t = this->m_correction_time;
 }
 
-void Camera::setDownsampling(Downsampling d)
+void Camera::getCorrectionThroughput(double& t)
 {
-	this->_set_param_int(XI_PRM_DOWNSAMPLING, (int)d);
+	t = this->m_correction_throughput;
 }
 
-void Camera::getDownsamplingType(DownsamplingType& t)
-{
-	t = (DownsamplingType)this->_get_param_int(XI_PRM_DOWNSAMPLING_TYPE);
-}
+// Pre-trigger ring buffer
 
-void Camera::setDownsamplingType(DownsamplingType t)
+void Camera::getPreTriggerMode(bool& on)
 {
-	this->_set_param_int(XI_PRM_DOWNSAMPLING_TYPE, (int)t);
+	on = this->m_pretrigger_mode;
 }
 
-void Camera::getTestPatternGenerator(TestPatternGenerator& g)
+void Camera::setPreTriggerMode(bool on)
 {
-	g = (TestPatternGenerator)this->_get_param_int(XI_PRM_TEST_PATTERN_GENERATOR_SELECTOR);
+	this->m_pretrigger_mode = on;
 }
 
-void Camera::setTestPatternGenerator(TestPatternGenerator g)
+void Camera::getPreTriggerFrames(int& n)
 {
-	this->_set_param_int(XI_PRM_TEST_PATTERN_GENERATOR_SELECTOR, (int)g);
+	n = this->m_pretrigger_frames;
 }
 
-void Camera::getTestPattern(TestPattern& p)
+void Camera::setPreTriggerFrames(int n)
 {
-	p = (TestPattern)this->_get_param_int(XI_PRM_TEST_PATTERN);
-}
+	DEB_MEMBER_FUNCT();
 
-void Camera::setTestPattern(TestPattern p)
-{
-	this->_set_param_int(XI_PRM_TEST_PATTERN, (int)p);
+	if(n < 0)
+		THROW_HW_ERROR(InvalidValue) << "Number of pre-trigger frames cannot be negative";
+	this->m_pretrigger_frames = n;
 }
 
-void Camera::getImageFormat(ImageFormat& f)
+void Camera::getPreTriggerSource(PreTriggerSource& s)
 {
-	f = (ImageFormat)this->_get_param_int(XI_PRM_IMAGE_DATA_FORMAT);
+	s = this->m_pretrigger_source;
 }
 
-void Camera::setImageFormat(ImageFormat f)
+void Camera::setPreTriggerSource(PreTriggerSource s)
 {
-	this->_set_param_int(XI_PRM_IMAGE_DATA_FORMAT, (int)f);
+	this->m_pretrigger_source = s;
 }
 
-void Camera::getShutter(Shutter& s)
+void Camera::firePreTrigger()
 {
-	s = (Shutter)this->_get_param_int(XI_PRM_SHUTTER_TYPE);
+	this->m_pretrigger_fired = true;
 }
 
-void Camera::setShutter(Shutter s)
+void Camera::getPreTriggerEventFrame(int& n)
 {
-	this->_set_param_int(XI_PRM_SHUTTER_TYPE, (int)s);
+	n = this->m_pretrigger_event_frame;
 }
 
-void Camera::getTaps(Taps& t)
+// Frame accumulation
+
+void Camera::setMaxImageSizeCallbackActive(bool)
 {
-	t = (Taps)this->_get_param_int(XI_PRM_SENSOR_TAPS);
 }
 
-void Camera::setTaps(Taps t)
+void Camera::getAccumulationFrames(int& nb_frames)
 {
-	this->_set_param_int(XI_PRM_SENSOR_TAPS, (int)t);
+	nb_frames = this->m_accumulation_frames;
 }
 
-void Camera::getAutoExposureGain(bool& a)
+void Camera::setAccumulationFrames(int nb_frames)
 {
-	a = (bool)this->_get_param_int(XI_PRM_AEAG);
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+
+	if(nb_frames < 1)
+		THROW_HW_ERROR(InvalidValue) << "Number of accumulated frames must be at least 1";
+
+	bool type_changed = (nb_frames > 1) != (this->m_accumulation_frames > 1);
+	this->m_accumulation_frames = nb_frames;
+	if(type_changed)
+		this->_image_type_changed();
 }
 
-void Camera::setAutoExposureGain(bool a)
+void Camera::_image_type_changed(void)
 {
-	this->_set_param_int(XI_PRM_AEAG, (int)a);
+	// Lima has to reallocate its buffers for the new image type
+	ImageType type;
+	this->getImageType(type);
+	this->maxImageSizeChanged(Size(this->m_max_width, this->m_max_height), type);
 }
 
-void Camera::getAutoWhiteBalance(bool& a)
+void Camera::getAccumulationHwFrames(int frame_nb, int& first_hw_frame, int& last_hw_frame)
 {
-	a = (bool)this->_get_param_int(XI_PRM_AUTO_WB);
+	DEB_MEMBER_FUNCT();
+
+	AutoMutex lock(this->m_accumulation_mutex);
+	if(this->m_accumulated_frames.empty())
+		THROW_HW_ERROR(Error) << "No accumulation in the last acquisition";
+
+	const AccumulatedFrame& f = this->m_accumulated_frames[frame_nb % this->m_accumulated_frames.size()];
+	if(frame_nb < 0 || f.frame_nb != frame_nb)
+		THROW_HW_ERROR(InvalidValue) << "Frame " << frame_nb << " is not in the buffers any more";
+	first_hw_frame = f.first_hw_frame;
+	last_hw_frame = f.last_hw_frame;
 }
 
-void Camera::setAutoWhiteBalance(bool a)
+void Camera::_accumulate_frame(const XI_IMG* image, void* frame_ptr, int frame_nb, bool first)
+{
+	DEB_MEMBER_FUNCT();
+
+	int pixel_size = _get_pixel_size(image->frm);
+	if(!pixel_size)
+	{
+		Exception e = LIMA_HW_EXC(Error, "Unsupported image format for accumulation: " + std::to_string(image->frm));
+		this->reportException(e, "Ximea/Camera/_accumulate_frame");
+		return;
+	}
+
+	size_t stride = image->width * pixel_size + image->padding_x;
+	{
+		AutoMutex lock(this->m_correction_mutex);
+		accumulateFrame((uint32_t*)frame_ptr, image->bp, pixel_size, image->width, image->height, stride, first, this->m_workers);
+	}
+
+	AutoMutex lock(this->m_accumulation_mutex);
+	AccumulatedFrame& f = this->m_accumulated_frames[frame_nb % this->m_accumulated_frames.size()];
+	if(first)
+	{
+		f.frame_nb = frame_nb;
+		f.first_hw_frame = image->nframe;
+	}
+	f.last_hw_frame = image->nframe;
+}
+
+// HDR merge
+
+void Camera::getHdrMergeEnabled(bool& on)
+{
+	on = this->m_hdr_enabled;
+}
+
+void Camera::setHdrMergeEnabled(bool on)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(on);
+
+	if(on == this->m_hdr_enabled)
+		return;
+	this->m_hdr_enabled = on;
+	this->_image_type_changed();
+}
+
+void Camera::getHdrOutputDepth(int& bits)
+{
+	bits = this->m_hdr_output_depth;
+}
+
+void Camera::setHdrOutputDepth(int bits)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(bits);
+
+	if(bits != 16 && bits != 32)
+		THROW_HW_ERROR(InvalidValue) << "HDR output depth must be 16 or 32 bits";
+	if(bits == this->m_hdr_output_depth)
+		return;
+	this->m_hdr_output_depth = bits;
+	if(this->m_hdr_enabled)
+		this->_image_type_changed();
+}
+
+void Camera::getHdrGainRatio(double& r)
+{
+	r = this->m_hdr_gain_ratio;
+}
+
+void Camera::setHdrGainRatio(double r)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(r);
+
+	if(r < 0)
+		THROW_HW_ERROR(InvalidValue) << "HDR gain ratio cannot be negative";
+	this->m_hdr_gain_ratio = r;
+}
+
+void Camera::getHdrKnee(double& k)
+{
+	k = this->m_hdr_knee;
+}
+
+void Camera::setHdrKnee(double k)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(k);
+
+	if(k < 0)
+		THROW_HW_ERROR(InvalidValue) << "HDR knee cannot be negative";
+	this->m_hdr_knee = k;
+}
+
+void Camera::getHdrCalibration(double& gain_ratio, double& knee)
+{
+	AutoMutex lock(this->m_hdr_mutex);
+	gain_ratio = this->m_hdr_calib.gain_ratio;
+	knee = this->m_hdr_calib.knee;
+}
+
+void Camera::clearHdrCalibration()
+{
+	AutoMutex lock(this->m_hdr_mutex);
+	this->m_hdr_cache.clear();
+}
+
+void Camera::getHdrMergeTime(double& t)
+{
+	t = this->m_hdr_merge_time;
+}
+
+void Camera::_calibrate_hdr(const XI_IMG* image, const uint16_t* hg, const uint16_t* lg, size_t stride)
+{
+	HdrCalibration calib;
+	calib.hg_black = image->hg_black_level;
+	calib.lg_black = image->lg_black_level;
+	double hg_range = image->hg_range > 0 ? double(image->hg_range) : double((1 << this->m_stats_bit_depth) - 1);
+	calib.knee = this->m_hdr_knee > 0 ? this->m_hdr_knee : HDR_KNEE_FRACTION * hg_range - calib.hg_black;
+
+	// ratio reported by the camera, else fitted on the pixels both
+	// channels see
+	if(this->m_hdr_gain_ratio > 0)
+		calib.gain_ratio = this->m_hdr_gain_ratio;
+	else if(image->gain_ratio > 0)
+		calib.gain_ratio = image->gain_ratio;
+	else if(!fitHdrGainRatio(hg, lg, image->width, image->height, stride, calib))
+	{
+		if(!this->m_hdr_warned)
+			this->_report_event(EventQueue::Warning, "HDR gain ratio not measurable yet, frames hold high gain only");
+		this->m_hdr_warned = true;
+		return;
+	}
+
+	this->m_hdr_calib = calib;
+	if(this->m_hdr_temperature_valid && this->m_hdr_gain_ratio <= 0 && this->m_hdr_knee <= 0)
+		this->m_hdr_cache.store(this->m_hdr_mode, this->m_hdr_temperature, calib);
+}
+
+void Camera::_merge_hdr(const XI_IMG* image, void* frame_ptr)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(_get_pixel_size(image->frm) != 2)
+	{
+		Exception e = LIMA_HW_EXC(Error, "Unsupported image format for HDR merge: " + std::to_string(image->frm));
+		this->reportException(e, "Ximea/Camera/_merge_hdr");
+		return;
+	}
+
+	size_t stride = image->width * 2 + image->padding_x;
+	const uint16_t* hg = (const uint16_t*)image->bp;
+	const uint16_t* lg = (const uint16_t*)((const char*)image->bp + stride * image->height);
+
+	AutoMutex lock(this->m_hdr_mutex);
+	if(!this->m_hdr_calib.isValid())
+		this->_calibrate_hdr(image, hg, lg, stride);
+	HdrCalibration calib = this->m_hdr_calib;
+	if(!calib.isValid())
+	{
+		// high gain only: the knee is never reached
+		calib.hg_black = image->hg_black_level;
+		calib.gain_ratio = 1;
+		calib.knee = 1e30;
+	}
+
+	Timestamp t0 = Timestamp::now();
+	mergeHdr(frame_ptr, this->m_hdr_output_depth / 8, hg, lg, image->width, image->height, stride, calib, this->m_workers);
+	this->m_hdr_merge_time = Timestamp::now() - t0;
+}
+
+// Demosaic
+
+void Camera::getDemosaicEnabled(bool& on)
+{
+	on = this->m_demosaic_enabled;
+}
+
+void Camera::setDemosaicEnabled(bool on)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(on);
+
+	if(on == this->m_demosaic_enabled)
+		return;
+	// buffers and the frame ring are sized for the current type
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Cannot switch demosaic during an acquisition";
+	this->m_demosaic_enabled = on;
+	this->_image_type_changed();
+}
+
+void Camera::getDemosaicAlgorithm(DemosaicAlgorithm& a)
+{
+	AutoMutex lock(this->m_demosaic_mutex);
+	a = (DemosaicAlgorithm)this->m_demosaic_algorithm;
+}
+
+void Camera::setDemosaicAlgorithm(DemosaicAlgorithm a)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(a);
+
+	AutoMutex lock(this->m_demosaic_mutex);
+	this->m_demosaic_algorithm = (Demosaic::Algorithm)a;
+}
+
+void Camera::getDemosaicThreads(int& n)
+{
+	AutoMutex lock(this->m_demosaic_mutex);
+	n = this->m_demosaic_workers.getNbThreads();
+}
+
+void Camera::setDemosaicThreads(int n)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(n < 1)
+		THROW_HW_ERROR(InvalidValue) << "At least one demosaic thread is needed";
+	// frames are converted on the workers without the lock
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Cannot change the demosaic threads during an acquisition";
+	AutoMutex lock(this->m_demosaic_mutex);
+	this->m_demosaic_workers.setNbThreads(n);
+}
+
+void Camera::getDemosaicTime(double& t)
+{
+	t = this->m_demosaic_time;
+}
+
+void Camera::getDemosaicThroughput(double& t)
+{
+	t = this->m_demosaic_throughput;
+}
+
+void Camera::benchmarkDemosaic(int nb_frames, std::vector<DemosaicThroughput>& results)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+
+	// the workers belong to the acquisition meanwhile
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Demosaic benchmark cannot run during an acquisition";
+
+	int width = this->_get_param_int(XI_PRM_WIDTH);
+	int height = this->_get_param_int(XI_PRM_HEIGHT);
+	AutoMutex lock(this->m_demosaic_mutex);
+	Demosaic::benchmark(width, height, nb_frames, this->m_demosaic_workers, results);
+}
+
+void Camera::_demosaic_frame(const XI_IMG* image, void* frame_ptr)
+{
+	DEB_MEMBER_FUNCT();
+
+	int pixel_size = _get_pixel_size(image->frm);
+	size_t stride = image->width * pixel_size + image->padding_x;
+	try
+	{
+		// settings only under the lock, getters are not held up by a frame
+		Demosaic::Pattern pattern;
+		int bit_depth;
+		{
+			AutoMutex lock(this->m_demosaic_mutex);
+			this->m_demosaic.setAlgorithm(this->m_demosaic_algorithm);
+			pattern = this->m_demosaic_pattern;
+			bit_depth = this->m_demosaic_bit_depth;
+		}
+		Timestamp t0 = Timestamp::now();
+		this->m_demosaic.process((uint32_t*)frame_ptr, image->bp, pixel_size, bit_depth,
+			image->width, image->height, stride, pattern, this->m_demosaic_workers);
+		double dt = Timestamp::now() - t0;
+		this->m_demosaic_time = dt;
+		this->m_demosaic_throughput = dt > 0 ? double(image->width) * image->height / dt / 1e6 : 0;
+	}
+	catch(Exception& e)
+	{
+		this->reportException(e, "Ximea/Camera/_demosaic_frame");
+	}
+}
+
+// Live view
+
+void Camera::getLiveViewMode(LiveViewMode& m)
+{
+	m = (LiveViewMode)this->m_live_view.getMode();
+}
+
+void Camera::setLiveViewMode(LiveViewMode m)
+{
+	this->m_live_view.setMode((LiveView::Mode)m);
+}
+
+void Camera::getLiveViewDecimation(int& n)
+{
+	n = this->m_live_view.getDecimation();
+}
+
+void Camera::setLiveViewDecimation(int n)
+{
+	this->m_live_view.setDecimation(n);
+}
+
+void Camera::getLiveViewRate(double& r)
+{
+	r = this->m_live_view.getRate();
+}
+
+void Camera::setLiveViewRate(double r)
+{
+	this->m_live_view.setRate(r);
+}
+
+void Camera::getLiveViewDownscale(int& d)
+{
+	d = this->m_live_view.getDownscale();
+}
+
+void Camera::setLiveViewDownscale(int d)
+{
+	this->m_live_view.setDownscale(d);
+}
+
+void Camera::getLiveView8Bit(bool& c)
+{
+	c = this->m_live_view.getConvert8Bit();
+}
+
+void Camera::setLiveView8Bit(bool c)
+{
+	this->m_live_view.setConvert8Bit(c);
+}
+
+void Camera::getLiveImage(LiveView::Frame& frame)
+{
+	if(!this->m_live_view.getLatest(frame))
+		frame = LiveView::Frame();
+}
+
+void Camera::_publish_live_view(const XI_IMG* image, int frame_nb)
+{
+	// demosaiced frames too: the raw mosaic is what downscaling and the
+	// 8 bit conversion can average
+	int pixel_size = _get_pixel_size(image->frm);
+	if(pixel_size)
+		this->m_live_view.publish(image->bp, pixel_size, image->width, image->height,
+			image->width * pixel_size + image->padding_x, frame_nb);
+}
+
+void Camera::_publish_live_view(const void* frame_ptr, int width, int height, int frame_nb)
+{
+	// frames summed or merged by the grab thread, as Lima has them
+	int pixel_size = this->m_accumulation_frames > 1 ? 4 : this->m_hdr_output_depth / 8;
+	this->m_live_view.publish(frame_ptr, pixel_size, width, height, size_t(width) * pixel_size, frame_nb);
+}
+
+// Frame rate model
+
+bool Camera::_is_acquiring(void)
+{
+	return this->m_acq_thread && this->m_acq_thread->hasStarted() && !this->m_acq_thread->hasFinished();
+}
+
+void Camera::getExpTimeRange(double& min_exp_time, double& max_exp_time)
+{
+	min_exp_time = this->_get_param_min(XI_PRM_EXPOSURE) / TIME_HW;
+	max_exp_time = this->_get_param_max(XI_PRM_EXPOSURE) / TIME_HW;
+}
+
+void Camera::_get_timing_key(int bits, const Bin& bin, TimingKey& key)
+{
+	Mode mode;
+	Shutter shutter;
+	Taps taps;
+	this->getMode(mode);
+	this->getShutter(shutter);
+	this->getTaps(taps);
+
+	key.clear();
+	key.push_back(mode);
+	key.push_back(bits);
+	key.push_back(bin.getX());
+	key.push_back(bin.getY());
+	key.push_back(shutter);
+	key.push_back(taps);
+}
+
+double Camera::_get_bandwidth(void)
+{
+	// Mbit/s to bytes/s
+	double bandwidth;
+	this->getAvailableBandwidth(bandwidth);
+	bool limited;
+	this->getBandwidthLimitEnabled(limited);
+	if(limited)
+	{
+		double limit;
+		this->getBandwidthLimit(limit);
+		bandwidth = std::min(bandwidth, limit);
+	}
+	return bandwidth * 1e6 / 8;
+}
+
+void Camera::_calibrate_timing(SensorTiming& timing)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Timing calibration needs an idle camera";
+
+	int height = this->_get_param_int(XI_PRM_HEIGHT);
+	int offset_y = this->_get_param_int(XI_PRM_OFFSET_Y);
+	int exposure = this->_get_param_int(XI_PRM_EXPOSURE);
+	timing.min_exp_time = this->_get_param_min(XI_PRM_EXPOSURE) / TIME_HW;
+	timing.max_exp_time = this->_get_param_max(XI_PRM_EXPOSURE) / TIME_HW;
+
+	// the shortest frame period at minimum exposure is the readout time;
+	// measure it at two heights to split line time and frame overhead
+	try
+	{
+		this->_set_param_int(XI_PRM_OFFSET_Y, 0);
+		this->_set_param_int(XI_PRM_EXPOSURE, this->_get_param_min(XI_PRM_EXPOSURE));
+		int h_full = this->_get_param_max(XI_PRM_HEIGHT);
+		int h_inc = this->_get_param_inc(XI_PRM_HEIGHT);
+		int h_small = std::max(this->_get_param_min(XI_PRM_HEIGHT), h_full / 4 / h_inc * h_inc);
+
+		this->_set_param_int(XI_PRM_HEIGHT, h_full);
+		double t_full = 1 / this->_get_param_dbl_max(XI_PRM_FRAMERATE);
+		this->_set_param_int(XI_PRM_HEIGHT, h_small);
+		double t_small = 1 / this->_get_param_dbl_max(XI_PRM_FRAMERATE);
+
+		timing.line_time = h_full > h_small ? (t_full - t_small) / (h_full - h_small) : 0;
+		timing.frame_overhead = std::max(0., t_small - h_small * timing.line_time);
+
+		// exposing as long as the readout: an overlapping sensor keeps the
+		// period, another one doubles it
+		int probe = std::min(int(t_full * TIME_HW), this->_get_param_max(XI_PRM_EXPOSURE));
+		this->_set_param_int(XI_PRM_HEIGHT, h_full);
+		this->_set_param_int(XI_PRM_EXPOSURE, probe);
+		double t_probe = 1 / this->_get_param_dbl_max(XI_PRM_FRAMERATE);
+		timing.overlap = t_probe < t_full + OVERLAP_PROBE_FRACTION * probe / TIME_HW;
+	}
+	catch(Exception& e)
+	{
+		this->_set_param_int(XI_PRM_HEIGHT, height);
+		this->_set_param_int(XI_PRM_OFFSET_Y, offset_y);
+		this->_set_param_int(XI_PRM_EXPOSURE, exposure);
+		throw;
+	}
+	this->_set_param_int(XI_PRM_HEIGHT, height);
+	this->_set_param_int(XI_PRM_OFFSET_Y, offset_y);
+	this->_set_param_int(XI_PRM_EXPOSURE, exposure);
+
+	DEB_TRACE() << DEB_VAR3(timing.line_time, timing.frame_overhead, timing.overlap);
+}
+
+void Camera::_seed_timing(SensorTiming& timing)
+{
+	DEB_MEMBER_FUNCT();
+
+	timing.min_exp_time = this->_get_param_min(XI_PRM_EXPOSURE) / TIME_HW;
+	timing.max_exp_time = this->_get_param_max(XI_PRM_EXPOSURE) / TIME_HW;
+
+	// read-only: the sensor overlaps as triggers are set to, the current
+	// maximum frame rate gives the period of the configuration in place
+	int overlap = this->m_trigger_overlap;
+	this->_query_int(XI_PRM_TRG_OVERLAP, overlap);
+	timing.overlap = overlap != TriggerOverlap_Off;
+	try
+	{
+		double period = 1 / this->_get_param_dbl_max(XI_PRM_FRAMERATE);
+		double exp_time = this->_get_param_int(XI_PRM_EXPOSURE) / TIME_HW;
+		// overlapping, an exposure bound period only bounds the readout
+		double readout = timing.overlap ? period : std::max(0., period - exp_time);
+		timing.line_time = readout / this->_get_param_int(XI_PRM_HEIGHT);
+	}
+	catch(Exception& e)
+	{
+		DEB_WARNING() << "No frame rate limit from the camera, readout left out of the model: " << e.getErrMsg();
+	}
+	DEB_TRACE() << DEB_VAR2(timing.line_time, timing.overlap);
+}
+
+void Camera::calibrateTiming()
+{
+	Bin bin;
+	this->getBin(bin);
+	TimingKey key;
+	this->_get_timing_key(this->_get_param_int(XI_PRM_IMAGE_DATA_BIT_DEPTH), bin, key);
+
+	SensorTiming timing;
+	this->_calibrate_timing(timing);
+	this->m_sensor_timings[key] = timing;
+}
+
+void Camera::predictTiming(double exp_time, const Roi& roi, const Bin& bin, ImageType type, TimingPrediction& prediction)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR4(exp_time, roi, bin, type);
+
+	TimingKey key;
+	this->_get_timing_key(FrameDim::getImageTypeBpp(type), bin, key);
+	std::map<TimingKey, SensorTiming>::const_iterator it = this->m_sensor_timings.find(key);
+	prediction.calibrated = it != this->m_sensor_timings.end();
+	if(!prediction.calibrated)
+	{
+		// calibration reconfigures the camera, it only runs on request:
+		// approximate with the current configuration when it was measured
+		Bin current_bin;
+		this->getBin(current_bin);
+		TimingKey current_key;
+		this->_get_timing_key(this->_get_param_int(XI_PRM_IMAGE_DATA_BIT_DEPTH), current_bin, current_key);
+		it = this->m_sensor_timings.find(current_key);
+	}
+
+	// nothing measured yet, seeded from the camera frame rate limit
+	SensorTiming uncalibrated;
+	if(it == this->m_sensor_timings.end())
+		this->_seed_timing(uncalibrated);
+	const SensorTiming& timing = it != this->m_sensor_timings.end() ? it->second : uncalibrated;
+
+	Size size = roi.getSize();
+	if(size.isEmpty())
+		size = Size(this->m_max_width / bin.getX(), this->m_max_height / bin.getY());
+	double frame_bytes = double(size.getWidth()) * size.getHeight() * FrameDim::getImageTypeDepth(type);
+
+	// overlap as the camera has it, the setting otherwise
+	int overlap = this->m_trigger_overlap;
+	this->_query_int(XI_PRM_TRG_OVERLAP, overlap);
+	FrameRateModel::predict(timing, exp_time, size.getHeight(), frame_bytes, this->_get_bandwidth(),
+		overlap != TriggerOverlap_Off, prediction);
+	DEB_RETURN() << DEB_VAR3(prediction.readout_time, prediction.max_fps, prediction.calibrated);
+}
+
+void Camera::getTimingPrediction(TimingPrediction& prediction)
+{
+	double exp_time;
+	Roi roi;
+	Bin bin;
+	this->getExpTime(exp_time);
+	this->getRoi(roi);
+	this->getBin(bin);
+
+	ImageType type;
+	this->_get_sensor_image_type(type);
+	this->predictTiming(exp_time, roi, bin, type, prediction);
+}
+
+// Mode characterization
+
+void Camera::BenchmarkDevice::getModes(std::vector<int>& modes)
+{
+	static const Mode all_modes[] = {
+		Mode_12_STD_L, Mode_12_STD_H, Mode_14_STD_L, Mode_14_STD_H,
+		Mode_2_12_CMS_S_L, Mode_2_12_CMS_S_H, Mode_2_14_CMS_S_L, Mode_2_14_CMS_S_H,
+		Mode_4_12_CMS_S_L, Mode_4_12_CMS_S_H, Mode_4_14_CMS_S_L, Mode_4_14_CMS_S_H,
+		Mode_2_12_HDR_HL, Mode_2_12_HDR_L, Mode_2_12_HDR_H, Mode_4_12_CMS_HDR_HL,
+		Mode_2_14_HDR_L, Mode_2_14_HDR_H, Mode_2_12_CMS_A_L, Mode_2_12_CMS_A_H
+	};
+	modes.assign(all_modes, all_modes + sizeof(all_modes) / sizeof(all_modes[0]));
+}
+
+void Camera::BenchmarkDevice::configure(const BenchmarkPoint& point)
+{
+	DEB_MEMBER_FUNCT();
+
+	ImageType type;
+	switch(point.bit_depth)
+	{
+		case 8:
+			type = Bpp8;
+			break;
+		case 10:
+			type = Bpp10;
+			break;
+		case 12:
+			type = Bpp12;
+			break;
+		case 14:
+			type = Bpp14;
+			break;
+		case 16:
+			type = Bpp16;
+			break;
+		default:
+			THROW_HW_ERROR(InvalidValue) << "Unsupported bit depth " << point.bit_depth;
+	}
+
+	// the user set first, it resets the rest
+	Camera& cam = this->m_cam;
+	cam.setMode((Mode)point.mode);
+	cam.setImageType(type);
+	Bin bin;
+	cam.getBin(bin);
+	cam.setRoi(point.roi.isActive() ? point.roi : Roi(0, 0, cam.m_max_width / bin.getX(), cam.m_max_height / bin.getY()));
+	cam._set_param_int(XI_PRM_EXPOSURE, cam._get_param_min(XI_PRM_EXPOSURE));
+	cam._set_param_int(XI_PRM_TRG_SOURCE, XI_TRG_OFF);
+}
+
+double Camera::BenchmarkDevice::getExposureTime()
+{
+	return this->m_cam._get_param_int(XI_PRM_EXPOSURE) / TIME_HW;
+}
+
+double Camera::BenchmarkDevice::getLinkBandwidth()
+{
+	return this->m_cam._get_bandwidth() / 1e6;
+}
+
+void Camera::BenchmarkDevice::start()
+{
+	this->m_buffer.resize(this->m_cam._get_param_int(XI_PRM_IMAGE_PAYLOAD_SIZE));
+	this->m_timeout = this->m_cam._get_trigger_timeout();
+	xiStartAcquisition(this->m_cam.xiH);
+}
+
+void Camera::BenchmarkDevice::readFrame(Frame& frame)
+{
+	DEB_MEMBER_FUNCT();
+
+	Camera& cam = this->m_cam;
+	memset(&this->m_image, 0, sizeof(this->m_image));
+	this->m_image.bp = &this->m_buffer[0];
+	this->m_image.bp_size = this->m_buffer.size();
+	cam._read_image(&this->m_image, this->m_timeout);
+	if(cam.xi_status != XI_OK)
+		THROW_HW_ERROR(Error) << "Benchmark readout failed; xi_status: " << cam.xi_status;
+
+	frame.pixel_size = _get_pixel_size(this->m_image.frm);
+	if(!frame.pixel_size)
+		THROW_HW_ERROR(Error) << "Unsupported image format for benchmarks: " << this->m_image.frm;
+	frame.data = this->m_image.bp;
+	frame.width = this->m_image.width;
+	frame.height = this->m_image.height;
+	frame.stride = this->m_image.width * frame.pixel_size + this->m_image.padding_x;
+	frame.timestamp = this->m_image.tsSec + this->m_image.tsUSec * 1e-6;
+}
+
+void Camera::BenchmarkDevice::stop()
+{
+	xiStopAcquisition(this->m_cam.xiH);
+}
+
+void Camera::getBenchmarkModes(std::vector<int>& modes)
+{
+	modes = this->m_benchmark_modes;
+}
+
+void Camera::setBenchmarkModes(const std::vector<int>& modes)
+{
+	this->m_benchmark_modes = modes;
+}
+
+void Camera::getBenchmarkRois(std::vector<Roi>& rois)
+{
+	rois = this->m_benchmark_rois;
+}
+
+void Camera::setBenchmarkRois(const std::vector<Roi>& rois)
+{
+	this->m_benchmark_rois = rois;
+}
+
+void Camera::getBenchmarkBitDepths(std::vector<int>& bit_depths)
+{
+	bit_depths = this->m_benchmark_bit_depths;
+}
+
+void Camera::setBenchmarkBitDepths(const std::vector<int>& bit_depths)
+{
+	this->m_benchmark_bit_depths = bit_depths;
+}
+
+void Camera::getBenchmarkFrames(int& n)
+{
+	n = this->m_benchmark.getNbFrames();
+}
+
+void Camera::setBenchmarkFrames(int n)
+{
+	this->m_benchmark.setNbFrames(n);
+}
+
+void Camera::runBenchmark(const std::string& report_path)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(report_path);
+
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Cannot run a benchmark during an acquisition";
+
+	// every point reloads a user set, the settings are put back as a
+	// profile would
+	Profile saved;
+	ProfileWalk walk;
+	walk.read = &saved;
+	walk.target = NULL;
+	walk.nb_writes = 0;
+	this->_walk_profile(walk);
+
+	vector<int> bit_depths = this->m_benchmark_bit_depths;
+	if(bit_depths.empty())
+		bit_depths.push_back(this->_get_param_int(XI_PRM_IMAGE_DATA_BIT_DEPTH));
+
+	BenchmarkDevice device(*this);
+	vector<BenchmarkPoint> points;
+	Benchmark::getPoints(device, this->m_benchmark_modes, this->m_benchmark_rois, bit_depths, points);
+	Timestamp start = Timestamp::now();
+	this->m_benchmark.run(device, points);
+	DEB_TRACE() << points.size() << " benchmark points in " << double(Timestamp::now() - start) << " s";
+
+	ProfileWalk restore;
+	restore.read = NULL;
+	restore.target = &saved;
+	restore.nb_writes = 0;
+	this->_walk_profile(restore);
+	// points run free, the trigger source is not part of the walk
+	this->setTrigMode(this->m_trigger_mode);
+
+	if(!report_path.empty())
+		this->m_benchmark.writeReport(report_path);
+
+	// results are kept, but the camera is not as the user left it
+	if(!restore.errors.empty())
+	{
+		ostringstream errors;
+		for(size_t i = 0; i < restore.errors.size(); ++i)
+			errors << (i ? ", " : "") << restore.errors[i];
+		THROW_HW_ERROR(Error) << "Benchmark done, could not restore " << errors.str()
+			<< ": the camera keeps the last benchmark settings for them";
+	}
+}
+
+void Camera::getBenchmarkResults(std::vector<BenchmarkResult>& results)
+{
+	results = this->m_benchmark.getResults();
+}
+
+// Dark frame cache
+
+namespace
+{
+	template <typename T>
+	void _accumulate(const XI_IMG* image, size_t stride, vector<double>& sum)
+	{
+		for(int y = 0; y < (int)image->height; ++y)
+		{
+			const T* row = (const T*)((const char*)image->bp + y * stride);
+			double* s = &sum[size_t(y) * image->width];
+			for(int x = 0; x < (int)image->width; ++x)
+				s[x] += row[x];
+		}
+	}
+} // namespace
+
+void Camera::getDarkCacheEnabled(bool& e)
+{
+	e = this->m_dark_cache_enabled;
+}
+
+void Camera::setDarkCacheEnabled(bool e)
+{
+	this->m_dark_cache_enabled = e;
+}
+
+void Camera::getDarkCacheDir(std::string& dir)
+{
+	dir = this->m_dark_library.getCacheDir();
+}
+
+void Camera::setDarkCacheDir(const std::string& dir)
+{
+	this->m_dark_library.setCacheDir(dir);
+}
+
+void Camera::getDarkTempTolerance(double& t)
+{
+	t = this->m_dark_library.getTempTolerance();
+}
+
+void Camera::setDarkTempTolerance(double t)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(t <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Temperature tolerance must be positive";
+	this->m_dark_library.setTempTolerance(t);
+}
+
+void Camera::getDarkCacheSize(int& n)
+{
+	n = this->m_dark_library.getNbEntries();
+}
+
+void Camera::acquireDark(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+
+	if(nb_frames < 1)
+		THROW_HW_ERROR(InvalidValue) << "At least one frame is needed";
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Cannot acquire darks during an acquisition";
+
+	// the camera has no shutter, the beam must be off
+	DarkKey key;
+	this->_get_dark_key(key);
+	int width = key.roi.getSize().getWidth();
+	int height = key.roi.getSize().getHeight();
+
+	vector<char> buffer(this->_get_param_int(XI_PRM_IMAGE_PAYLOAD_SIZE));
+	vector<double> sum(size_t(width) * height, 0.);
+	int timeout = this->_get_trigger_timeout();
+
+	// free run, whatever the trigger mode
+	TrigMode trigger_mode = this->m_trigger_mode;
+	this->_set_param_int(XI_PRM_TRG_SOURCE, XI_TRG_OFF);
+	xiStartAcquisition(this->xiH);
+	try
+	{
+		for(int i = 0; i < nb_frames; ++i)
+		{
+			XI_IMG image;
+			memset(&image, 0, sizeof(image));
+			image.bp = &buffer[0];
+			image.bp_size = buffer.size();
+			this->_read_image(&image, timeout);
+			if(this->xi_status != XI_OK)
+				THROW_HW_ERROR(Error) << "Dark readout failed; xi_status: " << this->xi_status;
+			if((int)image.width != width || (int)image.height != height)
+				THROW_HW_ERROR(Error) << "Unexpected dark frame size " << image.width << "x" << image.height;
+
+			size_t stride = image.width * _get_pixel_size(image.frm) + image.padding_x;
+			switch(_get_pixel_size(image.frm))
+			{
+				case 1:
+					_accumulate<uint8_t>(&image, stride, sum);
+					break;
+				case 2:
+					_accumulate<uint16_t>(&image, stride, sum);
+					break;
+				case 4:
+					_accumulate<uint32_t>(&image, stride, sum);
+					break;
+				default:
+					THROW_HW_ERROR(Error) << "Unsupported image format for darks: " << image.frm;
+			}
+		}
+	}
+	catch(Exception& e)
+	{
+		xiStopAcquisition(this->xiH);
+		this->setTrigMode(trigger_mode);
+		throw;
+	}
+	xiStopAcquisition(this->xiH);
+	this->setTrigMode(trigger_mode);
+
+	// key the dark with the mean temperature over the acquisition, NaN
+	// when either reading is missing
+	double temperature;
+	try
+	{
+		this->getTempSensor(temperature);
+	}
+	catch(Exception& e)
+	{
+		temperature = std::numeric_limits<double>::quiet_NaN();
+	}
+	key.temperature = (key.temperature + temperature) / 2;
+
+	vector<float> dark(sum.size());
+	for(size_t i = 0; i < sum.size(); ++i)
+		dark[i] = float(sum[i] / nb_frames);
+	this->m_dark_library.store(key, nb_frames, dark);
+}
+
+void Camera::clearDarkCache()
+{
+	this->m_dark_library.clear();
+	this->m_dark_match = DarkMatch_None;
+}
+
+void Camera::getDarkMatch(DarkMatch& m)
+{
+	m = this->m_dark_match;
+}
+
+void Camera::getDarkStale(bool& s)
+{
+	// without a thermometer a dark cannot be seen to go stale
+	double temperature;
+	try
+	{
+		this->getTempSensor(temperature);
+	}
+	catch(Exception& e)
+	{
+		s = false;
+		return;
+	}
+	s = this->m_dark_match != DarkMatch_None && this->m_dark_library.isStale(this->m_dark_key, temperature);
+}
+
+// SDK buffers
+
+void Camera::_size_sdk_buffers(void)
+{
+	DEB_MEMBER_FUNCT();
+
+	int payload = this->_get_param_int(XI_PRM_IMAGE_PAYLOAD_SIZE);
+
+	// the queue absorbs a burst at the highest rate the prepared settings
+	// allow, as the camera reports it rather than the model
+	int queue_size = this->m_sdk_queue_size_override;
+	if(!queue_size)
+	{
+		double max_fps = this->_get_param_dbl_max(XI_PRM_FRAMERATE);
+		queue_size = int(ceil(this->m_sdk_burst_time * max_fps));
+		queue_size = std::max(queue_size, this->_get_param_min(XI_PRM_BUFFERS_QUEUE_SIZE));
+		queue_size = std::min(queue_size, this->_get_param_max(XI_PRM_BUFFERS_QUEUE_SIZE));
+	}
+
+	// the acquisition buffer holds the queue plus the frames in transfer
+	this->_set_param_int(XI_PRM_ACQ_BUFFER_SIZE_UNIT, 1 << 20);
+	int acq_buffer_size = this->m_sdk_acq_buffer_size_override;
+	if(!acq_buffer_size)
+	{
+		double size = (double(queue_size) + 2) * payload / (1 << 20);
+		acq_buffer_size = std::max(int(ceil(size)), this->_get_param_min(XI_PRM_ACQ_BUFFER_SIZE));
+		if(acq_buffer_size > this->_get_param_max(XI_PRM_ACQ_BUFFER_SIZE))
+		{
+			acq_buffer_size = this->_get_param_max(XI_PRM_ACQ_BUFFER_SIZE);
+			// fewer queued frames than asked for, keep them consistent
+			queue_size = std::max(1, int(double(acq_buffer_size) * (1 << 20) / payload) - 2);
+			DEB_WARNING() << "SDK buffer limited to " << acq_buffer_size << " MiB, queue reduced to " << queue_size << " frames";
+		}
+	}
+
+	// one frame per transfer, rounded up to the transport granularity
+	int transport_size = this->m_sdk_transport_buffer_size_override;
+	if(!transport_size)
+	{
+		int inc = std::max(1, this->_get_param_inc(XI_PRM_ACQ_TRANSPORT_BUFFER_SIZE));
+		transport_size = (payload + inc - 1) / inc * inc;
+		transport_size = std::max(transport_size, this->_get_param_min(XI_PRM_ACQ_TRANSPORT_BUFFER_SIZE));
+		transport_size = std::min(transport_size, this->_get_param_max(XI_PRM_ACQ_TRANSPORT_BUFFER_SIZE));
+	}
+
+	DEB_TRACE() << DEB_VAR4(payload, queue_size, acq_buffer_size, transport_size);
+	this->_set_param_int(XI_PRM_ACQ_BUFFER_SIZE, acq_buffer_size);
+	this->_set_param_int(XI_PRM_BUFFERS_QUEUE_SIZE, queue_size);
+	this->_set_param_int(XI_PRM_ACQ_TRANSPORT_BUFFER_SIZE, transport_size);
+}
+
+bool Camera::_get_counter(CounterSelector s, int& value)
+{
+	// the API only reads the selected counter: switch the selector and
+	// put it back for the counter attributes and the monitor, leaving
+	// xi_status to the acquisition thread
+	AutoMutex lock(this->m_selector_mutex);
+	int selector;
+	if(xiGetParamInt(this->xiH, XI_PRM_COUNTER_SELECTOR, &selector) != XI_OK)
+		return false;
+	if(xiSetParamInt(this->xiH, XI_PRM_COUNTER_SELECTOR, s) != XI_OK)
+		return false;
+	bool ok = xiGetParamInt(this->xiH, XI_PRM_COUNTER_VALUE, &value) == XI_OK;
+	xiSetParamInt(this->xiH, XI_PRM_COUNTER_SELECTOR, selector);
+	return ok;
+}
+
+bool Camera::_get_sdk_queue_occupancy(int& nb_frames)
+{
+	// frames handed over by the transport minus the ones the SDK dropped
+	// and the ones read so far
+	int transferred, skipped;
+	if(!this->_get_counter(CounterSelector_Transferred_Frames, transferred) ||
+	   !this->_get_counter(CounterSelector_Skipped_Frames_API, skipped))
+		return false;
+	nb_frames = std::max(0, transferred - skipped - this->m_sdk_frames_read);
+	return true;
+}
+
+void Camera::_sample_sdk_queue(Timestamp& last_sample)
+{
+	// from the grab thread, the only writer of the high-water mark
+	Timestamp now = Timestamp::now();
+	if(last_sample.isSet() && double(now - last_sample) < SDK_QUEUE_SAMPLE_PERIOD)
+		return;
+	last_sample = now;
+	int nb_frames;
+	if(this->_get_sdk_queue_occupancy(nb_frames))
+		this->m_sdk_queue_high_water = std::max(this->m_sdk_queue_high_water, nb_frames);
+}
+
+void Camera::getSdkBurstTime(double& t)
+{
+	t = this->m_sdk_burst_time;
+}
+
+void Camera::setSdkBurstTime(double t)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(t);
+
+	if(t <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Burst time must be positive";
+	this->m_sdk_burst_time = t;
+}
+
+void Camera::getSdkQueueSizeOverride(int& nb_frames)
+{
+	nb_frames = this->m_sdk_queue_size_override;
+}
+
+void Camera::setSdkQueueSizeOverride(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+
+	if(nb_frames < 0)
+		THROW_HW_ERROR(InvalidValue) << "Queue size must be positive, 0 for automatic";
+	this->m_sdk_queue_size_override = nb_frames;
+}
+
+void Camera::getSdkAcqBufferSizeOverride(int& size_mb)
+{
+	size_mb = this->m_sdk_acq_buffer_size_override;
+}
+
+void Camera::setSdkAcqBufferSizeOverride(int size_mb)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(size_mb);
+
+	if(size_mb < 0)
+		THROW_HW_ERROR(InvalidValue) << "Buffer size must be positive, 0 for automatic";
+	this->m_sdk_acq_buffer_size_override = size_mb;
+}
+
+void Camera::getSdkTransportBufferSizeOverride(int& size)
+{
+	size = this->m_sdk_transport_buffer_size_override;
+}
+
+void Camera::setSdkTransportBufferSizeOverride(int size)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(size);
+
+	if(size < 0)
+		THROW_HW_ERROR(InvalidValue) << "Transport buffer size must be positive, 0 for automatic";
+	this->m_sdk_transport_buffer_size_override = size;
+}
+
+void Camera::getSdkQueueSize(int& nb_frames)
+{
+	nb_frames = this->_get_param_int(XI_PRM_BUFFERS_QUEUE_SIZE);
+}
+
+void Camera::getSdkAcqBufferSize(int& size_mb)
+{
+	// in the unit last set, MiB after a prepareAcq
+	double unit = this->_get_param_int(XI_PRM_ACQ_BUFFER_SIZE_UNIT);
+	size_mb = int(this->_get_param_int(XI_PRM_ACQ_BUFFER_SIZE) * unit / (1 << 20));
+}
+
+void Camera::getSdkTransportBufferSize(int& size)
+{
+	size = this->_get_param_int(XI_PRM_ACQ_TRANSPORT_BUFFER_SIZE);
+}
+
+void Camera::getSdkQueueOccupancy(int& nb_frames)
+{
+	nb_frames = 0;
+	if(this->_is_acquiring() && !this->_get_sdk_queue_occupancy(nb_frames))
+		nb_frames = 0;
+}
+
+void Camera::getSdkQueueHighWater(int& nb_frames)
+{
+	nb_frames = this->m_sdk_queue_high_water;
+}
+
+// Frame buffers
+
+void Camera::getBufferHugePages(bool& h)
+{
+	h = this->m_buffer_ctrl_obj.getAllocMgr().getHugePages();
+}
+
+void Camera::setBufferHugePages(bool h)
+{
+	this->m_buffer_ctrl_obj.getAllocMgr().setHugePages(h);
+}
+
+void Camera::getBufferPrefault(bool& p)
+{
+	p = this->m_buffer_prefault;
+}
+
+void Camera::setBufferPrefault(bool p)
+{
+	this->m_buffer_prefault = p;
+}
+
+void Camera::getBufferLock(bool& l)
+{
+	l = this->m_buffer_lock;
+}
+
+void Camera::setBufferLock(bool l)
+{
+	this->m_buffer_lock = l;
+}
+
+void Camera::getBufferPages(BufferPages& p)
+{
+	p = (BufferPages)this->m_buffer_ctrl_obj.getAllocMgr().getPages();
+}
+
+void Camera::getBufferPrefaultTime(double& t)
+{
+	t = this->m_buffer_prefault_time;
+}
+
+// NUMA
+
+void Camera::getNumaNbNodes(int& n)
+{
+	n = Numa::getNbNodes();
+}
+
+void Camera::getNumaDeviceNode(int& node)
+{
+	node = this->m_numa_device_node;
+}
+
+void Camera::getNumaNode(int& node)
+{
+	node = this->m_numa_node;
+}
+
+void Camera::setNumaNode(int node)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(node);
+
+	if(node < -1 || node >= Numa::getNbNodes())
+		THROW_HW_ERROR(InvalidValue) << "Invalid NUMA node " << node << ", " << Numa::getNbNodes() << " node(s)";
+	this->m_numa_node = node;
+}
+
+void Camera::getNumaPlacementNode(int& node)
+{
+	node = this->m_numa_placement_node;
+}
+
+void Camera::getNumaBufferNode(int& node)
+{
+	node = this->m_buffer_ctrl_obj.getAllocMgr().getBufferNode();
+}
+
+void Camera::getNumaAcqThreadNode(int& node)
+{
+	node = this->m_numa_acq_thread_node;
+}
+
+// Parameter updates while acquiring
+
+void Camera::_apply_pending_params(void)
+{
+	DEB_MEMBER_FUNCT();
+
+	bool set_exp, set_gain;
+	int exp, gain;
+	{
+		AutoMutex lock(this->m_params_mutex);
+		set_exp = this->m_exp_pending;
+		set_gain = this->m_gain_pending;
+		exp = this->m_pending_exp;
+		gain = this->m_pending_gain;
+		this->m_exp_pending = this->m_gain_pending = false;
+		this->m_params_pending = false;
+	}
+
+	DEB_TRACE() << DEB_VAR4(set_exp, exp, set_gain, gain);
+	if(set_exp)
+		this->_apply_param(XI_PRM_EXPOSURE, exp);
+	if(set_gain)
+		this->_apply_param(XI_PRM_GAIN, gain);
+}
+
+void Camera::_check_param_range(const char* param, int value)
+{
+	DEB_MEMBER_FUNCT();
+
+	// the limits of the current settings; accepted when unknown
+	int min_value, max_value;
+	if(!this->_query_int((string(param) + XI_PRM_INFO_MIN).c_str(), min_value) ||
+	   !this->_query_int((string(param) + XI_PRM_INFO_MAX).c_str(), max_value))
+		return;
+	if(value < min_value || value > max_value)
+		THROW_HW_ERROR(InvalidValue) << "Parameter " << param << " " << value << " out of range ["
+			<< min_value << ", " << max_value << "]";
+}
+
+bool Camera::_apply_param(const char* param, int value)
+{
+	DEB_MEMBER_FUNCT();
+
+	// from the grab thread: xi_status holds the frame read status
+	int status = xiSetParamInt(this->xiH, param, value);
+	if(status == XI_OK)
+		return true;
+	DEB_WARNING() << "Parameter " << param << " " << value << " rejected, " << DEB_VAR1(status);
+	EventQueue::Record event(EventQueue::Warning, EventQueue::ParamRejected, param, value);
+	event.status = status;
+	this->_report_event(event);
+	return false;
+}
+
+// Exposure sequence
+
+void Camera::setExposureSequence(const std::vector<double>& exp_times, const std::vector<double>& gains)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(exp_times.size(), gains.size());
+
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Exposure sequence cannot change while acquiring";
+	if(!gains.empty() && gains.size() != exp_times.size())
+		THROW_HW_ERROR(InvalidValue) << "Sequence has " << exp_times.size() << " exposures but " << gains.size() << " gains";
+
+	double min_exp_time, max_exp_time;
+	if(!exp_times.empty())
+		this->getExpTimeRange(min_exp_time, max_exp_time);
+	for(size_t i = 0; i < exp_times.size(); ++i)
+		if(exp_times[i] < min_exp_time || exp_times[i] > max_exp_time)
+			THROW_HW_ERROR(InvalidValue) << "Sequence exposure " << exp_times[i] << " s out of ["
+				<< min_exp_time << ", " << max_exp_time << "] s";
+	this->m_sequence_exp = exp_times;
+	this->m_sequence_gain = gains;
+}
+
+void Camera::getExposureSequence(std::vector<double>& exp_times, std::vector<double>& gains)
+{
+	exp_times = this->m_sequence_exp;
+	gains = this->m_sequence_gain;
+}
+
+void Camera::getSequenceMismatches(int& n)
+{
+	n = this->m_sequence_mismatches;
+}
+
+void Camera::_start_sequence()
+{
+	DEB_MEMBER_FUNCT();
+
+	this->m_sequence_active = false;
+	this->m_sequence_applied = -1;
+	this->m_sequence_mismatches = 0;
+	if(this->m_sequence_exp.empty())
+		return;
+
+	if(this->m_trigger_mode != IntTrig && this->m_trigger_mode != ExtTrigMult)
+		THROW_HW_ERROR(Error) << "Exposure sequence needs one frame per trigger or free run, not supported with "
+			<< this->m_trigger_mode;
+	if(this->m_pretrigger_mode || this->m_accumulation_frames > 1)
+		THROW_HW_ERROR(Error) << "Exposure sequence cannot be combined with pre-trigger or accumulation";
+
+	// restored when the acquisition ends, only active once both are saved
+	// so a rejected sequence never restores stale values
+	this->m_sequence_saved_exp = this->_get_param_int(XI_PRM_EXPOSURE);
+	this->m_sequence_saved_gain = this->_get_param_dbl(XI_PRM_GAIN);
+	this->m_sequence_active = true;
+
+	// a free running sensor starts the next exposure before the grab
+	// thread can change it, trigger each frame once it is set up
+	this->m_sequence_soft_trigger = this->m_trigger_mode == IntTrig;
+	if(this->m_sequence_soft_trigger)
+	{
+		this->_set_param_int(XI_PRM_TRG_SOURCE, XI_TRG_SOFTWARE);
+		this->_set_param_int(XI_PRM_TRG_SELECTOR, XI_TRG_SEL_FRAME_START);
+	}
+	// first step in place before any trigger
+	this->_apply_sequence_step(0, false);
+}
+
+void Camera::_apply_sequence_step(int frame_nb, bool trigger)
+{
+	DEB_MEMBER_FUNCT();
+
+	int step = frame_nb % int(this->m_sequence_exp.size());
+	try
+	{
+		if(step != this->m_sequence_applied)
+		{
+			this->_set_param_int(XI_PRM_EXPOSURE, int(this->m_sequence_exp[step] * TIME_HW));
+			if(!this->m_sequence_gain.empty())
+				this->_set_param_dbl(XI_PRM_GAIN, this->m_sequence_gain[step]);
+			this->m_sequence_applied = step;
+		}
+		if(trigger)
+			this->_set_param_int(XI_PRM_TRG_SOFTWARE, XI_ON);
+	}
+	catch(Exception& e)
+	{
+		this->reportException(e, "Ximea/Camera/_apply_sequence_step");
+	}
+}
+
+void Camera::_check_sequence_step(FrameMetadata& metadata)
+{
+	DEB_MEMBER_FUNCT();
+
+	int step = metadata.frame_nb % int(this->m_sequence_exp.size());
+	metadata.sequence_step = step;
+	double exp_time = this->m_sequence_exp[step];
+	bool ok = fabs(metadata.exposure_time_us / TIME_HW - exp_time) <= SEQUENCE_EXP_TOLERANCE * exp_time;
+	if(!this->m_sequence_gain.empty())
+		ok = ok && fabs(metadata.gain_db - this->m_sequence_gain[step]) <= SEQUENCE_GAIN_TOLERANCE;
+	if(!ok)
+	{
+		// the event queue coalesces repeated mismatches, no per-frame log
+		++this->m_sequence_mismatches;
+		this->_report_event(EventQueue::Warning, "Frame exposed off its sequence step");
+	}
+}
+
+void Camera::_end_sequence()
+{
+	DEB_MEMBER_FUNCT();
+
+	this->m_sequence_active = false;
+	try
+	{
+		this->_set_param_int(XI_PRM_EXPOSURE, this->m_sequence_saved_exp);
+		this->_set_param_dbl(XI_PRM_GAIN, this->m_sequence_saved_gain);
+		if(this->m_sequence_soft_trigger)
+			this->setTrigMode(this->m_trigger_mode);
+	}
+	catch(Exception& e)
+	{
+		this->reportException(e, "Ximea/Camera/_end_sequence");
+	}
+}
+
+void Camera::_fill_frame_metadata(const XI_IMG* image, FrameMetadata& metadata)
+{
+	metadata.host_time = Timestamp::now();
+	metadata.data_saturation = image->data_saturation;
+	metadata.acq_nframe = image->acq_nframe;
+	metadata.nframe = image->nframe;
+	metadata.ts_sec = image->tsSec;
+	metadata.ts_usec = image->tsUSec;
+	metadata.exposure_time_us = image->exposure_time_us;
+	metadata.gain_db = image->gain_db;
+	metadata.black_level = image->black_level;
+	metadata.gpi_level = image->GPI_level;
+	metadata.flags = image->flags;
+	metadata.image_user_data = image->image_user_data;
+	metadata.width = image->width;
+	metadata.height = image->height;
+	metadata.offset_x = image->AbsoluteOffsetX;
+	metadata.offset_y = image->AbsoluteOffsetY;
+}
+
+void Camera::_store_frame_metadata(const FrameMetadata& metadata)
+{
+	{
+		AutoMutex lock(this->m_frame_metadata_mutex);
+		if(!this->m_frame_metadata.empty())
+			this->m_frame_metadata[metadata.frame_nb % this->m_frame_metadata.size()] = metadata;
+		this->m_last_frame_metadata = metadata;
+	}
+	this->m_sidecar.append(metadata);
+}
+
+void Camera::getFrameMetadata(int frame_nb, FrameMetadata& metadata)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(frame_nb);
+
+	AutoMutex lock(this->m_frame_metadata_mutex);
+	if(frame_nb < 0 || this->m_frame_metadata.empty() ||
+	   this->m_frame_metadata[frame_nb % this->m_frame_metadata.size()].frame_nb != frame_nb)
+		THROW_HW_ERROR(InvalidValue) << "No metadata for frame " << frame_nb << ", not acquired or buffer reused";
+	metadata = this->m_frame_metadata[frame_nb % this->m_frame_metadata.size()];
+}
+
+void Camera::getFrameParams(int frame_nb, double& exp_time, double& gain)
+{
+	FrameMetadata metadata;
+	this->getFrameMetadata(frame_nb, metadata);
+	exp_time = metadata.exposure_time_us / TIME_HW;
+	gain = metadata.gain_db;
+}
+
+void Camera::getLastFrameExpTime(double& exp_time)
+{
+	AutoMutex lock(this->m_frame_metadata_mutex);
+	const FrameMetadata& metadata = this->m_last_frame_metadata;
+	exp_time = metadata.frame_nb < 0 ? -1 : metadata.exposure_time_us / TIME_HW;
+}
+
+void Camera::getLastFrameGain(double& gain)
+{
+	AutoMutex lock(this->m_frame_metadata_mutex);
+	const FrameMetadata& metadata = this->m_last_frame_metadata;
+	gain = metadata.frame_nb < 0 ? -1 : metadata.gain_db;
+}
+
+void Camera::getMetadataSidecarPath(std::string& path)
+{
+	path = this->m_sidecar_path;
+}
+
+void Camera::setMetadataSidecarPath(const std::string& path)
+{
+	this->m_sidecar_path = path;
+	this->m_sidecar_index = 0;
+}
+
+void Camera::getMetadataSidecarFile(std::string& path)
+{
+	path = this->m_sidecar_file;
+}
+
+void Camera::_open_sidecar(void)
+{
+	DEB_MEMBER_FUNCT();
+
+	// one file per acquisition, the index goes before the extension and
+	// skips files already there
+	const std::string& path = this->m_sidecar_path;
+	std::string::size_type dot = path.rfind('.');
+	std::string::size_type slash = path.rfind('/');
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		dot = path.size();
+	std::string file;
+	do
+	{
+		char index[16];
+		snprintf(index, sizeof(index), "_%04d", this->m_sidecar_index++);
+		file = path.substr(0, dot) + index + path.substr(dot);
+	}
+	while(!access(file.c_str(), F_OK));
+
+	this->m_sidecar.open(file, (MetadataSidecar::Format)this->m_sidecar_format);
+	this->m_sidecar_file = file;
+	DEB_TRACE() << DEB_VAR1(file);
+}
+
+void Camera::getMetadataSidecarFormat(MetadataSidecarFormat& f)
+{
+	f = this->m_sidecar_format;
+}
+
+void Camera::setMetadataSidecarFormat(MetadataSidecarFormat f)
+{
+	this->m_sidecar_format = f;
+}
+
+// Sensor monitor
+
+bool Camera::_query_int(const char* param, int& value)
+{
+	// leaves xi_status to the acquisition thread
+	return xiGetParamInt(this->xiH, param, &value) == XI_OK;
+}
+
+double Camera::_query_dbl(const char* param)
+{
+	// leaves xi_status to the acquisition thread; NaN if not supported
+	float r;
+	if(xiGetParamFloat(this->xiH, param, &r) != XI_OK)
+		return std::numeric_limits<double>::quiet_NaN();
+	return r;
+}
+
+bool Camera::MonitorSampler::sample(SensorSnapshot& snapshot)
+{
+	Camera& cam = this->m_cam;
+	int status, counter;
+	if(xiGetParamInt(cam.xiH, XI_PRM_ACQUISITION_STATUS, &status) != XI_OK)
+		return false;
+	snapshot.acq_status = bool(status);
+	snapshot.temp_chip = cam._query_dbl(XI_PRM_CHIP_TEMP);
+	snapshot.temp_housing = cam._query_dbl(XI_PRM_HOUS_TEMP);
+	snapshot.temp_back = cam._query_dbl(XI_PRM_HOUS_BACK_SIDE_TEMP);
+	snapshot.temp_sensor = cam._query_dbl(XI_PRM_SENSOR_BOARD_TEMP);
+
+	// alarm once when crossing the threshold, again after cooling down
+	double alarm = cam.m_temp_alarm;
+	if(alarm && !std::isnan(snapshot.temp_sensor))
+	{
+		if(!cam.m_temp_alarm_raised && snapshot.temp_sensor > alarm)
+		{
+			EventQueue::Record event(EventQueue::TemperatureAlarm, EventQueue::TemperatureAbove);
+			event.reading = snapshot.temp_sensor;
+			event.limit = alarm;
+			cam._report_event(event);
+			cam.m_temp_alarm_raised = true;
+		}
+		else if(cam.m_temp_alarm_raised && snapshot.temp_sensor < alarm - TEMP_ALARM_HYSTERESIS)
+			cam.m_temp_alarm_raised = false;
+	}
+
+	AutoMutex lock(cam.m_selector_mutex);
+	snapshot.temperature = cam._query_dbl(XI_PRM_TEMP);
+	if(xiGetParamInt(cam.xiH, XI_PRM_COUNTER_VALUE, &counter) != XI_OK)
+		return false;
+	snapshot.counter_value = counter;
+	return true;
+}
+
+void Camera::getMonitorEnabled(bool& e)
+{
+	e = this->m_monitor.isRunning();
+}
+
+void Camera::setMonitorEnabled(bool e)
+{
+	if(e)
+		this->m_monitor.start();
+	else
+		this->m_monitor.stop();
+}
+
+void Camera::getMonitorRate(double& r)
+{
+	r = this->m_monitor.getRate();
+}
+
+void Camera::setMonitorRate(double r)
+{
+	this->m_monitor.setRate(r);
+}
+
+void Camera::getMonitorHistorySize(int& n)
+{
+	n = this->m_monitor.getHistorySize();
+}
+
+void Camera::setMonitorHistorySize(int n)
+{
+	this->m_monitor.setHistorySize(n);
+}
+
+void Camera::getMonitorSnapshot(SensorSnapshot& snapshot)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_monitor.getSnapshot(snapshot))
+		THROW_HW_ERROR(Error) << "No sensor snapshot, monitor " << (this->m_monitor.isRunning() ? "starting" : "disabled");
+}
+
+void Camera::getMonitorHistory(std::vector<SensorSnapshot>& history)
+{
+	this->m_monitor.getHistory(history);
+}
+
+// Auto exposure
+
+void Camera::getAutoExposureEngine(AutoExposureEngine& e)
+{
+	e = this->m_ae_engine;
+}
+
+void Camera::setAutoExposureEngine(AutoExposureEngine e)
+{
+	bool on;
+	this->getAutoExposureMode(on);
+	if(on)
+		this->setAutoExposureMode(false);
+	this->m_ae_engine = e;
+	if(on)
+		this->setAutoExposureMode(true);
+}
+
+void Camera::getAutoExposureMode(bool& on)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	on = this->m_soft_ae_enabled || this->m_hw_ae_enabled;
+}
+
+void Camera::setAutoExposureMode(bool on)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(on, this->m_ae_engine);
+
+	bool hw = on && this->m_ae_engine == Camera::AutoExposureEngine_Hardware;
+	bool sw = on && this->m_ae_engine == Camera::AutoExposureEngine_Software;
+
+	this->setAutoExposureGain(hw);
+
+	AutoMutex lock(this->m_ae_mutex);
+	this->m_soft_ae_enabled = sw;
+	this->m_auto_exposure.reset();
+}
+
+void Camera::_set_soft_ae_param(double AutoExposure::Params::*param, double value)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	AutoExposure::Params params;
+	this->m_auto_exposure.getParams(params);
+	params.*param = value;
+	this->m_auto_exposure.setParams(params);
+}
+
+void Camera::getSoftAePercentile(double& p)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	AutoExposure::Params params;
+	this->m_auto_exposure.getParams(params);
+	p = params.percentile;
+}
+
+void Camera::setSoftAePercentile(double p)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(p <= 0 || p > 1)
+		THROW_HW_ERROR(InvalidValue) << "Percentile must be in ]0, 1]";
+	this->_set_soft_ae_param(&AutoExposure::Params::percentile, p);
+}
+
+void Camera::getSoftAeTargetLevel(double& l)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	AutoExposure::Params params;
+	this->m_auto_exposure.getParams(params);
+	l = params.target_level;
+}
+
+void Camera::setSoftAeTargetLevel(double l)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(l <= 0 || l > 1)
+		THROW_HW_ERROR(InvalidValue) << "Target level must be in ]0, 1]";
+	this->_set_soft_ae_param(&AutoExposure::Params::target_level, l);
+}
+
+void Camera::getSoftAeMaxSaturation(double& s)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	AutoExposure::Params params;
+	this->m_auto_exposure.getParams(params);
+	s = params.max_saturation;
+}
+
+void Camera::setSoftAeMaxSaturation(double s)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(s < 0 || s > 1)
+		THROW_HW_ERROR(InvalidValue) << "Saturation fraction must be in [0, 1]";
+	this->_set_soft_ae_param(&AutoExposure::Params::max_saturation, s);
+}
+
+void Camera::getSoftAeTolerance(double& t)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	AutoExposure::Params params;
+	this->m_auto_exposure.getParams(params);
+	t = params.tolerance;
+}
+
+void Camera::setSoftAeTolerance(double t)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(t <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Tolerance must be positive";
+	this->_set_soft_ae_param(&AutoExposure::Params::tolerance, t);
+}
+
+void Camera::getSoftAeMaxExposure(double& e)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	AutoExposure::Params params;
+	this->m_auto_exposure.getParams(params);
+	e = params.max_exp_time;
+}
+
+void Camera::setSoftAeMaxExposure(double e)
+{
+	DEB_MEMBER_FUNCT();
+
+	double max_exp = this->_get_param_max(XI_PRM_EXPOSURE) / TIME_HW;
+	if(e <= 0 || e > max_exp)
+		THROW_HW_ERROR(InvalidValue) << "Exposure limit must be in ]0, " << max_exp << "] s";
+	this->_set_soft_ae_param(&AutoExposure::Params::max_exp_time, e);
+}
+
+void Camera::getSoftAeMaxGain(double& g)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	AutoExposure::Params params;
+	this->m_auto_exposure.getParams(params);
+	g = params.max_gain;
+}
+
+void Camera::setSoftAeMaxGain(double g)
+{
+	this->_set_soft_ae_param(&AutoExposure::Params::max_gain, g);
+}
+
+void Camera::getAutoExposureConvergence(int& nb_frames)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	nb_frames = this->m_auto_exposure.getConvergenceFrames();
+}
+
+void Camera::getAutoExposureLevel(double& l)
+{
+	AutoMutex lock(this->m_ae_mutex);
+	l = this->m_auto_exposure.getLevel();
+}
+
+// Parameter snapshot
+
+ParamSnapshot::ParamSnapshot()
+	: timestamp(0),
+	  read_time(0)
+{
+}
+
+void Camera::_snap_int(ParamSnapshot& snapshot, const char* name, const char* param, bool boolean)
+{
+	if(this->m_snapshot_unsupported.count(name))
+		return;
+	// leaves xi_status to the acquisition thread
+	int v;
+	int status = xiGetParamInt(this->xiH, param, &v);
+	if(status == XI_OK)
+		snapshot.ints[name] = boolean ? v != 0 : v;
+	else if(status == XI_NOT_SUPPORTED || status == XI_UNKNOWN_PARAM)
+		// not on this model, do not ask again
+		this->m_snapshot_unsupported.insert(name);
+}
+
+void Camera::_snap_dbl(ParamSnapshot& snapshot, const char* name, const char* param)
+{
+	if(this->m_snapshot_unsupported.count(name))
+		return;
+	float v;
+	int status = xiGetParamFloat(this->xiH, param, &v);
+	if(status == XI_OK)
+		snapshot.doubles[name] = v;
+	else if(status == XI_NOT_SUPPORTED || status == XI_UNKNOWN_PARAM)
+		this->m_snapshot_unsupported.insert(name);
+}
+
+// keyed by getter name, selectors come before the values depending on
+// them; the getters would go through xi_status
+#define SNAP_INT(name, param)	this->_snap_int(snapshot, #name, param, false)
+#define SNAP_BOOL(name, param)	this->_snap_int(snapshot, #name, param, true)
+#define SNAP_DBL(name, param)	this->_snap_dbl(snapshot, #name, param)
+
+void Camera::getSnapshot(ParamSnapshot& snapshot)
+{
+	DEB_MEMBER_FUNCT();
+
+	AutoMutex lock(this->m_snapshot_mutex);
+	Timestamp start = Timestamp::now();
+	snapshot.ints.clear();
+	snapshot.doubles.clear();
+	// what the monitor samples is not read twice
+	SensorSnapshot sensor;
+	bool monitored = this->m_monitor.getSnapshot(sensor);
+
+	snapshot.ints["TriggerPolarity"] = this->m_trig_polarity;
+	SNAP_INT(GpiSelector, XI_PRM_GPI_SELECTOR);
+	SNAP_INT(GpiMode, XI_PRM_GPI_MODE);
+	SNAP_INT(GpiLevel, XI_PRM_GPI_LEVEL);
+	SNAP_INT(GpiLevelAtExpStart, XI_PRM_GPI_LEVEL_AT_IMAGE_EXP_START);
+	SNAP_INT(GpiLevelAtExpEnd, XI_PRM_GPI_LEVEL_AT_IMAGE_EXP_END);
+	SNAP_BOOL(GpiDebounce, XI_PRM_DEBOUNCE_EN);
+	SNAP_INT(GpoSelector, XI_PRM_GPO_SELECTOR);
+	SNAP_INT(GpoMode, XI_PRM_GPO_MODE);
+	SNAP_INT(LedSelector, XI_PRM_LED_SELECTOR);
+	SNAP_INT(LedMode, XI_PRM_LED_MODE);
+
+	SNAP_INT(Mode, XI_PRM_USER_SET_SELECTOR);
+	SNAP_INT(GainSelector, XI_PRM_GAIN_SELECTOR);
+	SNAP_INT(Gain, XI_PRM_GAIN);
+	{
+		// queued while acquiring, as getGain
+		AutoMutex params_lock(this->m_params_mutex);
+		if(this->m_gain_pending)
+			snapshot.ints["Gain"] = this->m_pending_gain;
+	}
+	SNAP_BOOL(IsCooled, XI_PRM_IS_COOLED);
+	SNAP_INT(TempControlMode, XI_PRM_COOLING);
+	SNAP_DBL(TempTarget, XI_PRM_TARGET_TEMP);
+	SNAP_INT(Thermometer, XI_PRM_TEMP_SELECTOR);
+	if(monitored && !std::isnan(sensor.temperature))
+		snapshot.doubles["Temperature"] = sensor.temperature;
+	else
+		SNAP_DBL(Temperature, XI_PRM_TEMP);
+	if(monitored && !std::isnan(sensor.temp_chip))
+		snapshot.doubles["TempChip"] = sensor.temp_chip;
+	else
+		SNAP_DBL(TempChip, XI_PRM_CHIP_TEMP);
+	if(monitored && !std::isnan(sensor.temp_housing))
+		snapshot.doubles["TempHousing"] = sensor.temp_housing;
+	else
+		SNAP_DBL(TempHousing, XI_PRM_HOUS_TEMP);
+	if(monitored && !std::isnan(sensor.temp_back))
+		snapshot.doubles["TempBack"] = sensor.temp_back;
+	else
+		SNAP_DBL(TempBack, XI_PRM_HOUS_BACK_SIDE_TEMP);
+	if(monitored && !std::isnan(sensor.temp_sensor))
+		snapshot.doubles["TempSensor"] = sensor.temp_sensor;
+	else
+		SNAP_DBL(TempSensor, XI_PRM_SENSOR_BOARD_TEMP);
+	SNAP_INT(ThermalElement, XI_PRM_TEMP_ELEMENT_SEL);
+	SNAP_DBL(ThermalElementValue, XI_PRM_TEMP_ELEMENT_VALUE);
+	SNAP_INT(ExposureSelector, XI_PRM_EXPOSURE_TIME_SELECTOR);
+	SNAP_INT(BurstCount, XI_PRM_EXPOSURE_BURST_COUNT);
+	SNAP_INT(Downsampling, XI_PRM_DOWNSAMPLING);
+	SNAP_INT(DownsamplingType, XI_PRM_DOWNSAMPLING_TYPE);
+	SNAP_INT(TestPatternGenerator, XI_PRM_TEST_PATTERN_GENERATOR_SELECTOR);
+	SNAP_INT(TestPattern, XI_PRM_TEST_PATTERN);
+	SNAP_INT(ImageFormat, XI_PRM_IMAGE_DATA_FORMAT);
+	SNAP_INT(Shutter, XI_PRM_SHUTTER_TYPE);
+	SNAP_INT(Taps, XI_PRM_SENSOR_TAPS);
+	SNAP_BOOL(AutoExposureGain, XI_PRM_AEAG);
+	SNAP_BOOL(AutoWhiteBalance, XI_PRM_AUTO_WB);
+	SNAP_BOOL(HorizontalFlip, XI_PRM_HORIZONTAL_FLIP);
+	SNAP_BOOL(VerticalFlip, XI_PRM_VERTICAL_FLIP);
+	SNAP_INT(InterlineExpMode, XI_PRM_INTERLINE_EXPOSURE_MODE);
+	SNAP_INT(BinningEngine, XI_PRM_BINNING_SELECTOR);
+	SNAP_INT(HorizontalBinningPattern, XI_PRM_BINNING_HORIZONTAL_PATTERN);
+	SNAP_INT(VerticalBinningPattern, XI_PRM_BINNING_VERTICAL_PATTERN);
+	SNAP_INT(DecimationEngine, XI_PRM_DECIMATION_SELECTOR);
+	SNAP_INT(HorizontalDecimation, XI_PRM_DECIMATION_HORIZONTAL);
+	SNAP_INT(VerticalDecimation, XI_PRM_DECIMATION_VERTICAL);
+	SNAP_INT(HorizontalDecimationPattern, XI_PRM_DECIMATION_HORIZONTAL_PATTERN);
+	SNAP_INT(VerticalDecimationPattern, XI_PRM_DECIMATION_VERTICAL_PATTERN);
+	SNAP_DBL(ExposurePriority, XI_PRM_EXP_PRIORITY);
+	SNAP_INT(AutoGainLimit, XI_PRM_AG_MAX_LIMIT);
+	SNAP_INT(AutoExposureLimit, XI_PRM_AE_MAX_LIMIT);
+	SNAP_INT(AutoIntensityLevel, XI_PRM_AEAG_LEVEL);
+	SNAP_DBL(BandwidthLimit, XI_PRM_LIMIT_BANDWIDTH);
+	SNAP_BOOL(BandwidthLimitEnabled, XI_PRM_LIMIT_BANDWIDTH_MODE);
+	SNAP_DBL(FrameRate, XI_PRM_FRAMERATE);
+	{
+		// the counter readers switch the selector
+		AutoMutex selector_lock(this->m_selector_mutex);
+		SNAP_INT(CounterSelector, XI_PRM_COUNTER_SELECTOR);
+		if(monitored)
+			snapshot.ints["CounterValue"] = sensor.counter_value;
+		else
+			SNAP_INT(CounterValue, XI_PRM_COUNTER_VALUE);
+	}
+	SNAP_INT(AcqTimingMode, XI_PRM_ACQ_TIMING_MODE);
+	SNAP_INT(TriggerDelay, XI_PRM_TRG_DELAY);
+	SNAP_INT(TriggerOverlap, XI_PRM_TRG_OVERLAP);
+	if(monitored)
+		snapshot.ints["AcqStatus"] = sensor.acq_status;
+	else
+		SNAP_BOOL(AcqStatus, XI_PRM_ACQUISITION_STATUS);
+	SNAP_INT(FeatureSelector, XI_PRM_SENSOR_FEATURE_SELECTOR);
+	SNAP_INT(FeatureValue, XI_PRM_SENSOR_FEATURE_VALUE);
+	// AvailableBandwidth is left out: the SDK measures it on each read
+
+	Timestamp end = Timestamp::now();
+	snapshot.timestamp = double(end);
+	snapshot.read_time = double(end - start);
+	DEB_TRACE() << snapshot.ints.size() + snapshot.doubles.size() << " parameters in " << snapshot.read_time << " s";
+}
+
+#undef SNAP_INT
+#undef SNAP_BOOL
+#undef SNAP_DBL
+
+// Clock sync
+
+namespace
+{
+	double _clock(clockid_t id)
+	{
+		struct timespec ts;
+		clock_gettime(id, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+} // namespace
+
+bool Camera::_sync_clock()
+{
+	DEB_MEMBER_FUNCT();
+
+	AutoMutex lock(this->m_clock_sync_mutex);
+	if(!this->m_clock_sync_supported)
+		return false;
+
+	// the read with the shortest round trip brackets the counter best
+	double best_rtt = -1, camera = 0, before = 0, after = 0, real = 0;
+	for(int i = 0; i < CLOCK_SYNC_READS; ++i)
+	{
+		uint64_t ts = 0;
+		DWORD size = sizeof(ts);
+		XI_PRM_TYPE type = xiTypeInteger64;
+		double t0 = _clock(CLOCK_MONOTONIC);
+		XI_RETURN status = xiGetParam(this->xiH, XI_PRM_TIMESTAMP, &ts, &size, &type);
+		double t1 = _clock(CLOCK_MONOTONIC);
+		double r = _clock(CLOCK_REALTIME);
+		if(status != XI_OK)
+		{
+			DEB_WARNING() << "Camera clock not readable, xi_status: " << status << "; clock sync disabled";
+			this->m_clock_sync_supported = false;
+			return false;
+		}
+		if(best_rtt < 0 || t1 - t0 < best_rtt)
+		{
+			best_rtt = t1 - t0;
+			camera = ts * 1e-9;
+			before = t0;
+			after = t1;
+			// realtime read after the pair, moved back to its middle
+			real = r - (t1 - (t0 + t1) / 2);
+		}
+	}
+	this->m_clock_sync.addSample(camera, before, after, real);
+	DEB_TRACE() << DEB_VAR3(camera, best_rtt, this->m_clock_sync.getDrift());
+	return true;
+}
+
+bool Camera::_host_timestamp(unsigned int ts_sec, unsigned int ts_usec, Timestamp& ts)
+{
+	DEB_MEMBER_FUNCT();
+
+	double real;
+	if(!this->m_clock_sync_enabled || !this->m_clock_sync.toHost(ts_sec + ts_usec * 1e-6, real))
+		return false;
+
+	// the fit assumes XI_IMG tsSec/tsUSec count on the clock read by
+	// XI_PRM_TIMESTAMP; a first frame exposed after its arrival or before
+	// the start shows a model where they differ
+	if(!this->m_clock_sync_checked)
+	{
+		double arrival = _clock(CLOCK_REALTIME);
+		if(real > arrival + CLOCK_SYNC_CHECK_TOLERANCE || real < this->m_start_timestamp - CLOCK_SYNC_CHECK_TOLERANCE)
+		{
+			this->m_clock_sync_enabled = false;
+			const char* msg = "Frame timestamps not on the camera clock, clock sync disabled";
+			DEB_WARNING() << msg << ": " << DEB_VAR2(real, arrival);
+			this->_report_event(EventQueue::Warning, msg);
+			return false;
+		}
+		this->m_clock_sync_checked = true;
+	}
+	// Lima frame timestamps count from the start of the acquisition
+	ts = Timestamp(real - this->m_start_timestamp);
+	return true;
+}
+
+void Camera::getClockSyncEnabled(bool& e)
+{
+	e = this->m_clock_sync_enabled;
+}
+
+void Camera::setClockSyncEnabled(bool e)
+{
+	this->m_clock_sync_enabled = e;
+	if(e)
+	{
+		{
+			// give an unreadable clock another chance
+			AutoMutex lock(this->m_clock_sync_mutex);
+			this->m_clock_sync_supported = true;
+		}
+		this->m_clock_sync_thread.start();
+	}
+	else
+		this->m_clock_sync_thread.stop();
+}
+
+void Camera::getClockSyncInterval(double& t)
+{
+	t = this->m_clock_sync_interval;
+}
+
+void Camera::setClockSyncInterval(double t)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(t <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Clock sync interval must be positive";
+	this->m_clock_sync_interval = t;
+	this->m_clock_sync_thread.setRate(1 / t);
+}
+
+void Camera::getClockSyncWindow(int& n)
+{
+	n = this->m_clock_sync.getWindow();
+}
+
+void Camera::setClockSyncWindow(int n)
+{
+	this->m_clock_sync.setWindow(n);
+}
+
+void Camera::getClockSyncNbSamples(int& n)
+{
+	n = this->m_clock_sync.getNbSamples();
+}
+
+void Camera::getClockSyncDrift(double& ppm)
+{
+	ppm = this->m_clock_sync.getDrift();
+}
+
+void Camera::getClockSyncOffset(double& t)
+{
+	t = this->m_clock_sync.getOffset();
+}
+
+void Camera::getClockSyncError(double& t)
+{
+	t = this->m_clock_sync.getError();
+}
+
+void Camera::syncClock()
+{
+	DEB_MEMBER_FUNCT();
+
+	{
+		AutoMutex lock(this->m_clock_sync_mutex);
+		this->m_clock_sync_supported = true;
+	}
+	if(!this->_sync_clock())
+		THROW_HW_ERROR(NotSupported) << "Camera clock (" << XI_PRM_TIMESTAMP << ") not readable";
+}
+
+// Trigger diagnostics
+
+void Camera::_start_trigger_diag()
+{
+	DEB_MEMBER_FUNCT();
+
+	// exposure only follows an edge in these modes
+	this->m_trigger_diag_active = this->m_trigger_diag_enabled &&
+		(this->m_trigger_mode == ExtTrigSingle || this->m_trigger_mode == ExtTrigMult);
+	if(!this->m_trigger_diag_active)
+		return;
+
+	this->m_trigger_diag.reset();
+	int delay;
+	if(this->_query_int(XI_PRM_TRG_DELAY, delay))
+		this->m_trigger_diag_delay = delay * 1e-6;
+	else
+	{
+		DEB_WARNING() << "Trigger delay not readable, latencies include it";
+		this->m_trigger_diag_delay = 0;
+	}
+	if(!this->_get_counter(CounterSelector_Missed_Trigger_Overlap, this->m_missed_overlap_start) ||
+	   !this->_get_counter(CounterSelector_Missed_Trigger_Buffer_Full, this->m_missed_buffer_full_start))
+	{
+		DEB_WARNING() << "Missed trigger counters not available";
+		this->m_missed_overlap_start = -1;
+	}
+}
+
+void Camera::_record_trigger_diag(const XI_IMG* image)
+{
+	// before anything else is done with the frame
+	double arrival = _clock(CLOCK_REALTIME);
+	double camera_start = image->tsSec + image->tsUSec * 1e-6;
+	double host_start;
+	if(!this->m_clock_sync_enabled || !this->m_clock_sync.toHost(camera_start, host_start))
+		host_start = std::numeric_limits<double>::quiet_NaN();
+
+	// trigger input as latched with the frame, GPI 1 being bit 0; the
+	// models sample it once, at exposure start, the end level is unknown
+	bool active = this->m_trig_polarity == TriggerPolarity_High_Rising;
+	bool level = image->GPI_level & (1u << (this->m_trigger_gpi_port - 1));
+	int level_start = level == active;
+
+	this->m_trigger_diag.addFrame(camera_start, host_start, image->exposure_time_us * 1e-6,
+		this->m_trigger_diag_delay, arrival, level_start, -1);
+}
+
+void Camera::getTriggerDiagEnabled(bool& e)
+{
+	e = this->m_trigger_diag_enabled;
+}
+
+void Camera::setTriggerDiagEnabled(bool e)
+{
+	this->m_trigger_diag_enabled = e;
+}
+
+void Camera::getTriggerDiagBinWidth(double& w)
+{
+	w = this->m_trigger_diag.getBinWidth();
+}
+
+void Camera::setTriggerDiagBinWidth(double w)
+{
+	this->m_trigger_diag.setBinWidth(w);
+}
+
+void Camera::getTriggerDiagStats(TriggerDiagStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+
+	this->m_trigger_diag.getStats(stats);
+	if(!stats.nb_frames || this->m_missed_overlap_start < 0)
+		return;
+	int missed_overlap, missed_buffer_full;
+	if(!this->_get_counter(CounterSelector_Missed_Trigger_Overlap, missed_overlap) ||
+	   !this->_get_counter(CounterSelector_Missed_Trigger_Buffer_Full, missed_buffer_full))
+	{
+		DEB_WARNING() << "Missed trigger counters not available";
+		return;
+	}
+	stats.missed_overlap = missed_overlap - this->m_missed_overlap_start;
+	stats.missed_buffer_full = missed_buffer_full - this->m_missed_buffer_full_start;
+}
+
+void Camera::getTriggerDiagHistogram(std::vector<int>& histogram)
+{
+	this->m_trigger_diag.getHistogram(histogram);
+}
+
+void Camera::resetTriggerDiag()
+{
+	this->m_trigger_diag.reset();
+}
+
+// Configuration profiles
+
+#define PROFILE_EXTENSION	".profile"
+
+namespace
+{
+	// enums, int and bool settings
+	template <typename T>
+	std::string _to_text(T v)
+	{
+		ostringstream os;
+		os << int(v);
+		return os.str();
+	}
+
+	std::string _to_text(double v)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.9g", v);
+		return text;
+	}
+
+	std::string _to_text(const Roi& roi)
+	{
+		ostringstream os;
+		os << roi.getTopLeft().x << " " << roi.getTopLeft().y << " "
+			<< roi.getSize().getWidth() << " " << roi.getSize().getHeight();
+		return os.str();
+	}
+
+	std::string _to_text(const Bin& bin)
+	{
+		ostringstream os;
+		os << bin.getX() << " " << bin.getY();
+		return os.str();
+	}
+
+	template <typename T>
+	bool _from_text(const std::string& text, T& v)
+	{
+		istringstream is(text);
+		int i;
+		if(!(is >> i))
+			return false;
+		v = T(i);
+		return true;
+	}
+
+	bool _from_text(const std::string& text, double& v)
+	{
+		istringstream is(text);
+		return bool(is >> v);
+	}
+
+	bool _from_text(const std::string& text, Roi& roi)
+	{
+		istringstream is(text);
+		int x, y, w, h;
+		if(!(is >> x >> y >> w >> h))
+			return false;
+		roi = Roi(x, y, w, h);
+		return true;
+	}
+
+	bool _from_text(const std::string& text, Bin& bin)
+	{
+		istringstream is(text);
+		int x, y;
+		if(!(is >> x >> y))
+			return false;
+		bin = Bin(x, y);
+		return true;
+	}
+} // namespace
+
+template <typename T, typename U>
+void Camera::_profile_param(ProfileWalk& walk, const std::string& name, void (Camera::*getter)(T&), void (Camera::*setter)(U))
+{
+	DEB_MEMBER_FUNCT();
+
+	// current value, after the settings it depends on were written
+	T v;
+	bool readable = true;
+	try
+	{
+		(this->*getter)(v);
+	}
+	catch(Exception&)
+	{
+		readable = false;
+	}
+
+	if(!walk.target)
+	{
+		if(readable)
+			walk.read->set(name, _to_text(v));
+		return;
+	}
+
+	std::string value;
+	if(!walk.target->get(name, value) || (readable && Profile::sameValue(_to_text(v), value)))
+		return;
+	if(!_from_text(value, v))
+	{
+		walk.errors.push_back(name + " (bad value)");
+		return;
+	}
+	try
+	{
+		(this->*setter)(v);
+		++walk.nb_writes;
+		DEB_TRACE() << name << " = " << value;
+	}
+	catch(Exception&)
+	{
+		walk.errors.push_back(name);
+	}
+}
+
+template <typename S, typename T, typename U>
+void Camera::_profile_ports(ProfileWalk& walk, const char* name, void (Camera::*get_selector)(S&), void (Camera::*set_selector)(S),
+	S first, int nb, void (Camera::*getter)(T&), void (Camera::*setter)(U))
+{
+	// one setting per port, "<name>[<port>]"; ports stop at the first
+	// one this model does not have
+	S selector;
+	try
+	{
+		(this->*get_selector)(selector);
+	}
+	catch(Exception&)
+	{
+		return;
+	}
+	for(int i = 0; i < nb; ++i)
+	{
+		try
+		{
+			(this->*set_selector)(S(int(first) + i));
+		}
+		catch(Exception&)
+		{
+			break;
+		}
+		ostringstream port_name;
+		port_name << name << "[" << i + 1 << "]";
+		this->_profile_param(walk, port_name.str(), getter, setter);
+	}
+	(this->*set_selector)(selector);
+}
+
+#define PARAM(name)	this->_profile_param(walk, #name, &Camera::get##name, &Camera::set##name)
+#define PORTS(name, selector, first, nb) \
+	this->_profile_ports(walk, #name, &Camera::get##selector, &Camera::set##selector, first, nb, &Camera::get##name, &Camera::set##name)
+
+void Camera::_walk_profile(ProfileWalk& walk)
+{
+	// sensor readout first, it resets most of the rest
+	PARAM(Mode);
+	PARAM(ImageFormat);
+	PARAM(ImageType);
+	PARAM(Taps);
+	PARAM(Shutter);
+	PARAM(InterlineExpMode);
+
+	// geometry: engines and patterns, factors, then the ROI in binned pixels
+	PARAM(DownsamplingType);
+	PARAM(Downsampling);
+	PARAM(BinningEngine);
+	PARAM(HorizontalBinningPattern);
+	PARAM(VerticalBinningPattern);
+	PARAM(DecimationEngine);
+	PARAM(HorizontalDecimationPattern);
+	PARAM(VerticalDecimationPattern);
+	PARAM(HorizontalDecimation);
+	PARAM(VerticalDecimation);
+	PARAM(Bin);
+	PARAM(HorizontalFlip);
+	PARAM(VerticalFlip);
+	PARAM(Roi);
+
+	// bandwidth bounds the frame rate
+	PARAM(BandwidthLimitEnabled);
+	PARAM(BandwidthLimit);
+
+	// exposure
+	PARAM(ExposureSelector);
+	PARAM(BurstCount);
+	PARAM(GainSelector);
+	PARAM(Gain);
+	PARAM(ExpTime);
+	PARAM(LatTime);
+	PARAM(AutoExposureGain);
+	PARAM(ExposurePriority);
+	PARAM(AutoGainLimit);
+	PARAM(AutoExposureLimit);
+	PARAM(AutoIntensityLevel);
+	PARAM(AutoWhiteBalance);
+
+	// trigger and I/O
+	PARAM(TriggerOverlap);
+	PARAM(TrigMode);
+	PARAM(TriggerPolarity);
+	PARAM(TriggerDelay);
+	PARAM(AcqTimingMode);
+	PARAM(FrameRate);
+	PORTS(GpiMode, GpiSelector, GPISelector_Port_1, 12);
+	PARAM(GpiDebounce);
+	PORTS(GpoMode, GpoSelector, GPOSelector_Port_1, 12);
+	PORTS(LedMode, LedSelector, LEDSelector_1, 5);
+
+	// cooling
+	PARAM(TempControlMode);
+	PARAM(TempTarget);
+
+	PARAM(TestPatternGenerator);
+	PARAM(TestPattern);
+}
+
+#undef PARAM
+#undef PORTS
+
+std::string Camera::_profile_path(const std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(name.empty())
+		THROW_HW_ERROR(InvalidValue) << "Empty profile name";
+	if(name.find('/') != std::string::npos)
+		return name;
+	if(this->m_profile_dir.empty())
+		THROW_HW_ERROR(Error) << "No profile directory for profile " << name;
+	return this->m_profile_dir + "/" + name + PROFILE_EXTENSION;
+}
+
+void Camera::getProfileDir(std::string& dir)
+{
+	dir = this->m_profile_dir;
+}
+
+void Camera::setProfileDir(const std::string& dir)
+{
+	this->m_profile_dir = dir;
+}
+
+void Camera::saveProfile(const std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(name);
+
+	std::string path = this->_profile_path(name);
+	Profile profile;
+	ProfileWalk walk;
+	walk.read = &profile;
+	walk.target = NULL;
+	walk.nb_writes = 0;
+	this->_walk_profile(walk);
+
+	std::string model;
+	this->getDetectorModel(model);
+	profile.save(path, "Ximea " + model);
+	this->m_profile_name = name;
+}
+
+void Camera::loadProfile(const std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(name);
+
+	if(this->_is_acquiring())
+		THROW_HW_ERROR(Error) << "Cannot load profile " << name << " during acquisition";
+
+	Profile profile;
+	profile.load(this->_profile_path(name));
+
+	Timestamp start = Timestamp::now();
+	ProfileWalk walk;
+	walk.read = NULL;
+	walk.target = &profile;
+	walk.nb_writes = 0;
+	this->_walk_profile(walk);
+	this->m_profile_switch_time = double(Timestamp::now() - start);
+	this->m_profile_nb_writes = walk.nb_writes;
+	this->m_profile_name = name;
+	DEB_TRACE() << "Profile " << name << ": " << walk.nb_writes << " settings written in "
+		<< this->m_profile_switch_time << " s";
+
+	if(!walk.errors.empty())
+	{
+		ostringstream errors;
+		for(size_t i = 0; i < walk.errors.size(); ++i)
+			errors << (i ? ", " : "") << walk.errors[i];
+		THROW_HW_ERROR(Error) << "Profile " << name << ": could not set " << errors.str();
+	}
+}
+
+void Camera::getProfileList(std::vector<std::string>& names)
+{
+	names.clear();
+	DIR* dir = this->m_profile_dir.empty() ? NULL : opendir(this->m_profile_dir.c_str());
+	if(!dir)
+		return;
+	const std::string extension = PROFILE_EXTENSION;
+	while(struct dirent* entry = readdir(dir))
+	{
+		std::string file = entry->d_name;
+		if(file.size() > extension.size() && !file.compare(file.size() - extension.size(), extension.size(), extension))
+			names.push_back(file.substr(0, file.size() - extension.size()));
+	}
+	closedir(dir);
+	std::sort(names.begin(), names.end());
+}
+
+void Camera::getProfileName(std::string& name)
+{
+	name = this->m_profile_name;
+}
+
+void Camera::getProfileSwitchTime(double& t)
+{
+	t = this->m_profile_switch_time;
+}
+
+void Camera::getProfileNbWrites(int& n)
+{
+	n = this->m_profile_nb_writes;
+}
+
+// Extra attributes
+
+void Camera::getMode(Mode& m)
+{
+	m = (Mode)this->_get_param_int(XI_PRM_USER_SET_SELECTOR);
+}
+
+void Camera::setMode(Mode m)
+{
+	this->_set_param_int(XI_PRM_USER_SET_SELECTOR, (int)m);
+	this->_set_param_int(XI_PRM_USER_SET_LOAD, 0);
+}
+
+void Camera::getGainSelector(GainSelector &s)
+{
+	s = (GainSelector)this->_get_param_int(XI_PRM_GAIN_SELECTOR);
+}
+
+void Camera::setGainSelector(GainSelector s)
+{
+	this->_set_param_int(XI_PRM_GAIN_SELECTOR, (int)s);
+}
+
+void Camera::getGain(int& g)
+{
+	{
+		AutoMutex lock(this->m_params_mutex);
+		if(this->m_gain_pending)
+		{
+			g = this->m_pending_gain;
+			return;
+		}
+	}
+	g = this->_get_param_int(XI_PRM_GAIN);
+}
+
+void Camera::setGain(int g)
+{
+	if(this->_is_acquiring())
+	{
+		this->_check_param_range(XI_PRM_GAIN, g);
+		AutoMutex lock(this->m_params_mutex);
+		this->m_pending_gain = g;
+		this->m_gain_pending = true;
+		this->m_params_pending = true;
+		return;
+	}
+	this->_set_param_int(XI_PRM_GAIN, g);
+}
+
+void Camera::getIsCooled(bool& c)
+{
+	c = (bool)this->_get_param_int(XI_PRM_IS_COOLED);
+}
+
+void Camera::getTempControlMode(TempControlMode& m)
+{
+	m = (TempControlMode)this->_get_param_int(XI_PRM_COOLING);
+}
+
+void Camera::setTempControlMode(TempControlMode m)
+{
+	this->_set_param_int(XI_PRM_COOLING, (int)m);
+}
+
+void Camera::getTempTarget(double& t)
+{
+	t = this->_get_param_dbl(XI_PRM_TARGET_TEMP);
+}
+
+void Camera::setTempTarget(double t)
+{
+	this->_set_param_dbl(XI_PRM_TARGET_TEMP, t);
+}
+
+void Camera::getThermometer(Thermometer& t)
+{
+	t = (Thermometer)this->_get_param_int(XI_PRM_TEMP_SELECTOR);
+}
+
+void Camera::setThermometer(Thermometer t)
+{
+	AutoMutex lock(this->m_selector_mutex);
+	this->_set_param_int(XI_PRM_TEMP_SELECTOR, (int)t);
+	this->m_monitor.invalidate();
+}
+
+void Camera::getTemperature(double& t)
+{
+	SensorSnapshot snapshot;
+	if(this->m_monitor.getSnapshot(snapshot) && !std::isnan(snapshot.temperature))
+		t = snapshot.temperature;
+	else
+		t = this->_get_param_dbl(XI_PRM_TEMP);
+}
+
+void Camera::getTempChip(double& t)
+{
+	SensorSnapshot snapshot;
+	if(this->m_monitor.getSnapshot(snapshot) && !std::isnan(snapshot.temp_chip))
+		t = snapshot.temp_chip;
+	else
+		t = this->_get_param_dbl(XI_PRM_CHIP_TEMP);
+}
+
+void Camera::getTempHousing(double& t)
+{
+	SensorSnapshot snapshot;
+	if(this->m_monitor.getSnapshot(snapshot) && !std::isnan(snapshot.temp_housing))
+		t = snapshot.temp_housing;
+	else
+		t = this->_get_param_dbl(XI_PRM_HOUS_TEMP);
+}
+
+void Camera::getTempBack(double& t)
+{
+	SensorSnapshot snapshot;
+	if(this->m_monitor.getSnapshot(snapshot) && !std::isnan(snapshot.temp_back))
+		t = snapshot.temp_back;
+	else
+		t = this->_get_param_dbl(XI_PRM_HOUS_BACK_SIDE_TEMP);
+}
+
+void Camera::getTempSensor(double& t)
+{
+	SensorSnapshot snapshot;
+	if(this->m_monitor.getSnapshot(snapshot) && !std::isnan(snapshot.temp_sensor))
+		t = snapshot.temp_sensor;
+	else
+		t = this->_get_param_dbl(XI_PRM_SENSOR_BOARD_TEMP);
+}
+
+void Camera::getThermalElement(ThermalElement& e)
+{
+	e = (ThermalElement)this->_get_param_int(XI_PRM_TEMP_ELEMENT_SEL);
+}
+
+void Camera::setThermalElement(ThermalElement e)
+{
+	this->_set_param_int(XI_PRM_TEMP_ELEMENT_SEL, (int)e);
+}
+
+void Camera::getThermalElementValue(double& v)
+{
+	v = this->_get_param_dbl(XI_PRM_TEMP_ELEMENT_VALUE);
+}
+
+void Camera::setThermalElementValue(double v)
+{
+	this->_set_param_dbl(XI_PRM_TEMP_ELEMENT_VALUE, v);
+}
+
+void Camera::getExposureSelector(ExposureSelector& s)
+{
+	s = (ExposureSelector)this->_get_param_int(XI_PRM_EXPOSURE_TIME_SELECTOR);
+}
+
+void Camera::setExposureSelector(ExposureSelector s)
+{
+	this->_set_param_int(XI_PRM_EXPOSURE_TIME_SELECTOR, (int)s);
+}
+
+void Camera::getBurstCount(int& c)
+{
+	c = this->_get_param_int(XI_PRM_EXPOSURE_BURST_COUNT);
+}
+
+void Camera::setBurstCount(int c)
+{
+	this->_set_param_int(XI_PRM_EXPOSURE_BURST_COUNT, c);
+}
+
+void Camera::getDownsampling(Downsampling& d)
+{
+	d = (Downsampling)this->_get_param_int(XI_PRM_DOWNSAMPLING);
+}
+
+void Camera::setDownsampling(Downsampling d)
+{
+	this->_set_param_int(XI_PRM_DOWNSAMPLING, (int)d);
+}
+
+void Camera::getDownsamplingType(DownsamplingType& t)
+{
+	t = (DownsamplingType)this->_get_param_int(XI_PRM_DOWNSAMPLING_TYPE);
+}
+
+void Camera::setDownsamplingType(DownsamplingType t)
+{
+	this->_set_param_int(XI_PRM_DOWNSAMPLING_TYPE, (int)t);
+}
+
+void Camera::getTestPatternGenerator(TestPatternGenerator& g)
+{
+	g = (TestPatternGenerator)this->_get_param_int(XI_PRM_TEST_PATTERN_GENERATOR_SELECTOR);
+}
+
+void Camera::setTestPatternGenerator(TestPatternGenerator g)
+{
+	this->_set_param_int(XI_PRM_TEST_PATTERN_GENERATOR_SELECTOR, (int)g);
+}
+
+void Camera::getTestPattern(TestPattern& p)
+{
+	p = (TestPattern)this->_get_param_int(XI_PRM_TEST_PATTERN);
+}
+
+void Camera::setTestPattern(TestPattern p)
+{
+	this->_set_param_int(XI_PRM_TEST_PATTERN, (int)p);
+}
+
+void Camera::getImageFormat(ImageFormat& f)
+{
+	f = (ImageFormat)this->_get_param_int(XI_PRM_IMAGE_DATA_FORMAT);
+}
+
+void Camera::setImageFormat(ImageFormat f)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(f);
+
+	// refused before the camera is changed, not once Lima asks the type
+	ImageType type;
+	bool convert;
+	ColourLayout layout;
+	this->_get_format_type(f, type, convert, layout);
+
+	this->_set_param_int(XI_PRM_IMAGE_DATA_FORMAT, (int)f);
+	this->_image_type_changed();
+}
+
+void Camera::getFormatConversionTime(double& t)
+{
+	t = this->m_format_conversion_time;
+}
+
+void Camera::_convert_frame(const XI_IMG* image, void* frame_ptr)
+{
+	DEB_MEMBER_FUNCT();
+
+	// bytes per pixel of a row, planes being as wide as the frame
+	int pixel_size;
+	switch(this->m_format_layout)
+	{
+		case ColourLayout_Rgb24:
+			pixel_size = 3;
+			break;
+		case ColourLayout_Rgb48:
+			pixel_size = 6;
+			break;
+		case ColourLayout_Rgb64:
+			pixel_size = 8;
+			break;
+		case ColourLayout_RgbPlanar:
+			pixel_size = 1;
+			break;
+		default:
+			pixel_size = 2;
+	}
+	size_t stride = image->width * pixel_size + image->padding_x;
+
+	// the workers are fixed while acquiring, no correction map is used
+	Timestamp t0 = Timestamp::now();
+	convertToRgb32((uint32_t*)frame_ptr, image->bp, this->m_format_layout, this->m_format_bit_depth,
+		image->width, image->height, stride, this->m_workers);
+	this->m_format_conversion_time = Timestamp::now() - t0;
+}
+
+void Camera::getShutter(Shutter& s)
+{
+	s = (Shutter)this->_get_param_int(XI_PRM_SHUTTER_TYPE);
+}
+
+void Camera::setShutter(Shutter s)
+{
+	this->_set_param_int(XI_PRM_SHUTTER_TYPE, (int)s);
+}
+
+void Camera::getTaps(Taps& t)
+{
+	t = (Taps)this->_get_param_int(XI_PRM_SENSOR_TAPS);
+}
+
+void Camera::setTaps(Taps t)
+{
+	this->_set_param_int(XI_PRM_SENSOR_TAPS, (int)t);
+}
+
+void Camera::getAutoExposureGain(bool& a)
+{
+	a = (bool)this->_get_param_int(XI_PRM_AEAG);
+}
+
+void Camera::setAutoExposureGain(bool a)
+{
+	this->_set_param_int(XI_PRM_AEAG, (int)a);
+
+	AutoMutex lock(this->m_ae_mutex);
+	this->m_hw_ae_enabled = a;
+	this->m_auto_exposure.reset();
+}
+
+void Camera::getAutoWhiteBalance(bool& a)
+{
+	a = (bool)this->_get_param_int(XI_PRM_AUTO_WB);
+}
+
+void Camera::setAutoWhiteBalance(bool a)
 {
 	this->_set_param_int(XI_PRM_AUTO_WB, (int)a);
 }
@@ -1260,12 +4719,18 @@ void Camera::getCounterSelector(CounterSelector& s)
 
 void Camera::setCounterSelector(CounterSelector s)
 {
+	AutoMutex lock(this->m_selector_mutex);
 	this->_set_param_int(XI_PRM_COUNTER_SELECTOR, (int)s);
+	this->m_monitor.invalidate();
 }
 
 void Camera::getCounterValue(int& v)
 {
-	v = this->_get_param_int(XI_PRM_COUNTER_VALUE);
+	SensorSnapshot snapshot;
+	if(this->m_monitor.getSnapshot(snapshot))
+		v = snapshot.counter_value;
+	else
+		v = this->_get_param_int(XI_PRM_COUNTER_VALUE);
 }
 
 void Camera::getAcqTimingMode(AcqTimingMode& m)
@@ -1288,9 +4753,46 @@ void Camera::setTriggerDelay(int d)
 	this->_set_param_int(XI_PRM_TRG_DELAY, d);
 }
 
+void Camera::getTriggerOverlap(TriggerOverlap& o)
+{
+	// the camera may have changed it with a mode or user set
+	o = (TriggerOverlap)this->_get_param_int(XI_PRM_TRG_OVERLAP);
+}
+
+void Camera::setTriggerOverlap(TriggerOverlap o)
+{
+	this->_set_param_int(XI_PRM_TRG_OVERLAP, (int)o);
+	this->m_trigger_overlap = o;
+}
+
+void Camera::getTriggerPeriod(double& t)
+{
+	t = this->m_trigger_period;
+}
+
+void Camera::setTriggerPeriod(double t)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(t < 0)
+		THROW_HW_ERROR(InvalidValue) << "Trigger period cannot be negative";
+	this->m_trigger_period = t;
+}
+
+void Camera::getMaxTriggerRate(double& r)
+{
+	TimingPrediction prediction;
+	this->getTimingPrediction(prediction);
+	r = prediction.max_trigger_rate;
+}
+
 void Camera::getAcqStatus(bool& s)
 {
-	s = (bool)this->_get_param_int(XI_PRM_ACQUISITION_STATUS);
+	SensorSnapshot snapshot;
+	if(this->m_monitor.getSnapshot(snapshot))
+		s = snapshot.acq_status;
+	else
+		s = (bool)this->_get_param_int(XI_PRM_ACQUISITION_STATUS);
 }
 
 void Camera::getFeatureSelector(FeatureSelector& s)
@@ -1313,17 +4815,91 @@ void Camera::setFeatureValue(int v)
 	this->_set_param_int(XI_PRM_SENSOR_FEATURE_VALUE, v);
 }
 
-void Camera::reportException(Exception& e, std::string name)
+void Camera::reportException(Exception& e, const char* where)
+{
+	DEB_MEMBER_FUNCT();
+
+	// mostly called from the acquisition loop: queued, never reported here
+	if(!this->m_event_queue.pushFailure(where, e.getErrMsg()))
+		DEB_WARNING() << "Event queue full, lost: " << where << " failed";
+}
+
+void Camera::_report_event(EventQueue::Type type, const char* msg, long value)
+{
+	this->_report_event(EventQueue::Record(type, EventQueue::Text, msg, value));
+}
+
+void Camera::_report_event(const EventQueue::Record& event)
 {
 	DEB_MEMBER_FUNCT();
 
-	ostringstream err_msg;
-	err_msg << name << " failed: " << e;
-	Event::Code err_code = Event::CamCommError;
-	Event *event = new Event(Hardware, Event::Error, Event::Camera, 
-				 err_code, err_msg.str());
-	DEB_EVENT(*event) << DEB_VAR1(*event);
-	reportEvent(event);
+	// typed: the drain thread writes the message
+	if(!this->m_event_queue.push(event))
+		DEB_WARNING() << "Event queue full, lost: " << EventQueue::typeName(event.type) << " " << event.text;
+}
+
+void Camera::EventSink::deliver(Event* event)
+{
+	this->m_cam.reportEvent(event);
+}
+
+void Camera::getEventMaxRate(double& r)
+{
+	r = this->m_event_queue.getMaxRate();
+}
+
+void Camera::setEventMaxRate(double r)
+{
+	this->m_event_queue.setMaxRate(r);
+}
+
+void Camera::getEventCoalesceTime(double& t)
+{
+	t = this->m_event_queue.getCoalesceTime();
+}
+
+void Camera::setEventCoalesceTime(double t)
+{
+	this->m_event_queue.setCoalesceTime(t);
+}
+
+void Camera::getEventsDelivered(int& n)
+{
+	EventQueue::Counts counts;
+	this->m_event_queue.getCounts(counts);
+	n = int(counts.delivered);
+}
+
+void Camera::getEventsCoalesced(int& n)
+{
+	EventQueue::Counts counts;
+	this->m_event_queue.getCounts(counts);
+	n = int(counts.coalesced);
+}
+
+void Camera::getEventsSuppressed(int& n)
+{
+	EventQueue::Counts counts;
+	this->m_event_queue.getCounts(counts);
+	n = int(counts.suppressed);
+}
+
+void Camera::getEventsLost(int& n)
+{
+	EventQueue::Counts counts;
+	this->m_event_queue.getCounts(counts);
+	n = int(counts.lost);
+}
+
+void Camera::getTempAlarm(double& t)
+{
+	t = this->m_temp_alarm;
+}
+
+void Camera::setTempAlarm(double t)
+{
+	this->m_temp_alarm = t;
+	this->m_temp_alarm_raised = false;
 }
 
 void Camera::getTimeout(int &t)
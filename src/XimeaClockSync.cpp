@@ -0,0 +1,173 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cmath>
+#include <algorithm>
+
+#include "lima/Exceptions.h"
+#include "XimeaClockSync.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+// drift is only fitted over at least this span, s
+#define MIN_DRIFT_SPAN	10.0
+
+ClockSync::ClockSync()
+	: m_window(64)
+{
+	this->reset();
+}
+
+void ClockSync::reset()
+{
+	AutoMutex lock(this->m_mutex);
+	this->m_samples.clear();
+	this->m_camera0 = 0;
+	this->m_mono0 = 0;
+	this->m_rate = 1;
+	this->m_real_offset = 0;
+	this->m_error = 0;
+}
+
+void ClockSync::setWindow(int nb_samples)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(nb_samples < 2)
+		THROW_HW_ERROR(InvalidValue) << "Clock sync window needs at least 2 samples";
+	AutoMutex lock(this->m_mutex);
+	this->m_window = nb_samples;
+	while(int(this->m_samples.size()) > nb_samples)
+		this->m_samples.pop_front();
+	this->_fit();
+}
+
+void ClockSync::addSample(double camera, double mono_before, double mono_after, double real)
+{
+	DEB_MEMBER_FUNCT();
+
+	Sample sample;
+	sample.camera = camera;
+	sample.mono = (mono_before + mono_after) / 2;
+	sample.half_rtt = (mono_after - mono_before) / 2;
+	sample.real_offset = real - sample.mono;
+
+	AutoMutex lock(this->m_mutex);
+	if(!this->m_samples.empty() && camera < this->m_samples.back().camera)
+	{
+		DEB_TRACE() << "Camera clock went back, restarting the fit";
+		this->m_samples.clear();
+	}
+	this->m_samples.push_back(sample);
+	while(int(this->m_samples.size()) > this->m_window)
+		this->m_samples.pop_front();
+	this->_fit();
+}
+
+void ClockSync::_fit()
+{
+	if(this->m_samples.empty())
+		return;
+
+	// least squares around the means, samples weighted by their round trip
+	const Sample& last = this->m_samples.back();
+	double span = last.camera - this->m_samples.front().camera;
+	double sw = 0, sc = 0, sm = 0;
+	for(std::deque<Sample>::const_iterator it = this->m_samples.begin(); it != this->m_samples.end(); ++it)
+	{
+		double w = 1 / std::max(it->half_rtt * it->half_rtt, 1e-12);
+		sw += w;
+		sc += w * it->camera;
+		sm += w * it->mono;
+	}
+	double camera0 = sc / sw;
+	double mono0 = sm / sw;
+
+	double rate = 1;
+	if(span >= MIN_DRIFT_SPAN)
+	{
+		double scc = 0, scm = 0;
+		for(std::deque<Sample>::const_iterator it = this->m_samples.begin(); it != this->m_samples.end(); ++it)
+		{
+			double w = 1 / std::max(it->half_rtt * it->half_rtt, 1e-12);
+			scc += w * (it->camera - camera0) * (it->camera - camera0);
+			scm += w * (it->camera - camera0) * (it->mono - mono0);
+		}
+		rate = scm / scc;
+	}
+
+	double error = 0;
+	for(std::deque<Sample>::const_iterator it = this->m_samples.begin(); it != this->m_samples.end(); ++it)
+	{
+		double residual = fabs(mono0 + (it->camera - camera0) * rate - it->mono);
+		error = std::max(error, residual + it->half_rtt);
+	}
+
+	this->m_camera0 = camera0;
+	this->m_mono0 = mono0;
+	this->m_rate = rate;
+	this->m_real_offset = last.real_offset;
+	this->m_error = error;
+}
+
+bool ClockSync::isValid()
+{
+	AutoMutex lock(this->m_mutex);
+	return !this->m_samples.empty();
+}
+
+bool ClockSync::toHost(double camera, double& real)
+{
+	AutoMutex lock(this->m_mutex);
+	if(this->m_samples.empty())
+		return false;
+	real = this->m_mono0 + (camera - this->m_camera0) * this->m_rate + this->m_real_offset;
+	return true;
+}
+
+int ClockSync::getNbSamples()
+{
+	AutoMutex lock(this->m_mutex);
+	return int(this->m_samples.size());
+}
+
+double ClockSync::getDrift()
+{
+	AutoMutex lock(this->m_mutex);
+	return (this->m_rate - 1) * 1e6;
+}
+
+double ClockSync::getOffset()
+{
+	AutoMutex lock(this->m_mutex);
+	return this->m_mono0 - this->m_camera0 * this->m_rate + this->m_real_offset;
+}
+
+double ClockSync::getError()
+{
+	AutoMutex lock(this->m_mutex);
+	return this->m_error;
+}
@@ -0,0 +1,335 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <algorithm>
+#include <stdint.h>
+
+#include "lima/Exceptions.h"
+#include "XimeaCorrection.h"
+#include "XimeaSimd.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+namespace
+{
+	template <typename T, typename F>
+	void _correct_scalar(T* p, const float* dark, const float* gain, int n)
+	{
+		const F max_val = F(std::numeric_limits<T>::max());
+		for(int i = 0; i < n; ++i)
+		{
+			F v = (F(p[i]) - dark[i]) * gain[i];
+			v = v < 0 ? 0 : (v > max_val ? max_val : v);
+			p[i] = T(v + F(0.5));
+		}
+	}
+
+	template <typename T>
+	void _correct(T* p, const float* dark, const float* gain, int n)
+	{
+		_correct_scalar<T, float>(p, dark, gain, n);
+	}
+
+	// float cannot hold all 32 bit values
+	template <>
+	void _correct<uint32_t>(uint32_t* p, const float* dark, const float* gain, int n)
+	{
+		_correct_scalar<uint32_t, double>(p, dark, gain, n);
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	XIMEA_TARGET_AVX2 inline __m256i _correct_8_avx2(__m256i v, const float* dark, const float* gain, __m256 max_val)
+	{
+		__m256 f = _mm256_cvtepi32_ps(v);
+		f = _mm256_mul_ps(_mm256_sub_ps(f, _mm256_loadu_ps(dark)), _mm256_loadu_ps(gain));
+		f = _mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()), max_val);
+		// same half up rounding as the scalar loop, not round to even
+		return _mm256_cvttps_epi32(_mm256_add_ps(f, _mm256_set1_ps(0.5f)));
+	}
+
+	XIMEA_TARGET_AVX2 void _correct_avx2(uint16_t* p, const float* dark, const float* gain, int n)
+	{
+		const __m256 max_val = _mm256_set1_ps(65535.f);
+		int i = 0;
+		for(; i + 16 <= n; i += 16)
+		{
+			__m256i v0 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p + i)));
+			__m256i v1 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p + i + 8)));
+			__m256i r0 = _correct_8_avx2(v0, dark + i, gain + i, max_val);
+			__m256i r1 = _correct_8_avx2(v1, dark + i + 8, gain + i + 8, max_val);
+			// packus works per 128 bit lane, restore pixel order
+			__m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi32(r0, r1), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256((__m256i*)(p + i), r);
+		}
+		if(i < n)
+			_correct_scalar<uint16_t, float>(p + i, dark + i, gain + i, n - i);
+	}
+
+	XIMEA_TARGET_AVX2 void _correct_avx2(uint8_t* p, const float* dark, const float* gain, int n)
+	{
+		const __m256 max_val = _mm256_set1_ps(255.f);
+		int i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(p + i)));
+			__m256i r = _correct_8_avx2(v, dark + i, gain + i, max_val);
+			r = _mm256_packus_epi32(r, r);
+			r = _mm256_packus_epi16(r, r);
+			int32_t lo = _mm_cvtsi128_si32(_mm256_castsi256_si128(r));
+			int32_t hi = _mm_cvtsi128_si32(_mm256_extracti128_si256(r, 1));
+			memcpy(p + i, &lo, 4);
+			memcpy(p + i + 4, &hi, 4);
+		}
+		if(i < n)
+			_correct_scalar<uint8_t, float>(p + i, dark + i, gain + i, n - i);
+	}
+
+	template <>
+	void _correct<uint16_t>(uint16_t* p, const float* dark, const float* gain, int n)
+	{
+		if(Simd::hasAvx2())
+			_correct_avx2(p, dark, gain, n);
+		else
+			_correct_scalar<uint16_t, float>(p, dark, gain, n);
+	}
+
+	template <>
+	void _correct<uint8_t>(uint8_t* p, const float* dark, const float* gain, int n)
+	{
+		if(Simd::hasAvx2())
+			_correct_avx2(p, dark, gain, n);
+		else
+			_correct_scalar<uint8_t, float>(p, dark, gain, n);
+	}
+#endif
+} // namespace
+
+class Correction::ApplyTask : public StripeWorkers::Task
+{
+public:
+	ApplyTask(const Correction& corr, void* data, int pixel_size, size_t stride)
+		: m_corr(corr), m_data((char*)data), m_pixel_size(pixel_size), m_stride(stride)
+	{
+	}
+
+	virtual void process(int first_row, int last_row)
+	{
+		int w = this->m_corr.m_frame_width;
+		for(int y = first_row; y < last_row; ++y)
+		{
+			char* row = this->m_data + y * this->m_stride;
+			const float* dark = &this->m_corr.m_frame_dark[size_t(y) * w];
+			const float* gain = &this->m_corr.m_frame_gain[size_t(y) * w];
+			switch(this->m_pixel_size)
+			{
+				case 1:
+					_correct((uint8_t*)row, dark, gain, w);
+					break;
+				case 2:
+					_correct((uint16_t*)row, dark, gain, w);
+					break;
+				case 4:
+					_correct((uint32_t*)row, dark, gain, w);
+					break;
+			}
+		}
+	}
+
+private:
+	const Correction& m_corr;
+	char* m_data;
+	int m_pixel_size;
+	size_t m_stride;
+};
+
+Correction::Correction()
+	: m_width(0),
+	  m_height(0),
+	  m_prepared(false),
+	  m_frame_width(0),
+	  m_frame_height(0)
+{
+}
+
+void Correction::_load_map(const std::string& path, int width, int height, std::vector<float>& map)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR3(path, width, height);
+
+	std::ifstream f(path.c_str(), std::ios::binary | std::ios::ate);
+	if(!f)
+		THROW_HW_ERROR(Error) << "Could not open map file " << path;
+
+	size_t expected = size_t(width) * height * sizeof(float);
+	size_t size = f.tellg();
+	if(size != expected)
+		THROW_HW_ERROR(Error) << "Map file " << path << " has " << size << " bytes, expected " << expected
+			<< " (float32, " << width << "x" << height << ")";
+
+	map.resize(size_t(width) * height);
+	f.seekg(0);
+	f.read((char*)&map[0], expected);
+}
+
+void Correction::loadDarkMap(const std::string& path, int width, int height)
+{
+	std::vector<float> dark;
+	this->_load_map(path, width, height, dark);
+	this->setDarkMap(dark, width, height);
+}
+
+void Correction::loadFlatMap(const std::string& path, int width, int height)
+{
+	std::vector<float> flat;
+	this->_load_map(path, width, height, flat);
+	this->setFlatMap(flat, width, height);
+}
+
+void Correction::setDarkMap(const std::vector<float>& dark, int width, int height)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(dark.size() != size_t(width) * height)
+		THROW_HW_ERROR(InvalidValue) << "Dark map size does not match " << width << "x" << height;
+	if(this->hasFlatMap() && (width != this->m_width || height != this->m_height))
+		THROW_HW_ERROR(InvalidValue) << "Dark map size differs from flat map size";
+
+	this->m_dark = dark;
+	this->m_width = width;
+	this->m_height = height;
+	this->m_prepared = false;
+}
+
+void Correction::setFlatMap(const std::vector<float>& flat, int width, int height)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(flat.size() != size_t(width) * height)
+		THROW_HW_ERROR(InvalidValue) << "Flat map size does not match " << width << "x" << height;
+	if(this->hasDarkMap() && (width != this->m_width || height != this->m_height))
+		THROW_HW_ERROR(InvalidValue) << "Flat map size differs from dark map size";
+
+	// normalise to the mean response so corrected frames keep their level
+	double mean = 0;
+	for(size_t i = 0; i < flat.size(); ++i)
+		mean += flat[i];
+	mean /= flat.size();
+
+	this->m_gain.resize(flat.size());
+	for(size_t i = 0; i < flat.size(); ++i)
+		this->m_gain[i] = flat[i] > 0 ? float(mean / flat[i]) : 0.f;
+	this->m_width = width;
+	this->m_height = height;
+	this->m_prepared = false;
+}
+
+void Correction::clearDarkMap()
+{
+	this->m_dark.clear();
+	this->m_prepared = false;
+}
+
+void Correction::clearFlatMap()
+{
+	this->m_gain.clear();
+	this->m_prepared = false;
+}
+
+void Correction::prepare(const Roi& roi, const Bin& bin)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(roi, bin);
+
+	this->m_prepared = false;
+	this->m_frame_width = roi.getSize().getWidth();
+	this->m_frame_height = roi.getSize().getHeight();
+
+	size_t nb_pixels = size_t(this->m_frame_width) * this->m_frame_height;
+	this->m_frame_dark.assign(nb_pixels, 0.f);
+	this->m_frame_gain.assign(nb_pixels, 1.f);
+	if(!this->hasDarkMap() && !this->hasFlatMap())
+		return;
+
+	int bx = bin.getX();
+	int by = bin.getY();
+	int x0 = roi.getTopLeft().x * bx;
+	int y0 = roi.getTopLeft().y * by;
+	if(x0 + this->m_frame_width * bx > this->m_width || y0 + this->m_frame_height * by > this->m_height)
+		THROW_HW_ERROR(Error) << "Correction maps (" << this->m_width << "x" << this->m_height
+			<< ") do not cover " << DEB_VAR2(roi, bin);
+
+	// binning sums pixels: dark adds up, gain is averaged
+	for(int y = 0; y < this->m_frame_height; ++y)
+		for(int x = 0; x < this->m_frame_width; ++x)
+		{
+			double dark = 0, gain = 0;
+			for(int j = 0; j < by; ++j)
+			{
+				size_t offset = size_t(y0 + y * by + j) * this->m_width + x0 + x * bx;
+				for(int i = 0; i < bx; ++i)
+				{
+					if(this->hasDarkMap())
+						dark += this->m_dark[offset + i];
+					if(this->hasFlatMap())
+						gain += this->m_gain[offset + i];
+				}
+			}
+			size_t k = size_t(y) * this->m_frame_width + x;
+			this->m_frame_dark[k] = float(dark);
+			if(this->hasFlatMap())
+				this->m_frame_gain[k] = float(gain / (bx * by));
+		}
+
+	this->m_prepared = true;
+}
+
+void Correction::setPreparedDark(const std::vector<float>& dark)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(dark.size() != size_t(this->m_frame_width) * this->m_frame_height)
+		THROW_HW_ERROR(InvalidValue) << "Dark size does not match the prepared frame geometry";
+	this->m_frame_dark = dark;
+	if(this->m_frame_gain.size() != dark.size())
+		this->m_frame_gain.assign(dark.size(), 1.f);
+	this->m_prepared = true;
+}
+
+void Correction::apply(void* data, int pixel_size, int width, int height, size_t stride, StripeWorkers& workers)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_prepared)
+		return;
+	if(width != this->m_frame_width || height != this->m_frame_height)
+		THROW_HW_ERROR(Error) << "Frame " << width << "x" << height << " does not match correction maps "
+			<< this->m_frame_width << "x" << this->m_frame_height;
+
+	ApplyTask task(*this, data, pixel_size, stride);
+	workers.run(task, height);
+}
@@ -0,0 +1,273 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "lima/Exceptions.h"
+#include "XimeaDarkLibrary.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+using namespace std;
+
+#define DARK_INDEX_FILE	"index.txt"
+
+// relative exposure difference still considered the same exposure
+#define EXP_TIME_EPSILON	1e-3
+
+DarkKey::DarkKey()
+	: exp_time(0),
+	  gain(0),
+	  mode(0),
+	  temperature(0)
+{
+}
+
+bool DarkKey::isCompatible(const DarkKey& other) const
+{
+	return this->mode == other.mode && fabs(this->gain - other.gain) < 1e-3 &&
+		this->roi == other.roi && this->bin == other.bin;
+}
+
+DarkLibrary::DarkLibrary()
+	: m_temp_tolerance(1.0)
+{
+}
+
+void DarkLibrary::setCacheDir(const string& dir)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(dir);
+
+	this->m_cache_dir = dir;
+	this->m_entries.clear();
+	if(!dir.empty())
+		this->_load_index();
+}
+
+string DarkLibrary::_path(const string& file) const
+{
+	return this->m_cache_dir + "/" + file;
+}
+
+string DarkLibrary::_file_name(const DarkKey& key) const
+{
+	char name[256];
+	snprintf(name, sizeof(name), "dark_m%d_g%.1f_e%.0f_r%dx%dx%dx%d_b%dx%d_t%.1f.raw",
+		key.mode, key.gain, key.exp_time * 1e6,
+		key.roi.getTopLeft().x, key.roi.getTopLeft().y, key.roi.getSize().getWidth(), key.roi.getSize().getHeight(),
+		key.bin.getX(), key.bin.getY(), key.temperature);
+	return name;
+}
+
+void DarkLibrary::_load_index()
+{
+	DEB_MEMBER_FUNCT();
+
+	ifstream index(this->_path(DARK_INDEX_FILE).c_str());
+	if(!index)
+		// new cache
+		return;
+
+	string line;
+	while(getline(index, line))
+	{
+		Entry entry;
+		int x, y, w, h, bx, by;
+		string temperature;
+		istringstream is(line);
+		is >> entry.file >> entry.key.mode >> entry.key.gain >> entry.key.exp_time >> x >> y >> w >> h >> bx >> by
+			>> temperature >> entry.nb_frames;
+		// streams do not read back the nan they write
+		char* end = NULL;
+		entry.key.temperature = strtod(temperature.c_str(), &end);
+		if(!is || end == temperature.c_str())
+		{
+			DEB_WARNING() << "Ignoring malformed dark index line: " << line;
+			continue;
+		}
+		entry.key.roi = Roi(x, y, w, h);
+		entry.key.bin = Bin(bx, by);
+		this->m_entries.push_back(entry);
+	}
+	DEB_TRACE() << this->m_entries.size() << " darks in " << this->m_cache_dir;
+}
+
+void DarkLibrary::_save_index()
+{
+	DEB_MEMBER_FUNCT();
+
+	ofstream index(this->_path(DARK_INDEX_FILE).c_str());
+	if(!index)
+		THROW_HW_ERROR(Error) << "Could not write dark index in " << this->m_cache_dir;
+
+	index.precision(9);
+	for(vector<Entry>::const_iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it)
+	{
+		const DarkKey& k = it->key;
+		index << it->file << " " << k.mode << " " << k.gain << " " << k.exp_time << " "
+			<< k.roi.getTopLeft().x << " " << k.roi.getTopLeft().y << " "
+			<< k.roi.getSize().getWidth() << " " << k.roi.getSize().getHeight() << " "
+			<< k.bin.getX() << " " << k.bin.getY() << " " << k.temperature << " " << it->nb_frames << "\n";
+	}
+}
+
+void DarkLibrary::_load_data(Entry& entry)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!entry.data.empty())
+		return;
+
+	size_t nb_pixels = size_t(entry.key.roi.getSize().getWidth()) * entry.key.roi.getSize().getHeight();
+	ifstream f(this->_path(entry.file).c_str(), ios::binary);
+	entry.data.resize(nb_pixels);
+	if(!f.read((char*)&entry.data[0], nb_pixels * sizeof(float)))
+	{
+		entry.data.clear();
+		THROW_HW_ERROR(Error) << "Could not read dark file " << this->_path(entry.file);
+	}
+}
+
+void DarkLibrary::store(const DarkKey& key, int nb_frames, const vector<float>& dark)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR4(key.exp_time, key.gain, key.mode, key.temperature);
+
+	Entry entry;
+	entry.key = key;
+	entry.nb_frames = nb_frames;
+	entry.file = this->_file_name(key);
+	entry.data = dark;
+
+	if(!this->m_cache_dir.empty())
+	{
+		ofstream f(this->_path(entry.file).c_str(), ios::binary);
+		if(!f.write((const char*)&dark[0], dark.size() * sizeof(float)))
+			THROW_HW_ERROR(Error) << "Could not write dark file " << this->_path(entry.file);
+	}
+
+	// same settings at the same temperature: replace
+	vector<Entry>::iterator it = this->m_entries.begin();
+	for(; it != this->m_entries.end(); ++it)
+		if(it->file == entry.file)
+			break;
+	if(it != this->m_entries.end())
+		*it = entry;
+	else
+		this->m_entries.push_back(entry);
+
+	if(!this->m_cache_dir.empty())
+		this->_save_index();
+}
+
+DarkLibrary::Match DarkLibrary::lookup(const DarkKey& key, vector<float>& dark, DarkKey& dark_key)
+{
+	DEB_MEMBER_FUNCT();
+
+	// candidates for these settings, at the right temperature if possible
+	vector<Entry*> candidates;
+	bool in_tolerance = false;
+	for(vector<Entry>::iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it)
+	{
+		if(!key.isCompatible(it->key))
+			continue;
+		bool ok = fabs(it->key.temperature - key.temperature) <= this->m_temp_tolerance;
+		if(ok && !in_tolerance)
+			candidates.clear();
+		if(ok || !in_tolerance)
+			candidates.push_back(&*it);
+		in_tolerance = in_tolerance || ok;
+	}
+
+	// exact exposure, else closest exposures on both sides; temperature
+	// breaks ties
+	Entry* exact = NULL;
+	Entry* below = NULL;
+	Entry* above = NULL;
+	for(vector<Entry*>::iterator it = candidates.begin(); it != candidates.end(); ++it)
+	{
+		Entry* e = *it;
+		double dt = e->key.exp_time - key.exp_time;
+		Entry** best;
+		if(fabs(dt) <= EXP_TIME_EPSILON * key.exp_time)
+			best = &exact;
+		else
+			best = dt < 0 ? &below : &above;
+
+		if(!*best || fabs(e->key.exp_time - key.exp_time) < fabs((*best)->key.exp_time - key.exp_time) ||
+			(e->key.exp_time == (*best)->key.exp_time &&
+			 fabs(e->key.temperature - key.temperature) < fabs((*best)->key.temperature - key.temperature)))
+			*best = e;
+	}
+	if(exact)
+		below = above = exact;
+
+	if(!below || !above)
+	{
+		DEB_TRACE() << "No dark for " << DEB_VAR2(key.exp_time, key.temperature);
+		return None;
+	}
+
+	this->_load_data(*below);
+	if(below == above)
+	{
+		dark = below->data;
+		dark_key = below->key;
+		return Exact;
+	}
+
+	// dark signal is linear in exposure time
+	this->_load_data(*above);
+	double f = (key.exp_time - below->key.exp_time) / (above->key.exp_time - below->key.exp_time);
+	dark.resize(below->data.size());
+	for(size_t i = 0; i < dark.size(); ++i)
+		dark[i] = float(below->data[i] + f * (above->data[i] - below->data[i]));
+	dark_key = key;
+	dark_key.temperature = (below->key.temperature + above->key.temperature) / 2;
+	return Interpolated;
+}
+
+bool DarkLibrary::isStale(const DarkKey& dark_key, double temperature) const
+{
+	if(std::isnan(dark_key.temperature) || std::isnan(temperature))
+		return false;
+	return fabs(dark_key.temperature - temperature) > this->m_temp_tolerance;
+}
+
+void DarkLibrary::clear()
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_cache_dir.empty())
+		for(vector<Entry>::const_iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it)
+			remove(this->_path(it->file).c_str());
+	this->m_entries.clear();
+	if(!this->m_cache_dir.empty())
+		this->_save_index();
+}
@@ -0,0 +1,547 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cstdlib>
+#include <algorithm>
+
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "XimeaDemosaic.h"
+#include "XimeaSimd.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+namespace
+{
+	// frame being processed, shared by the stripes
+	struct Frame
+	{
+		uint32_t* dst;
+		const char* src;
+		size_t stride;
+		int width;
+		int height;
+		int max_val;
+		int shift;			// down to 8 bits
+		int red_x;			// red site of the 2x2 cell
+		int red_y;
+		uint16_t* green;	// edge aware green plane
+	};
+
+	// mirrored around the border, which keeps the Bayer parity
+	inline int _mirror(int i, int n)
+	{
+		if(i < 0)
+			return -i;
+		if(i >= n)
+			return 2 * n - 2 - i;
+		return i;
+	}
+
+	template <typename T>
+	inline const T* _row(const Frame& f, int y)
+	{
+		return (const T*)(f.src + _mirror(y, f.height) * f.stride);
+	}
+
+	inline uint32_t _pack(int r, int g, int b, int shift)
+	{
+		return 0xff000000u | uint32_t(std::min(r >> shift, 255)) << 16 |
+			uint32_t(std::min(g >> shift, 255)) << 8 | uint32_t(std::min(b >> shift, 255));
+	}
+
+	inline int _avg(int a, int b)
+	{
+		return (a + b + 1) >> 1;
+	}
+
+	inline int _clamp(int v, int max_val)
+	{
+		return v < 0 ? 0 : (v > max_val ? max_val : v);
+	}
+
+	template <typename T>
+	void _bilinear_pixels(const Frame& f, int y, const T* up, const T* row, const T* down, int x0, int x1)
+	{
+		bool red_row = (y & 1) == f.red_y;
+		uint32_t* out = f.dst + size_t(y) * f.width;
+		for(int x = x0; x < x1; ++x)
+		{
+			int l = _mirror(x - 1, f.width);
+			int r = _mirror(x + 1, f.width);
+			int c = row[x];
+			int h = _avg(row[l], row[r]);
+			int v = _avg(up[x], down[x]);
+			int cross = _avg(h, v);
+			int diag = _avg(_avg(up[l], up[r]), _avg(down[l], down[r]));
+			// red site in red rows, green one in blue rows
+			if((x & 1) == f.red_x)
+				out[x] = red_row ? _pack(c, cross, diag, f.shift) : _pack(v, c, h, f.shift);
+			else
+				out[x] = red_row ? _pack(h, c, v, f.shift) : _pack(diag, cross, c, f.shift);
+		}
+	}
+
+	template <typename T>
+	void _green_pixels(const Frame& f, int y, const T* const* rows, int x0, int x1)
+	{
+		bool red_row = (y & 1) == f.red_y;
+		int green_parity = red_row ? 1 - f.red_x : f.red_x;
+		const T* row = rows[2];
+		uint16_t* green = f.green + size_t(y) * f.width;
+		for(int x = x0; x < x1; ++x)
+		{
+			int c = row[x];
+			if((x & 1) == green_parity)
+			{
+				green[x] = uint16_t(c);
+				continue;
+			}
+			int gl = row[_mirror(x - 1, f.width)];
+			int gr = row[_mirror(x + 1, f.width)];
+			int gu = rows[1][x];
+			int gd = rows[3][x];
+			int lap_h = 2 * c - row[_mirror(x - 2, f.width)] - row[_mirror(x + 2, f.width)];
+			int lap_v = 2 * c - rows[0][x] - rows[4][x];
+			int dh = abs(gl - gr) + abs(lap_h);
+			int dv = abs(gu - gd) + abs(lap_v);
+			// 4 x green along each direction, Laplacian corrected
+			int gh4 = 2 * (gl + gr) + lap_h;
+			int gv4 = 2 * (gu + gd) + lap_v;
+			int g8 = dh < dv ? 2 * gh4 : (dv < dh ? 2 * gv4 : gh4 + gv4);
+			green[x] = uint16_t(std::min((std::max(g8, 0) + 4) >> 3, f.max_val));
+		}
+	}
+
+	template <typename T>
+	void _colour_pixels(const Frame& f, int y, const T* up, const T* row, const T* down,
+		const uint16_t* g_up, const uint16_t* g_row, const uint16_t* g_down, int x0, int x1)
+	{
+		bool red_row = (y & 1) == f.red_y;
+		uint32_t* out = f.dst + size_t(y) * f.width;
+		for(int x = x0; x < x1; ++x)
+		{
+			int l = _mirror(x - 1, f.width);
+			int r = _mirror(x + 1, f.width);
+			int c = row[x];
+			int g = g_row[x];
+			// colour differences to green, zero on green sites
+			int h = (row[l] - g_row[l] + row[r] - g_row[r] + 1) >> 1;
+			int v = (up[x] - g_up[x] + down[x] - g_down[x] + 1) >> 1;
+			int diag = (up[l] - g_up[l] + up[r] - g_up[r] + down[l] - g_down[l] + down[r] - g_down[r] + 2) >> 2;
+			int red, blue;
+			if((x & 1) == f.red_x)
+			{
+				red = red_row ? c : g + v;
+				blue = red_row ? g + diag : g + h;
+			}
+			else
+			{
+				red = red_row ? g + h : g + diag;
+				blue = red_row ? g + v : c;
+			}
+			out[x] = _pack(_clamp(red, f.max_val), g, _clamp(blue, f.max_val), f.shift);
+		}
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	XIMEA_TARGET_AVX2 inline __m256i _load16(const uint16_t* p)
+	{
+		return _mm256_loadu_si256((const __m256i*)p);
+	}
+
+	XIMEA_TARGET_AVX2 inline __m256i _load16(const uint8_t* p)
+	{
+		return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+	}
+
+	XIMEA_TARGET_AVX2 inline __m256i _load8(const uint16_t* p)
+	{
+		return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+	}
+
+	XIMEA_TARGET_AVX2 inline __m256i _load8(const uint8_t* p)
+	{
+		return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+	}
+
+	// lanes of the given x parity, x starting even
+	XIMEA_TARGET_AVX2 inline __m256i _parity_mask16(int parity)
+	{
+		return _mm256_set1_epi32(parity ? int(0xffff0000) : 0x0000ffff);
+	}
+
+	XIMEA_TARGET_AVX2 inline __m256i _parity_mask32(int parity)
+	{
+		return parity ? _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0) : _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+	}
+
+	// 16 x 16 bit channels of at most 8 bits to B G R A pixels
+	XIMEA_TARGET_AVX2 inline void _store16_bgra(uint32_t* out, __m256i r, __m256i g, __m256i b)
+	{
+		__m256i lo = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+		__m256i hi = _mm256_or_si256(r, _mm256_set1_epi16(short(0xff00)));
+		// unpack works per 128 bit lane, restore pixel order
+		__m256i p0 = _mm256_unpacklo_epi16(lo, hi);
+		__m256i p1 = _mm256_unpackhi_epi16(lo, hi);
+		_mm256_storeu_si256((__m256i*)out, _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256((__m256i*)(out + 8), _mm256_permute2x128_si256(p0, p1, 0x31));
+	}
+
+	template <typename T>
+	XIMEA_TARGET_AVX2 int _bilinear_avx2(const Frame& f, int y, const T* up, const T* row, const T* down)
+	{
+		bool red_row = (y & 1) == f.red_y;
+		uint32_t* out = f.dst + size_t(y) * f.width;
+		const __m256i site = _parity_mask16(f.red_x);
+		const __m256i max8 = _mm256_set1_epi16(255);
+		const __m128i shift = _mm_cvtsi32_si128(f.shift);
+		int x = 2;
+		for(; x + 17 <= f.width; x += 16)
+		{
+			__m256i c = _load16(row + x);
+			__m256i h = _mm256_avg_epu16(_load16(row + x - 1), _load16(row + x + 1));
+			__m256i v = _mm256_avg_epu16(_load16(up + x), _load16(down + x));
+			__m256i cross = _mm256_avg_epu16(h, v);
+			__m256i diag = _mm256_avg_epu16(_mm256_avg_epu16(_load16(up + x - 1), _load16(up + x + 1)),
+				_mm256_avg_epu16(_load16(down + x - 1), _load16(down + x + 1)));
+			__m256i r, g, b;
+			if(red_row)
+			{
+				r = _mm256_blendv_epi8(h, c, site);
+				g = _mm256_blendv_epi8(c, cross, site);
+				b = _mm256_blendv_epi8(v, diag, site);
+			}
+			else
+			{
+				r = _mm256_blendv_epi8(diag, v, site);
+				g = _mm256_blendv_epi8(cross, c, site);
+				b = _mm256_blendv_epi8(c, h, site);
+			}
+			r = _mm256_min_epu16(_mm256_srl_epi16(r, shift), max8);
+			g = _mm256_min_epu16(_mm256_srl_epi16(g, shift), max8);
+			b = _mm256_min_epu16(_mm256_srl_epi16(b, shift), max8);
+			_store16_bgra(out + x, r, g, b);
+		}
+		return x;
+	}
+
+	template <typename T>
+	XIMEA_TARGET_AVX2 int _green_avx2(const Frame& f, int y, const T* const* rows)
+	{
+		bool red_row = (y & 1) == f.red_y;
+		const T* row = rows[2];
+		uint16_t* green = f.green + size_t(y) * f.width;
+		const __m256i green_site = _parity_mask32(red_row ? 1 - f.red_x : f.red_x);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i max_val = _mm256_set1_epi32(f.max_val);
+		const __m256i four = _mm256_set1_epi32(4);
+		int x = 2;
+		for(; x + 10 <= f.width; x += 8)
+		{
+			__m256i c = _load8(row + x);
+			__m256i gl = _load8(row + x - 1);
+			__m256i gr = _load8(row + x + 1);
+			__m256i gu = _load8(rows[1] + x);
+			__m256i gd = _load8(rows[3] + x);
+			__m256i c2 = _mm256_slli_epi32(c, 1);
+			__m256i lap_h = _mm256_sub_epi32(_mm256_sub_epi32(c2, _load8(row + x - 2)), _load8(row + x + 2));
+			__m256i lap_v = _mm256_sub_epi32(_mm256_sub_epi32(c2, _load8(rows[0] + x)), _load8(rows[4] + x));
+			__m256i dh = _mm256_add_epi32(_mm256_abs_epi32(_mm256_sub_epi32(gl, gr)), _mm256_abs_epi32(lap_h));
+			__m256i dv = _mm256_add_epi32(_mm256_abs_epi32(_mm256_sub_epi32(gu, gd)), _mm256_abs_epi32(lap_v));
+			__m256i gh4 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(gl, gr), 1), lap_h);
+			__m256i gv4 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(gu, gd), 1), lap_v);
+			__m256i g8 = _mm256_add_epi32(gh4, gv4);
+			g8 = _mm256_blendv_epi8(g8, _mm256_slli_epi32(gh4, 1), _mm256_cmpgt_epi32(dv, dh));
+			g8 = _mm256_blendv_epi8(g8, _mm256_slli_epi32(gv4, 1), _mm256_cmpgt_epi32(dh, dv));
+			__m256i g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_max_epi32(g8, zero), four), 3);
+			g = _mm256_blendv_epi8(_mm256_min_epi32(g, max_val), c, green_site);
+			// packus works per 128 bit lane, restore pixel order
+			g = _mm256_permute4x64_epi64(_mm256_packus_epi32(g, g), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_si128((__m128i*)(green + x), _mm256_castsi256_si128(g));
+		}
+		return x;
+	}
+
+	template <typename T>
+	XIMEA_TARGET_AVX2 int _colour_avx2(const Frame& f, int y, const T* up, const T* row, const T* down,
+		const uint16_t* g_up, const uint16_t* g_row, const uint16_t* g_down)
+	{
+		bool red_row = (y & 1) == f.red_y;
+		uint32_t* out = f.dst + size_t(y) * f.width;
+		const __m256i site = _parity_mask32(f.red_x);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i max_val = _mm256_set1_epi32(f.max_val);
+		const __m256i max8 = _mm256_set1_epi32(255);
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i two = _mm256_set1_epi32(2);
+		const __m256i alpha = _mm256_set1_epi32(int(0xff000000));
+		const __m128i shift = _mm_cvtsi32_si128(f.shift);
+		int x = 2;
+		for(; x + 9 <= f.width; x += 8)
+		{
+			__m256i c = _load8(row + x);
+			__m256i g = _load8(g_row + x);
+			__m256i dl = _mm256_sub_epi32(_load8(row + x - 1), _load8(g_row + x - 1));
+			__m256i dr = _mm256_sub_epi32(_load8(row + x + 1), _load8(g_row + x + 1));
+			__m256i du = _mm256_sub_epi32(_load8(up + x), _load8(g_up + x));
+			__m256i dd = _mm256_sub_epi32(_load8(down + x), _load8(g_down + x));
+			__m256i dul = _mm256_sub_epi32(_load8(up + x - 1), _load8(g_up + x - 1));
+			__m256i dur = _mm256_sub_epi32(_load8(up + x + 1), _load8(g_up + x + 1));
+			__m256i ddl = _mm256_sub_epi32(_load8(down + x - 1), _load8(g_down + x - 1));
+			__m256i ddr = _mm256_sub_epi32(_load8(down + x + 1), _load8(g_down + x + 1));
+			__m256i h = _mm256_add_epi32(g, _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(dl, dr), one), 1));
+			__m256i v = _mm256_add_epi32(g, _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(du, dd), one), 1));
+			__m256i diag = _mm256_add_epi32(_mm256_add_epi32(dul, dur), _mm256_add_epi32(ddl, ddr));
+			diag = _mm256_add_epi32(g, _mm256_srai_epi32(_mm256_add_epi32(diag, two), 2));
+			__m256i r, b;
+			if(red_row)
+			{
+				r = _mm256_blendv_epi8(h, c, site);
+				b = _mm256_blendv_epi8(v, diag, site);
+			}
+			else
+			{
+				r = _mm256_blendv_epi8(diag, v, site);
+				b = _mm256_blendv_epi8(c, h, site);
+			}
+			r = _mm256_min_epi32(_mm256_srl_epi32(_mm256_min_epi32(_mm256_max_epi32(r, zero), max_val), shift), max8);
+			b = _mm256_min_epi32(_mm256_srl_epi32(_mm256_min_epi32(_mm256_max_epi32(b, zero), max_val), shift), max8);
+			g = _mm256_min_epi32(_mm256_srl_epi32(g, shift), max8);
+			__m256i p = _mm256_or_si256(_mm256_or_si256(alpha, _mm256_slli_epi32(r, 16)),
+				_mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+			_mm256_storeu_si256((__m256i*)(out + x), p);
+		}
+		return x;
+	}
+#endif
+
+	template <typename T>
+	void _bilinear_row(const Frame& f, int y)
+	{
+		const T* up = _row<T>(f, y - 1);
+		const T* row = _row<T>(f, y);
+		const T* down = _row<T>(f, y + 1);
+		int x = 0;
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+		if(Simd::hasAvx2())
+		{
+			_bilinear_pixels(f, y, up, row, down, 0, 2);
+			x = _bilinear_avx2(f, y, up, row, down);
+		}
+#endif
+		_bilinear_pixels(f, y, up, row, down, x, f.width);
+	}
+
+	template <typename T>
+	void _green_row(const Frame& f, int y)
+	{
+		const T* rows[5];
+		for(int i = 0; i < 5; ++i)
+			rows[i] = _row<T>(f, y + i - 2);
+		int x = 0;
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+		if(Simd::hasAvx2())
+		{
+			_green_pixels(f, y, rows, 0, 2);
+			x = _green_avx2(f, y, rows);
+		}
+#endif
+		_green_pixels(f, y, rows, x, f.width);
+	}
+
+	template <typename T>
+	void _colour_row(const Frame& f, int y)
+	{
+		const T* up = _row<T>(f, y - 1);
+		const T* row = _row<T>(f, y);
+		const T* down = _row<T>(f, y + 1);
+		const uint16_t* g_up = f.green + size_t(_mirror(y - 1, f.height)) * f.width;
+		const uint16_t* g_row = f.green + size_t(y) * f.width;
+		const uint16_t* g_down = f.green + size_t(_mirror(y + 1, f.height)) * f.width;
+		int x = 0;
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+		if(Simd::hasAvx2())
+		{
+			_colour_pixels(f, y, up, row, down, g_up, g_row, g_down, 0, 2);
+			x = _colour_avx2(f, y, up, row, down, g_up, g_row, g_down);
+		}
+#endif
+		_colour_pixels(f, y, up, row, down, g_up, g_row, g_down, x, f.width);
+	}
+
+	// one pass over the frame, the green plane being complete before the
+	// colour pass starts
+	class PassTask : public StripeWorkers::Task
+	{
+	public:
+		enum Pass { BilinearPass, GreenPass, ColourPass };
+
+		PassTask(const Frame& f, int pixel_size, Pass pass) : m_frame(f), m_pixel_size(pixel_size), m_pass(pass) {}
+
+		virtual void process(int first_row, int last_row)
+		{
+			for(int y = first_row; y < last_row; ++y)
+			{
+				if(this->m_pixel_size == 1)
+					this->_process_row<uint8_t>(y);
+				else
+					this->_process_row<uint16_t>(y);
+			}
+		}
+
+	private:
+		template <typename T>
+		void _process_row(int y)
+		{
+			switch(this->m_pass)
+			{
+				case BilinearPass:
+					_bilinear_row<T>(this->m_frame, y);
+					break;
+				case GreenPass:
+					_green_row<T>(this->m_frame, y);
+					break;
+				case ColourPass:
+					_colour_row<T>(this->m_frame, y);
+					break;
+			}
+		}
+
+		const Frame& m_frame;
+		int m_pixel_size;
+		Pass m_pass;
+	};
+} // namespace
+
+DemosaicThroughput::DemosaicThroughput()
+	: algorithm(Demosaic::Bilinear),
+	  bit_depth(0),
+	  frame_time(0),
+	  throughput(0)
+{
+}
+
+Demosaic::Demosaic()
+	: m_algorithm(Bilinear)
+{
+}
+
+void Demosaic::prepare(int width, int height)
+{
+	this->m_green.resize(size_t(width) * height);
+}
+
+void Demosaic::process(uint32_t* dst, const void* src, int pixel_size, int bit_depth, int width, int height,
+	size_t stride, Pattern pattern, StripeWorkers& workers)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(pixel_size != 1 && pixel_size != 2)
+		THROW_HW_ERROR(InvalidValue) << "Demosaic needs 8 or 16 bit raw pixels, not " << pixel_size << " bytes";
+	// the mirrored borders need a few pixels
+	if(width < 4 || height < 4)
+		THROW_HW_ERROR(InvalidValue) << "Frame " << width << "x" << height << " too small to demosaic";
+
+	Frame f;
+	f.dst = dst;
+	f.src = (const char*)src;
+	f.stride = stride;
+	f.width = width;
+	f.height = height;
+	bit_depth = pixel_size == 1 ? 8 : std::min(std::max(bit_depth, 8), 16);
+	f.max_val = (1 << bit_depth) - 1;
+	f.shift = bit_depth - 8;
+	f.red_x = (pattern == GRBG || pattern == BGGR) ? 1 : 0;
+	f.red_y = (pattern == GBRG || pattern == BGGR) ? 1 : 0;
+	f.green = NULL;
+
+	if(this->m_algorithm == Bilinear)
+	{
+		PassTask task(f, pixel_size, PassTask::BilinearPass);
+		workers.run(task, height);
+		return;
+	}
+
+	if(this->m_green.size() < size_t(width) * height)
+		THROW_HW_ERROR(Error) << "Demosaic not prepared for " << width << "x" << height << " frames";
+	f.green = &this->m_green[0];
+	PassTask green(f, pixel_size, PassTask::GreenPass);
+	workers.run(green, height);
+	PassTask colour(f, pixel_size, PassTask::ColourPass);
+	workers.run(colour, height);
+}
+
+void Demosaic::benchmark(int width, int height, int nb_frames, StripeWorkers& workers,
+	std::vector<DemosaicThroughput>& results)
+{
+	DEB_STATIC_FUNCT();
+	DEB_PARAM() << DEB_VAR3(width, height, nb_frames);
+
+	if(nb_frames < 1)
+		THROW_HW_ERROR(InvalidValue) << "Demosaic benchmark needs at least one frame";
+
+	// smooth ramps plus a fixed noise pattern, so that neither algorithm
+	// takes a shortcut
+	std::vector<uint16_t> raw(size_t(width) * height);
+	uint32_t seed = 12345;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+		{
+			seed = seed * 1103515245u + 12345u;
+			raw[size_t(y) * width + x] = uint16_t(((x + 2 * y) & 0x7ff) + ((seed >> 16) & 0x1ff));
+		}
+	std::vector<uint8_t> raw8(raw.size());
+	for(size_t i = 0; i < raw.size(); ++i)
+		raw8[i] = uint8_t(raw[i] >> 4);
+	std::vector<uint32_t> rgb(raw.size());
+
+	Demosaic demosaic;
+	demosaic.prepare(width, height);
+	static const Algorithm algorithms[] = { Bilinear, EdgeAware };
+	static const int bit_depths[] = { 8, 12 };
+	results.clear();
+	for(int a = 0; a < 2; ++a)
+		for(int b = 0; b < 2; ++b)
+		{
+			demosaic.setAlgorithm(algorithms[a]);
+			int pixel_size = bit_depths[b] == 8 ? 1 : 2;
+			const void* src = pixel_size == 1 ? (const void*)&raw8[0] : (const void*)&raw[0];
+			Timestamp t0 = Timestamp::now();
+			for(int i = 0; i < nb_frames; ++i)
+				demosaic.process(&rgb[0], src, pixel_size, bit_depths[b], width, height,
+					size_t(width) * pixel_size, RGGB, workers);
+			double dt = Timestamp::now() - t0;
+
+			DemosaicThroughput r;
+			r.algorithm = algorithms[a];
+			r.bit_depth = bit_depths[b];
+			r.frame_time = dt / nb_frames;
+			r.throughput = dt > 0 ? double(width) * height * nb_frames / dt / 1e6 : 0;
+			DEB_TRACE() << DEB_VAR4(r.algorithm, r.bit_depth, r.frame_time, r.throughput);
+			results.push_back(r);
+		}
+}
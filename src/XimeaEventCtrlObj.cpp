@@ -23,16 +23,22 @@
 //###########################################################################
 
 #include "XimeaEventCtrlObj.h"
+#include "XimeaCamera.h"
 
 using namespace lima;
 using namespace lima::Ximea;
 
 EventCtrlObj::EventCtrlObj(Camera& cam) : m_cam(cam)
 {
-
+	this->m_cam.m_event_queue.setSink(this);
 }
 
 EventCtrlObj::~EventCtrlObj()
 {
+	this->m_cam.m_event_queue.setSink(NULL);
+}
 
+void EventCtrlObj::deliver(Event* event)
+{
+	this->reportEvent(event);
 }
@@ -0,0 +1,425 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cstdio>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "XimeaEventQueue.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+EventQueue::Record::Record(Type type, Code code, const char* text, long value)
+	: type(type),
+	  code(code),
+	  text(text),
+	  value(value),
+	  status(0),
+	  reading(0),
+	  limit(0),
+	  detail(NULL)
+{
+}
+
+EventQueue::Counts::Counts()
+	: pushed(0),
+	  delivered(0),
+	  coalesced(0),
+	  suppressed(0),
+	  lost(0)
+{
+}
+
+EventQueue::EventQueue(Sink& sink, int capacity)
+	: m_default_sink(sink),
+	  m_sink(&sink),
+	  m_enqueue_pos(0),
+	  m_dequeue_pos(0),
+	  m_nb_pushed(0),
+	  m_nb_lost(0),
+	  m_thread(NULL),
+	  m_quit(false),
+	  m_max_rate(5.0),
+	  m_coalesce_time(0.2),
+	  m_token_time(0),
+	  m_reported_lost(0),
+	  m_nb_delivered(0),
+	  m_nb_coalesced(0),
+	  m_nb_suppressed(0)
+{
+	// power of two, sequence numbers tell free slots from used ones
+	size_t size = 1;
+	while(size < size_t(capacity))
+		size <<= 1;
+	this->m_slots = new Slot[size];
+	this->m_mask = size - 1;
+	for(size_t i = 0; i < size; ++i)
+		this->m_slots[i].seq.store(i, std::memory_order_relaxed);
+
+	for(int t = 0; t < NbTypes; ++t)
+	{
+		this->m_tokens[t] = 0;
+		this->m_pending_suppressed[t] = 0;
+	}
+}
+
+EventQueue::~EventQueue()
+{
+	this->stop();
+	// never drained when not started
+	Record record;
+	while(this->_pop(record))
+		delete record.detail;
+	delete [] this->m_slots;
+}
+
+void EventQueue::start()
+{
+	DEB_MEMBER_FUNCT();
+
+	if(this->m_thread)
+		return;
+	{
+		AutoMutex lock(this->m_cond.mutex());
+		this->m_quit = false;
+	}
+	this->m_thread = new DrainThread(*this);
+	this->m_thread->start();
+}
+
+void EventQueue::stop()
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_thread)
+		return;
+	{
+		AutoMutex lock(this->m_cond.mutex());
+		this->m_quit = true;
+		this->m_cond.broadcast();
+	}
+	// joins
+	delete this->m_thread;
+	this->m_thread = NULL;
+}
+
+bool EventQueue::push(Type type, const char* text, long value)
+{
+	return this->push(Record(type, Text, text, value));
+}
+
+bool EventQueue::pushFailure(const char* where, const std::string& description)
+{
+	Record record(Error, Failure, where);
+	record.detail = new std::string(description);
+	return this->push(record);
+}
+
+bool EventQueue::push(const Record& record)
+{
+	this->m_nb_pushed.fetch_add(1, std::memory_order_relaxed);
+
+	// claim a slot, bounded MPMC queue from D. Vyukov
+	Slot* slot;
+	size_t pos = this->m_enqueue_pos.load(std::memory_order_relaxed);
+	while(true)
+	{
+		slot = &this->m_slots[pos & this->m_mask];
+		size_t seq = slot->seq.load(std::memory_order_acquire);
+		long dif = long(seq) - long(pos);
+		if(dif == 0)
+		{
+			if(this->m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if(dif < 0)
+		{
+			// full: the drain thread is behind, drop rather than wait
+			this->m_nb_lost.fetch_add(1, std::memory_order_relaxed);
+			delete record.detail;
+			return false;
+		}
+		else
+			pos = this->m_enqueue_pos.load(std::memory_order_relaxed);
+	}
+
+	slot->record = record;
+	slot->seq.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool EventQueue::_pop(Record& record)
+{
+	// single consumer: the drain thread
+	Slot& slot = this->m_slots[this->m_dequeue_pos & this->m_mask];
+	if(slot.seq.load(std::memory_order_acquire) != this->m_dequeue_pos + 1)
+		return false;
+	record = slot.record;
+	slot.seq.store(this->m_dequeue_pos + this->m_mask + 1, std::memory_order_release);
+	++this->m_dequeue_pos;
+	return true;
+}
+
+void EventQueue::setSink(Sink* sink)
+{
+	AutoMutex lock(this->m_sink_mutex);
+	this->m_sink = sink ? sink : &this->m_default_sink;
+}
+
+void EventQueue::setMaxRate(double rate)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(rate < 0)
+		THROW_HW_ERROR(InvalidValue) << "Event rate must not be negative";
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_max_rate = rate;
+}
+
+void EventQueue::setCoalesceTime(double t)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(t <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Event coalesce time must be positive";
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_coalesce_time = t;
+	this->m_cond.broadcast();
+}
+
+void EventQueue::getCounts(Counts& counts)
+{
+	AutoMutex lock(this->m_cond.mutex());
+	counts.pushed = this->m_nb_pushed.load(std::memory_order_relaxed);
+	counts.lost = this->m_nb_lost.load(std::memory_order_relaxed);
+	counts.delivered = this->m_nb_delivered;
+	counts.coalesced = this->m_nb_coalesced;
+	counts.suppressed = this->m_nb_suppressed;
+}
+
+const char* EventQueue::typeName(Type type)
+{
+	switch(type)
+	{
+		case Error:				return "error";
+		case DroppedFrames:		return "dropped frames";
+		case QueueOverrun:		return "SDK queue overrun";
+		case TemperatureAlarm:	return "temperature alarm";
+		case Timeout:			return "timeout";
+		case Warning:			return "warning";
+		default:				return "unknown";
+	}
+}
+
+std::string EventQueue::format(const Record& record)
+{
+	std::ostringstream msg;
+	switch(record.code)
+	{
+		case Failure:
+			msg << record.text << " failed: " << (record.detail ? *record.detail : std::string());
+			break;
+		case ReadFailed:
+			msg << record.text << " failed: Image read failed, status: " << record.status;
+			break;
+		case FrameNotReady:
+			msg << record.text << " failed: Frame not ready";
+			break;
+		case ParamRejected:
+			msg << "Parameter " << record.text << " " << record.value << " rejected, xi_status: " << record.status;
+			break;
+		case TemperatureAbove:
+			msg << std::fixed << std::setprecision(1) << "Sensor board at " << record.reading << " *C, above "
+				<< record.limit << " *C";
+			break;
+		default:
+			msg << record.text;
+	}
+	return msg.str();
+}
+
+void EventQueue::_deliver(Type type, const std::string& msg)
+{
+	DEB_MEMBER_FUNCT();
+
+	Event::Severity severity = Event::Warning;
+	Event::Code code = Event::Default;
+	switch(type)
+	{
+		case Error:
+			severity = Event::Error;
+			code = Event::CamCommError;
+			break;
+		case DroppedFrames:
+		case QueueOverrun:
+			code = Event::CamOverrun;
+			break;
+		case TemperatureAlarm:
+			code = Event::CamOverheat;
+			break;
+		case Timeout:
+			code = Event::CamCommError;
+			break;
+		default:
+			break;
+	}
+
+	Event* event = new Event(Hardware, severity, Event::Camera, code, msg);
+	DEB_EVENT(*event) << DEB_VAR1(*event);
+	AutoMutex lock(this->m_sink_mutex);
+	this->m_sink->deliver(event);
+}
+
+void EventQueue::_drain(double now)
+{
+	double max_rate, coalesce_time;
+	{
+		AutoMutex lock(this->m_cond.mutex());
+		max_rate = this->m_max_rate;
+		coalesce_time = this->m_coalesce_time;
+	}
+
+	// identical records of this period become one event
+	this->m_groups.clear();
+	unsigned long nb_coalesced = 0;
+	Record record;
+	while(this->_pop(record))
+	{
+		std::string msg = format(record);
+		delete record.detail;
+		std::vector<Group>::iterator it = this->m_groups.begin();
+		for(; it != this->m_groups.end(); ++it)
+			if(it->type == record.type && it->msg == msg)
+				break;
+		if(it != this->m_groups.end())
+		{
+			++it->count;
+			it->value += record.value;
+			++nb_coalesced;
+			continue;
+		}
+		Group group;
+		group.type = record.type;
+		group.msg = msg;
+		group.count = 1;
+		group.value = record.value;
+		this->m_groups.push_back(group);
+	}
+
+	// token bucket per type, bursts of up to one second
+	bool limited = max_rate > 0;
+	double burst = std::max(max_rate, 1.0);
+	for(int t = 0; t < NbTypes; ++t)
+		if(this->m_token_time)
+			this->m_tokens[t] = std::min(burst, this->m_tokens[t] + (now - this->m_token_time) * max_rate);
+		else
+			this->m_tokens[t] = burst;
+	this->m_token_time = now;
+
+	unsigned long nb_delivered = 0, nb_suppressed = 0;
+	for(std::vector<Group>::iterator it = this->m_groups.begin(); it != this->m_groups.end(); ++it)
+	{
+		Type type = it->type;
+		if(limited && this->m_tokens[type] < 1)
+		{
+			this->m_pending_suppressed[type] += it->count;
+			nb_suppressed += it->count;
+			continue;
+		}
+		if(limited)
+			this->m_tokens[type] -= 1;
+
+		std::ostringstream msg;
+		msg << it->msg;
+		if(type == DroppedFrames || type == QueueOverrun)
+			msg << ": " << it->value << " frames";
+		if(it->count > 1)
+			msg << " (" << it->count << " times in " << std::fixed << std::setprecision(1) << coalesce_time << " s)";
+		if(this->m_pending_suppressed[type])
+		{
+			msg << ", " << this->m_pending_suppressed[type] << " earlier " << typeName(type) << " events suppressed";
+			this->m_pending_suppressed[type] = 0;
+		}
+		this->_deliver(type, msg.str());
+		++nb_delivered;
+	}
+
+	// summary once a quiet type has room again
+	for(int t = 0; t < NbTypes; ++t)
+	{
+		if(!this->m_pending_suppressed[t] || (limited && this->m_tokens[t] < 1))
+			continue;
+		bool seen = false;
+		for(std::vector<Group>::iterator it = this->m_groups.begin(); it != this->m_groups.end(); ++it)
+			seen = seen || it->type == t;
+		if(seen)
+			continue;
+		if(limited)
+			this->m_tokens[t] -= 1;
+		char msg[96];
+		snprintf(msg, sizeof(msg), "%lu %s events suppressed", this->m_pending_suppressed[t], typeName(Type(t)));
+		this->m_pending_suppressed[t] = 0;
+		this->_deliver(Type(t), msg);
+		++nb_delivered;
+	}
+
+	// the ring itself overflowed
+	unsigned long nb_lost = this->m_nb_lost.load(std::memory_order_relaxed);
+	if(nb_lost != this->m_reported_lost)
+	{
+		char msg[96];
+		snprintf(msg, sizeof(msg), "%lu events lost, event queue full", nb_lost - this->m_reported_lost);
+		this->m_reported_lost = nb_lost;
+		this->_deliver(Error, msg);
+		++nb_delivered;
+	}
+
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_nb_delivered += nb_delivered;
+	this->m_nb_coalesced += nb_coalesced;
+	this->m_nb_suppressed += nb_suppressed;
+}
+
+void EventQueue::DrainThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+
+	EventQueue& queue = this->m_queue;
+	AutoMutex lock(queue.m_cond.mutex());
+	while(!queue.m_quit)
+	{
+		// producers never signal, they must not take a lock
+		queue.m_cond.wait(queue.m_coalesce_time);
+		lock.unlock();
+		queue._drain(double(Timestamp::now()));
+		lock.lock();
+	}
+	lock.unlock();
+	queue._drain(double(Timestamp::now()));
+}
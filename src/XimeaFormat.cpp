@@ -0,0 +1,275 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <algorithm>
+
+#include "XimeaFormat.h"
+#include "XimeaSimd.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+namespace
+{
+	struct Rows
+	{
+		const char* src;	// first plane
+		size_t stride;
+		size_t plane_size;
+		int shift;
+	};
+
+	inline uint32_t _pack(int r, int g, int b)
+	{
+		return 0xff000000u | uint32_t(r) << 16 | uint32_t(g) << 8 | uint32_t(b);
+	}
+
+	inline int _to_8bit(uint16_t v, int shift)
+	{
+		return std::min(v >> shift, 255);
+	}
+
+	void _rgb24_row(uint32_t* dst, const uint8_t* src, int n)
+	{
+		for(int i = 0; i < n; ++i)
+			dst[i] = _pack(src[3 * i + 2], src[3 * i + 1], src[3 * i]);
+	}
+
+	void _rgb48_row(uint32_t* dst, const uint16_t* src, int n, int shift)
+	{
+		for(int i = 0; i < n; ++i)
+			dst[i] = _pack(_to_8bit(src[3 * i + 2], shift), _to_8bit(src[3 * i + 1], shift), _to_8bit(src[3 * i], shift));
+	}
+
+	void _rgb64_row(uint32_t* dst, const uint16_t* src, int n, int shift)
+	{
+		for(int i = 0; i < n; ++i)
+			dst[i] = _pack(_to_8bit(src[4 * i + 2], shift), _to_8bit(src[4 * i + 1], shift), _to_8bit(src[4 * i], shift));
+	}
+
+	void _planar_row(uint32_t* dst, const uint8_t* r, const uint8_t* g, const uint8_t* b, int n)
+	{
+		for(int i = 0; i < n; ++i)
+			dst[i] = _pack(r[i], g[i], b[i]);
+	}
+
+	void _planar16_row(uint32_t* dst, const uint16_t* r, const uint16_t* g, const uint16_t* b, int n, int shift)
+	{
+		for(int i = 0; i < n; ++i)
+			dst[i] = _pack(_to_8bit(r[i], shift), _to_8bit(g[i], shift), _to_8bit(b[i], shift));
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	// 4 B G R pixels of v to B G R A
+	XIMEA_TARGET_AVX2 inline __m128i _bgr_to_bgra(__m128i v)
+	{
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		return _mm_or_si128(_mm_shuffle_epi8(v, shuffle), _mm_set1_epi32(int(0xff000000)));
+	}
+
+	// 8 x 16 bit channels down to 8 bit
+	XIMEA_TARGET_AVX2 inline __m128i _shift_16(const uint16_t* p, __m128i shift)
+	{
+		__m128i v = _mm_srl_epi16(_mm_loadu_si128((const __m128i*)p), shift);
+		return _mm_min_epu16(v, _mm_set1_epi16(255));
+	}
+
+	// 16 pixels of 8 bit planes to B G R A
+	XIMEA_TARGET_AVX2 inline void _store_planar(uint32_t* dst, __m128i r, __m128i g, __m128i b)
+	{
+		__m128i a = _mm_set1_epi8(-1);
+		__m128i bg_lo = _mm_unpacklo_epi8(b, g);
+		__m128i bg_hi = _mm_unpackhi_epi8(b, g);
+		__m128i ra_lo = _mm_unpacklo_epi8(r, a);
+		__m128i ra_hi = _mm_unpackhi_epi8(r, a);
+		_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(bg_lo, ra_lo));
+		_mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi16(bg_lo, ra_lo));
+		_mm_storeu_si128((__m128i*)(dst + 8), _mm_unpacklo_epi16(bg_hi, ra_hi));
+		_mm_storeu_si128((__m128i*)(dst + 12), _mm_unpackhi_epi16(bg_hi, ra_hi));
+	}
+
+	XIMEA_TARGET_AVX2 void _rgb24_row_avx2(uint32_t* dst, const uint8_t* src, int n)
+	{
+		int i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			// 24 bytes, no read past the last pixel
+			__m128i lo = _mm_loadu_si128((const __m128i*)(src + 3 * i));
+			__m128i hi = _mm_loadl_epi64((const __m128i*)(src + 3 * i + 16));
+			_mm_storeu_si128((__m128i*)(dst + i), _bgr_to_bgra(lo));
+			_mm_storeu_si128((__m128i*)(dst + i + 4), _bgr_to_bgra(_mm_alignr_epi8(hi, lo, 12)));
+		}
+		_rgb24_row(dst + i, src + 3 * i, n - i);
+	}
+
+	XIMEA_TARGET_AVX2 void _rgb48_row_avx2(uint32_t* dst, const uint16_t* src, int n, int shift)
+	{
+		const __m128i s = _mm_cvtsi32_si128(shift);
+		int i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			const uint16_t* p = src + 3 * i;
+			__m128i lo = _mm_packus_epi16(_shift_16(p, s), _shift_16(p + 8, s));
+			__m128i hi = _mm_packus_epi16(_shift_16(p + 16, s), _mm_setzero_si128());
+			_mm_storeu_si128((__m128i*)(dst + i), _bgr_to_bgra(lo));
+			_mm_storeu_si128((__m128i*)(dst + i + 4), _bgr_to_bgra(_mm_alignr_epi8(hi, lo, 12)));
+		}
+		_rgb48_row(dst + i, src + 3 * i, n - i, shift);
+	}
+
+	XIMEA_TARGET_AVX2 void _rgb64_row_avx2(uint32_t* dst, const uint16_t* src, int n, int shift)
+	{
+		const __m128i s = _mm_cvtsi32_si128(shift);
+		const __m128i alpha = _mm_set1_epi32(int(0xff000000));
+		int i = 0;
+		for(; i + 4 <= n; i += 4)
+		{
+			const uint16_t* p = src + 4 * i;
+			__m128i v = _mm_packus_epi16(_shift_16(p, s), _shift_16(p + 8, s));
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(v, alpha));
+		}
+		_rgb64_row(dst + i, src + 4 * i, n - i, shift);
+	}
+
+	XIMEA_TARGET_AVX2 void _planar_row_avx2(uint32_t* dst, const uint8_t* r, const uint8_t* g, const uint8_t* b, int n)
+	{
+		int i = 0;
+		for(; i + 16 <= n; i += 16)
+			_store_planar(dst + i, _mm_loadu_si128((const __m128i*)(r + i)), _mm_loadu_si128((const __m128i*)(g + i)),
+				_mm_loadu_si128((const __m128i*)(b + i)));
+		_planar_row(dst + i, r + i, g + i, b + i, n - i);
+	}
+
+	XIMEA_TARGET_AVX2 void _planar16_row_avx2(uint32_t* dst, const uint16_t* r, const uint16_t* g, const uint16_t* b,
+		int n, int shift)
+	{
+		const __m128i s = _mm_cvtsi32_si128(shift);
+		int i = 0;
+		for(; i + 16 <= n; i += 16)
+			_store_planar(dst + i, _mm_packus_epi16(_shift_16(r + i, s), _shift_16(r + i + 8, s)),
+				_mm_packus_epi16(_shift_16(g + i, s), _shift_16(g + i + 8, s)),
+				_mm_packus_epi16(_shift_16(b + i, s), _shift_16(b + i + 8, s)));
+		_planar16_row(dst + i, r + i, g + i, b + i, n - i, shift);
+	}
+#endif
+
+	class ConvertTask : public StripeWorkers::Task
+	{
+	public:
+		ConvertTask(uint32_t* dst, const Rows& rows, ColourLayout layout, int width)
+			: m_dst(dst), m_rows(rows), m_layout(layout), m_width(width)
+		{
+		}
+
+		virtual void process(int first_row, int last_row)
+		{
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+			bool avx2 = Simd::hasAvx2();
+#endif
+			int n = this->m_width;
+			for(int y = first_row; y < last_row; ++y)
+			{
+				uint32_t* dst = this->m_dst + size_t(y) * n;
+				const char* row = this->m_rows.src + y * this->m_rows.stride;
+				// same row of the other planes
+				const char* g = row + this->m_rows.plane_size;
+				const char* b = g + this->m_rows.plane_size;
+				int shift = this->m_rows.shift;
+				switch(this->m_layout)
+				{
+					case ColourLayout_Rgb24:
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+						if(avx2)
+						{
+							_rgb24_row_avx2(dst, (const uint8_t*)row, n);
+							break;
+						}
+#endif
+						_rgb24_row(dst, (const uint8_t*)row, n);
+						break;
+					case ColourLayout_Rgb48:
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+						if(avx2)
+						{
+							_rgb48_row_avx2(dst, (const uint16_t*)row, n, shift);
+							break;
+						}
+#endif
+						_rgb48_row(dst, (const uint16_t*)row, n, shift);
+						break;
+					case ColourLayout_Rgb64:
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+						if(avx2)
+						{
+							_rgb64_row_avx2(dst, (const uint16_t*)row, n, shift);
+							break;
+						}
+#endif
+						_rgb64_row(dst, (const uint16_t*)row, n, shift);
+						break;
+					case ColourLayout_RgbPlanar:
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+						if(avx2)
+						{
+							_planar_row_avx2(dst, (const uint8_t*)row, (const uint8_t*)g, (const uint8_t*)b, n);
+							break;
+						}
+#endif
+						_planar_row(dst, (const uint8_t*)row, (const uint8_t*)g, (const uint8_t*)b, n);
+						break;
+					case ColourLayout_Rgb16Planar:
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+						if(avx2)
+						{
+							_planar16_row_avx2(dst, (const uint16_t*)row, (const uint16_t*)g, (const uint16_t*)b, n, shift);
+							break;
+						}
+#endif
+						_planar16_row(dst, (const uint16_t*)row, (const uint16_t*)g, (const uint16_t*)b, n, shift);
+						break;
+				}
+			}
+		}
+
+	private:
+		uint32_t* m_dst;
+		Rows m_rows;
+		ColourLayout m_layout;
+		int m_width;
+	};
+} // namespace
+
+void lima::Ximea::convertToRgb32(uint32_t* dst, const void* src, ColourLayout layout, int bit_depth,
+	int width, int height, size_t src_stride, StripeWorkers& workers)
+{
+	Rows rows;
+	rows.src = (const char*)src;
+	rows.stride = src_stride;
+	rows.plane_size = src_stride * height;
+	rows.shift = std::max(bit_depth - 8, 0);
+
+	ConvertTask task(dst, rows, layout, width);
+	workers.run(task, height);
+}
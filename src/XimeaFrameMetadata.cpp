@@ -0,0 +1,140 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cstring>
+
+#include "lima/Exceptions.h"
+#include "XimeaFrameMetadata.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+// .npy version 1.0 header, padded to this size
+#define NPY_HEADER_SIZE	1024
+#define SIDECAR_BUFFER_SIZE	(1 << 20)
+
+// numpy dtype of FrameMetadata, little endian
+static const char* const NPY_DESCR =
+	"[('host_time', '<f8'), ('data_saturation', '<f8'), ('frame_nb', '<i4'), "
+	"('acq_nframe', '<u4'), ('nframe', '<u4'), ('ts_sec', '<u4'), ('ts_usec', '<u4'), "
+	"('exposure_time_us', '<u4'), ('gain_db', '<f4'), ('black_level', '<u4'), "
+	"('gpi_level', '<u4'), ('flags', '<u4'), ('image_user_data', '<u4'), "
+	"('width', '<u4'), ('height', '<u4'), ('offset_x', '<u4'), ('offset_y', '<u4'), "
+	"('sequence_step', '<i4')]";
+
+FrameMetadata::FrameMetadata()
+{
+	memset(this, 0, sizeof(*this));
+	this->frame_nb = -1;
+	this->sequence_step = -1;
+}
+
+MetadataSidecar::MetadataSidecar()
+	: m_file(NULL),
+	  m_format(Raw),
+	  m_nb_records(0)
+{
+}
+
+MetadataSidecar::~MetadataSidecar()
+{
+	this->close();
+}
+
+void MetadataSidecar::open(const std::string& path, Format format)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(path, format);
+
+	this->close();
+	this->m_file = fopen(path.c_str(), "wb");
+	if(!this->m_file)
+		THROW_HW_ERROR(Error) << "Could not create metadata sidecar " << path;
+
+	// records are small, the grab thread only pays for a write() once
+	// per buffer full and at close()
+	this->m_buffer.resize(SIDECAR_BUFFER_SIZE);
+	setvbuf(this->m_file, &this->m_buffer[0], _IOFBF, this->m_buffer.size());
+	this->m_format = format;
+	this->m_nb_records = 0;
+	if(format == Npy)
+		this->_write_npy_header();
+}
+
+void MetadataSidecar::_write_npy_header()
+{
+	DEB_MEMBER_FUNCT();
+
+	char header[NPY_HEADER_SIZE];
+	memset(header, ' ', sizeof(header));
+	memcpy(header, "\x93NUMPY\x01\x00", 8);
+	uint16_t len = NPY_HEADER_SIZE - 10;
+	header[8] = char(len & 0xff);
+	header[9] = char(len >> 8);
+
+	char dict[NPY_HEADER_SIZE];
+	int n = snprintf(dict, sizeof(dict), "{'descr': %s, 'fortran_order': False, 'shape': (%ld,), }",
+		NPY_DESCR, this->m_nb_records);
+	if(n < 0 || n >= NPY_HEADER_SIZE - 11)
+		THROW_HW_ERROR(Error) << "Metadata sidecar header too long";
+	memcpy(header + 10, dict, n);
+	header[NPY_HEADER_SIZE - 1] = '\n';
+
+	if(fwrite(header, sizeof(header), 1, this->m_file) != 1)
+		THROW_HW_ERROR(Error) << "Could not write metadata sidecar header";
+}
+
+void MetadataSidecar::append(const FrameMetadata& metadata)
+{
+	if(!this->m_file)
+		return;
+	if(fwrite(&metadata, sizeof(metadata), 1, this->m_file) == 1)
+		++this->m_nb_records;
+}
+
+void MetadataSidecar::close()
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_file)
+		return;
+
+	if(this->m_format == Npy)
+	{
+		// now that the record count is known
+		fseek(this->m_file, 0, SEEK_SET);
+		try
+		{
+			this->_write_npy_header();
+		}
+		catch(Exception& e)
+		{
+			DEB_ERROR() << e;
+		}
+	}
+	fclose(this->m_file);
+	this->m_file = NULL;
+	DEB_TRACE() << DEB_VAR1(this->m_nb_records);
+}
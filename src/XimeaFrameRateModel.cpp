@@ -0,0 +1,83 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <algorithm>
+
+#include "XimeaFrameRateModel.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+SensorTiming::SensorTiming()
+	: line_time(0),
+	  frame_overhead(0),
+	  min_exp_time(0),
+	  max_exp_time(0),
+	  overlap(true)
+{
+}
+
+TimingPrediction::TimingPrediction()
+	: min_exp_time(0),
+	  max_exp_time(0),
+	  min_lat_time(0),
+	  readout_time(0),
+	  max_fps_sensor(0),
+	  max_fps_bandwidth(0),
+	  max_fps(0),
+	  min_trigger_period(0),
+	  max_trigger_rate(0),
+	  calibrated(false)
+{
+}
+
+void FrameRateModel::predict(const SensorTiming& timing, double exp_time, int rows,
+	double frame_bytes, double bandwidth, bool trigger_overlap, TimingPrediction& prediction)
+{
+	prediction.min_exp_time = timing.min_exp_time;
+	prediction.max_exp_time = timing.max_exp_time;
+	prediction.readout_time = timing.frame_overhead + rows * timing.line_time;
+
+	exp_time = std::max(timing.min_exp_time, std::min(timing.max_exp_time, exp_time));
+	double sensor_period = timing.overlap ? std::max(exp_time, prediction.readout_time) : exp_time + prediction.readout_time;
+	prediction.max_fps_sensor = sensor_period > 0 ? 1 / sensor_period : 0;
+
+	prediction.max_fps_bandwidth = bandwidth > 0 && frame_bytes > 0 ? bandwidth / frame_bytes : 0;
+	if(prediction.max_fps_bandwidth > 0)
+		prediction.max_fps = std::min(prediction.max_fps_sensor, prediction.max_fps_bandwidth);
+	else
+		prediction.max_fps = prediction.max_fps_sensor;
+
+	// a trigger arriving before the sensor is ready is missed; without
+	// overlap that is after exposure and readout
+	double trigger_period = trigger_overlap && timing.overlap ? sensor_period : exp_time + prediction.readout_time;
+	prediction.max_trigger_rate = trigger_period > 0 ? 1 / trigger_period : 0;
+	if(prediction.max_fps_bandwidth > 0)
+		prediction.max_trigger_rate = std::min(prediction.max_trigger_rate, prediction.max_fps_bandwidth);
+	prediction.min_trigger_period = prediction.max_trigger_rate > 0 ? 1 / prediction.max_trigger_rate : 0;
+
+	// Lima frame period is exposure + latency
+	prediction.min_lat_time = prediction.max_fps > 0 ? std::max(0., 1 / prediction.max_fps - exp_time) : 0;
+}
@@ -0,0 +1,281 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include "XimeaFrameStats.h"
+#include "XimeaSimd.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+namespace
+{
+	// pixels processed per block: min/max/sum and histogram passes both run
+	// on the same block so the second pass reads from L1
+	const int BLOCK_PIXELS = 4096;
+
+	template <typename T>
+	void _min_max_sum(const T* p, int n, uint32_t& mn, uint32_t& mx, uint64_t& sum)
+	{
+		T lmin = std::numeric_limits<T>::max();
+		T lmax = 0;
+		uint64_t s = 0;
+		for(int i = 0; i < n; ++i)
+		{
+			T v = p[i];
+			lmin = v < lmin ? v : lmin;
+			lmax = v > lmax ? v : lmax;
+			s += v;
+		}
+		mn = std::min<uint32_t>(mn, lmin);
+		mx = std::max<uint32_t>(mx, lmax);
+		sum += s;
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	XIMEA_TARGET_AVX2 void _min_max_sum_avx2(const uint8_t* p, int n, uint32_t& mn, uint32_t& mx, uint64_t& sum)
+	{
+		__m256i vmin = _mm256_set1_epi8((char)0xff);
+		__m256i vmax = _mm256_setzero_si256();
+		__m256i vsum = _mm256_setzero_si256();
+		const __m256i zero = _mm256_setzero_si256();
+
+		int i = 0;
+		for(; i + 32 <= n; i += 32)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+			vmin = _mm256_min_epu8(vmin, v);
+			vmax = _mm256_max_epu8(vmax, v);
+			vsum = _mm256_add_epi64(vsum, _mm256_sad_epu8(v, zero));
+		}
+
+		uint8_t lmin[32], lmax[32];
+		uint64_t lsum[4];
+		_mm256_storeu_si256((__m256i*)lmin, vmin);
+		_mm256_storeu_si256((__m256i*)lmax, vmax);
+		_mm256_storeu_si256((__m256i*)lsum, vsum);
+		for(int k = 0; k < 32; ++k)
+		{
+			mn = std::min<uint32_t>(mn, lmin[k]);
+			mx = std::max<uint32_t>(mx, lmax[k]);
+		}
+		sum += lsum[0] + lsum[1] + lsum[2] + lsum[3];
+
+		if(i < n)
+			_min_max_sum(p + i, n - i, mn, mx, sum);
+	}
+
+	XIMEA_TARGET_AVX2 void _min_max_sum_avx2(const uint16_t* p, int n, uint32_t& mn, uint32_t& mx, uint64_t& sum)
+	{
+		// the sum uses madd on values biased to signed 16 bits; with at most
+		// BLOCK_PIXELS pixels per call the 32 bit lanes cannot overflow
+		__m256i vmin = _mm256_set1_epi16((short)0xffff);
+		__m256i vmax = _mm256_setzero_si256();
+		__m256i vsum = _mm256_setzero_si256();
+		const __m256i bias = _mm256_set1_epi16((short)0x8000);
+		const __m256i ones = _mm256_set1_epi16(1);
+
+		int i = 0;
+		for(; i + 16 <= n; i += 16)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+			vmin = _mm256_min_epu16(vmin, v);
+			vmax = _mm256_max_epu16(vmax, v);
+			vsum = _mm256_add_epi32(vsum, _mm256_madd_epi16(_mm256_xor_si256(v, bias), ones));
+		}
+
+		uint16_t lmin[16], lmax[16];
+		int32_t lsum[8];
+		_mm256_storeu_si256((__m256i*)lmin, vmin);
+		_mm256_storeu_si256((__m256i*)lmax, vmax);
+		_mm256_storeu_si256((__m256i*)lsum, vsum);
+		int64_t s = int64_t(i) * 0x8000;
+		for(int k = 0; k < 16; ++k)
+		{
+			mn = std::min<uint32_t>(mn, lmin[k]);
+			mx = std::max<uint32_t>(mx, lmax[k]);
+		}
+		for(int k = 0; k < 8; ++k)
+			s += lsum[k];
+		sum += uint64_t(s);
+
+		if(i < n)
+			_min_max_sum(p + i, n - i, mn, mx, sum);
+	}
+#endif
+
+	template <typename T>
+	inline void _block_min_max_sum(const T* p, int n, uint32_t& mn, uint32_t& mx, uint64_t& sum)
+	{
+		_min_max_sum(p, n, mn, mx, sum);
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	template <>
+	inline void _block_min_max_sum<uint8_t>(const uint8_t* p, int n, uint32_t& mn, uint32_t& mx, uint64_t& sum)
+	{
+		if(Simd::hasAvx2())
+			_min_max_sum_avx2(p, n, mn, mx, sum);
+		else
+			_min_max_sum(p, n, mn, mx, sum);
+	}
+
+	template <>
+	inline void _block_min_max_sum<uint16_t>(const uint16_t* p, int n, uint32_t& mn, uint32_t& mx, uint64_t& sum)
+	{
+		if(Simd::hasAvx2())
+			_min_max_sum_avx2(p, n, mn, mx, sum);
+		else
+			_min_max_sum(p, n, mn, mx, sum);
+	}
+#endif
+
+	// four interleaved sub-histograms avoid store-to-load stalls on
+	// runs of identical pixel values
+	template <typename T>
+	inline void _block_histogram(const T* p, int n, int shift, unsigned int (*h)[FrameStats::HISTOGRAM_BINS])
+	{
+		const uint32_t last = FrameStats::HISTOGRAM_BINS - 1;
+		int i = 0;
+		for(; i + 4 <= n; i += 4)
+		{
+			uint32_t b0 = std::min<uint32_t>(uint32_t(p[i]) >> shift, last);
+			uint32_t b1 = std::min<uint32_t>(uint32_t(p[i + 1]) >> shift, last);
+			uint32_t b2 = std::min<uint32_t>(uint32_t(p[i + 2]) >> shift, last);
+			uint32_t b3 = std::min<uint32_t>(uint32_t(p[i + 3]) >> shift, last);
+			++h[0][b0];
+			++h[1][b1];
+			++h[2][b2];
+			++h[3][b3];
+		}
+		for(; i < n; ++i)
+			++h[0][std::min<uint32_t>(uint32_t(p[i]) >> shift, last)];
+	}
+} // namespace
+
+void FrameStats::reset()
+{
+	this->min = 0;
+	this->max = 0;
+	this->sum = 0;
+	this->mean = 0;
+	this->nb_pixels = 0;
+	memset(this->histogram, 0, sizeof(this->histogram));
+}
+
+template <typename T>
+void lima::Ximea::computeFrameStats(const T* data, int width, int height, size_t stride, int bit_depth, FrameStats& stats)
+{
+	stats.reset();
+	if(width <= 0 || height <= 0)
+		return;
+
+	int shift = std::max(0, bit_depth - 8);
+	uint32_t mn = std::numeric_limits<uint32_t>::max();
+	uint32_t mx = 0;
+	uint64_t sum = 0;
+	unsigned int h[4][FrameStats::HISTOGRAM_BINS];
+	memset(h, 0, sizeof(h));
+
+	const char* row = (const char*)data;
+	for(int y = 0; y < height; ++y, row += stride)
+	{
+		const T* p = (const T*)row;
+		for(int x = 0; x < width; x += BLOCK_PIXELS)
+		{
+			int n = std::min(BLOCK_PIXELS, width - x);
+			_block_min_max_sum(p + x, n, mn, mx, sum);
+			_block_histogram(p + x, n, shift, h);
+		}
+	}
+
+	stats.nb_pixels = uint64_t(width) * height;
+	stats.min = mn;
+	stats.max = mx;
+	stats.sum = double(sum);
+	stats.mean = stats.sum / stats.nb_pixels;
+	for(int b = 0; b < FrameStats::HISTOGRAM_BINS; ++b)
+		stats.histogram[b] = h[0][b] + h[1][b] + h[2][b] + h[3][b];
+}
+
+template void lima::Ximea::computeFrameStats<uint8_t>(const uint8_t*, int, int, size_t, int, FrameStats&);
+template void lima::Ximea::computeFrameStats<uint16_t>(const uint16_t*, int, int, size_t, int, FrameStats&);
+template void lima::Ximea::computeFrameStats<uint32_t>(const uint32_t*, int, int, size_t, int, FrameStats&);
+
+RollingStats::RollingStats(int window) : m_window(std::max(1, window))
+{
+}
+
+void RollingStats::setWindow(int window)
+{
+	this->m_window = std::max(1, window);
+	while(int(this->m_entries.size()) > this->m_window)
+		this->m_entries.pop_front();
+}
+
+void RollingStats::push(const FrameStats& stats)
+{
+	Entry e = {stats.min, stats.max, stats.mean};
+	this->m_entries.push_back(e);
+	if(int(this->m_entries.size()) > this->m_window)
+		this->m_entries.pop_front();
+}
+
+void RollingStats::clear()
+{
+	this->m_entries.clear();
+}
+
+double RollingStats::getMin() const
+{
+	if(this->m_entries.empty())
+		return 0;
+	double r = this->m_entries.front().min;
+	for(std::deque<Entry>::const_iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it)
+		r = std::min(r, it->min);
+	return r;
+}
+
+double RollingStats::getMax() const
+{
+	if(this->m_entries.empty())
+		return 0;
+	double r = this->m_entries.front().max;
+	for(std::deque<Entry>::const_iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it)
+		r = std::max(r, it->max);
+	return r;
+}
+
+double RollingStats::getMean() const
+{
+	if(this->m_entries.empty())
+		return 0;
+	double r = 0;
+	for(std::deque<Entry>::const_iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it)
+		r += it->mean;
+	return r / this->m_entries.size();
+}
@@ -0,0 +1,238 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cmath>
+#include <limits>
+
+#include "XimeaHdrMerge.h"
+#include "XimeaSimd.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+// part of the knee over which both channels are blended
+#define HDR_BLEND_FRACTION	0.05
+
+// the gain ratio fit uses high gain levels above this part of the knee
+#define HDR_FIT_MIN_LEVEL	0.1
+#define HDR_FIT_MIN_PIXELS	1000
+
+HdrCalibration::HdrCalibration()
+	: gain_ratio(0),
+	  knee(0),
+	  hg_black(0),
+	  lg_black(0)
+{
+}
+
+bool lima::Ximea::fitHdrGainRatio(const uint16_t* hg, const uint16_t* lg, int width, int height,
+	size_t stride, HdrCalibration& calib)
+{
+	double min_level = HDR_FIT_MIN_LEVEL * calib.knee;
+	double hl = 0, ll = 0;
+	long nb_pixels = 0;
+	for(int y = 0; y < height; ++y)
+	{
+		const uint16_t* h_row = (const uint16_t*)((const char*)hg + y * stride);
+		const uint16_t* l_row = (const uint16_t*)((const char*)lg + y * stride);
+		for(int x = 0; x < width; ++x)
+		{
+			double h = h_row[x] - calib.hg_black;
+			double l = l_row[x] - calib.lg_black;
+			if(h < min_level || h > calib.knee || l <= 0)
+				continue;
+			hl += h * l;
+			ll += l * l;
+			++nb_pixels;
+		}
+	}
+	if(nb_pixels < HDR_FIT_MIN_PIXELS)
+		return false;
+	calib.gain_ratio = hl / ll;
+	return true;
+}
+
+namespace
+{
+	struct MergeParams
+	{
+		float hg_black;
+		float lg_black;
+		float ratio;
+		float blend_start;
+		float inv_blend;
+		float max_val;
+
+		MergeParams(const HdrCalibration& calib, float max)
+		{
+			double blend = HDR_BLEND_FRACTION * calib.knee;
+			this->hg_black = float(calib.hg_black);
+			this->lg_black = float(calib.lg_black);
+			this->ratio = float(calib.gain_ratio);
+			this->blend_start = float(calib.knee - blend);
+			this->inv_blend = float(1 / blend);
+			this->max_val = max;
+		}
+	};
+
+	template <typename T>
+	void _merge_row(T* dst, const uint16_t* hg, const uint16_t* lg, int n, const MergeParams& p)
+	{
+		for(int i = 0; i < n; ++i)
+		{
+			float h = hg[i] - p.hg_black;
+			float l = (lg[i] - p.lg_black) * p.ratio;
+			float w = (h - p.blend_start) * p.inv_blend;
+			w = w < 0 ? 0 : (w > 1 ? 1 : w);
+			float v = h + w * (l - h);
+			v = v < 0 ? 0 : (v > p.max_val ? p.max_val : v);
+			dst[i] = T(v + 0.5f);
+		}
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	XIMEA_TARGET_AVX2 inline __m256i _merge_8_avx2(__m128i hg, __m128i lg, const MergeParams& p)
+	{
+		__m256 h = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(hg)), _mm256_set1_ps(p.hg_black));
+		__m256 l = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(lg)), _mm256_set1_ps(p.lg_black));
+		l = _mm256_mul_ps(l, _mm256_set1_ps(p.ratio));
+		__m256 w = _mm256_mul_ps(_mm256_sub_ps(h, _mm256_set1_ps(p.blend_start)), _mm256_set1_ps(p.inv_blend));
+		w = _mm256_min_ps(_mm256_max_ps(w, _mm256_setzero_ps()), _mm256_set1_ps(1.f));
+		__m256 v = _mm256_add_ps(h, _mm256_mul_ps(w, _mm256_sub_ps(l, h)));
+		v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(p.max_val));
+		// same half up rounding as the scalar row, not round to even
+		return _mm256_cvttps_epi32(_mm256_add_ps(v, _mm256_set1_ps(0.5f)));
+	}
+
+	XIMEA_TARGET_AVX2 void _merge_row_avx2(uint16_t* dst, const uint16_t* hg, const uint16_t* lg, int n, const MergeParams& p)
+	{
+		int i = 0;
+		for(; i + 16 <= n; i += 16)
+		{
+			__m256i h = _mm256_loadu_si256((const __m256i*)(hg + i));
+			__m256i l = _mm256_loadu_si256((const __m256i*)(lg + i));
+			__m256i r0 = _merge_8_avx2(_mm256_castsi256_si128(h), _mm256_castsi256_si128(l), p);
+			__m256i r1 = _merge_8_avx2(_mm256_extracti128_si256(h, 1), _mm256_extracti128_si256(l, 1), p);
+			// packus works per 128 bit lane, restore pixel order
+			__m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi32(r0, r1), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256((__m256i*)(dst + i), r);
+		}
+		_merge_row(dst + i, hg + i, lg + i, n - i, p);
+	}
+
+	XIMEA_TARGET_AVX2 void _merge_row_avx2(uint32_t* dst, const uint16_t* hg, const uint16_t* lg, int n, const MergeParams& p)
+	{
+		int i = 0;
+		for(; i + 8 <= n; i += 8)
+		{
+			__m128i h = _mm_loadu_si128((const __m128i*)(hg + i));
+			__m128i l = _mm_loadu_si128((const __m128i*)(lg + i));
+			_mm256_storeu_si256((__m256i*)(dst + i), _merge_8_avx2(h, l, p));
+		}
+		_merge_row(dst + i, hg + i, lg + i, n - i, p);
+	}
+#endif
+
+	template <typename T>
+	void _merge(T* dst, const uint16_t* hg, const uint16_t* lg, int n, const MergeParams& p)
+	{
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+		if(Simd::hasAvx2())
+		{
+			_merge_row_avx2(dst, hg, lg, n, p);
+			return;
+		}
+#endif
+		_merge_row(dst, hg, lg, n, p);
+	}
+
+	class MergeTask : public StripeWorkers::Task
+	{
+	public:
+		MergeTask(void* dst, int dst_pixel_size, const uint16_t* hg, const uint16_t* lg, int width, size_t stride,
+			const MergeParams& params)
+			: m_dst((char*)dst), m_dst_pixel_size(dst_pixel_size), m_hg((const char*)hg), m_lg((const char*)lg),
+			  m_width(width), m_stride(stride), m_params(params)
+		{
+		}
+
+		virtual void process(int first_row, int last_row)
+		{
+			for(int y = first_row; y < last_row; ++y)
+			{
+				char* dst = this->m_dst + size_t(y) * this->m_width * this->m_dst_pixel_size;
+				const uint16_t* hg = (const uint16_t*)(this->m_hg + y * this->m_stride);
+				const uint16_t* lg = (const uint16_t*)(this->m_lg + y * this->m_stride);
+				if(this->m_dst_pixel_size == 2)
+					_merge((uint16_t*)dst, hg, lg, this->m_width, this->m_params);
+				else
+					_merge((uint32_t*)dst, hg, lg, this->m_width, this->m_params);
+			}
+		}
+
+	private:
+		char* m_dst;
+		int m_dst_pixel_size;
+		const char* m_hg;
+		const char* m_lg;
+		int m_width;
+		size_t m_stride;
+		MergeParams m_params;
+	};
+} // namespace
+
+void lima::Ximea::mergeHdr(void* dst, int dst_pixel_size, const uint16_t* hg, const uint16_t* lg,
+	int width, int height, size_t stride, const HdrCalibration& calib, StripeWorkers& workers)
+{
+	// largest float converting to a signed 32 bit integer
+	MergeParams params(calib, dst_pixel_size == 2 ? 65535.f : 2147483520.f);
+	MergeTask task(dst, dst_pixel_size, hg, lg, width, stride, params);
+	workers.run(task, height);
+}
+
+HdrCalibrationCache::HdrCalibrationCache()
+	: m_temp_step(2.0)
+{
+}
+
+HdrCalibrationCache::Key HdrCalibrationCache::_key(int mode, double temperature) const
+{
+	// unknown temperature gets a step of its own
+	int step = std::isnan(temperature) ? std::numeric_limits<int>::min() : int(floor(temperature / this->m_temp_step + 0.5));
+	return Key(mode, step);
+}
+
+bool HdrCalibrationCache::lookup(int mode, double temperature, HdrCalibration& calib) const
+{
+	std::map<Key, HdrCalibration>::const_iterator it = this->m_entries.find(this->_key(mode, temperature));
+	if(it == this->m_entries.end())
+		return false;
+	calib = it->second;
+	return true;
+}
+
+void HdrCalibrationCache::store(int mode, double temperature, const HdrCalibration& calib)
+{
+	this->m_entries[this->_key(mode, temperature)] = calib;
+}
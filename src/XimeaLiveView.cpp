@@ -0,0 +1,291 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <stdint.h>
+
+#include "lima/Exceptions.h"
+#include "XimeaLiveView.h"
+#include "XimeaSimd.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+namespace
+{
+	template <typename S, typename D>
+	void _convert_row(const S* src, D* dst, int n, int shift)
+	{
+		const uint64_t max_val = std::numeric_limits<D>::max();
+		for(int i = 0; i < n; ++i)
+			dst[i] = D(std::min(max_val, uint64_t(src[i]) >> shift));
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	XIMEA_TARGET_AVX2 void _convert_row_avx2(const uint16_t* src, uint8_t* dst, int n, int shift)
+	{
+		const __m128i count = _mm_cvtsi32_si128(shift);
+		const __m256i max_val = _mm256_set1_epi16(255);
+		int i = 0;
+		for(; i + 32 <= n; i += 32)
+		{
+			__m256i a = _mm256_srl_epi16(_mm256_loadu_si256((const __m256i*)(src + i)), count);
+			__m256i b = _mm256_srl_epi16(_mm256_loadu_si256((const __m256i*)(src + i + 16)), count);
+			// packus is signed: clamp first
+			a = _mm256_min_epu16(a, max_val);
+			b = _mm256_min_epu16(b, max_val);
+			__m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256((__m256i*)(dst + i), r);
+		}
+		_convert_row(src + i, dst + i, n - i, shift);
+	}
+
+	XIMEA_TARGET_AVX2 void _convert_row_avx2(const uint32_t* src, uint8_t* dst, int n, int shift)
+	{
+		const __m128i count = _mm_cvtsi32_si128(shift);
+		const __m256i max_val = _mm256_set1_epi32(255);
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		int i = 0;
+		for(; i + 32 <= n; i += 32)
+		{
+			__m256i v[4];
+			for(int k = 0; k < 4; ++k)
+			{
+				v[k] = _mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)(src + i + 8 * k)), count);
+				v[k] = _mm256_min_epu32(v[k], max_val);
+			}
+			__m256i r = _mm256_packus_epi16(_mm256_packus_epi32(v[0], v[1]), _mm256_packus_epi32(v[2], v[3]));
+			_mm256_storeu_si256((__m256i*)(dst + i), _mm256_permutevar8x32_epi32(r, order));
+		}
+		_convert_row(src + i, dst + i, n - i, shift);
+	}
+#endif
+
+	template <typename S>
+	void _convert_row_8bit(const S* src, uint8_t* dst, int n, int shift)
+	{
+		_convert_row(src, dst, n, shift);
+	}
+
+#ifdef XIMEA_HAVE_AVX2_KERNELS
+	template <>
+	void _convert_row_8bit<uint16_t>(const uint16_t* src, uint8_t* dst, int n, int shift)
+	{
+		if(Simd::hasAvx2())
+			_convert_row_avx2(src, dst, n, shift);
+		else
+			_convert_row(src, dst, n, shift);
+	}
+
+	template <>
+	void _convert_row_8bit<uint32_t>(const uint32_t* src, uint8_t* dst, int n, int shift)
+	{
+		if(Simd::hasAvx2())
+			_convert_row_avx2(src, dst, n, shift);
+		else
+			_convert_row(src, dst, n, shift);
+	}
+#endif
+
+	// full resolution: plain copy or 8 bit conversion
+	template <typename S>
+	void _copy_frame(const char* data, size_t stride, int width, int height, char* out, bool convert_8bit, int shift)
+	{
+		for(int y = 0; y < height; ++y)
+		{
+			const S* src = (const S*)(data + y * stride);
+			if(convert_8bit)
+				_convert_row_8bit(src, (uint8_t*)out + size_t(y) * width, width, shift);
+			else
+				memcpy(out + size_t(y) * width * sizeof(S), src, width * sizeof(S));
+		}
+	}
+
+	// box average over f x f blocks, log2_f = log2(f)
+	template <typename S, typename D>
+	void _downscale_frame(const char* data, size_t stride, int f, int log2_f, int out_width, int out_height,
+		D* out, int shift, std::vector<uint64_t>& acc)
+	{
+		acc.resize(out_width);
+		for(int y = 0; y < out_height; ++y)
+		{
+			std::fill(acc.begin(), acc.end(), 0);
+			for(int j = 0; j < f; ++j)
+			{
+				const S* src = (const S*)(data + (size_t(y) * f + j) * stride);
+				for(int x = 0; x < out_width; ++x)
+					for(int i = 0; i < f; ++i)
+						acc[x] += src[x * f + i];
+			}
+			_convert_row(&acc[0], out + size_t(y) * out_width, out_width, 2 * log2_f + shift);
+		}
+	}
+
+	template <typename S>
+	void _downscale_frame(const char* data, size_t stride, int f, int log2_f, int out_width, int out_height,
+		char* out, bool convert_8bit, int shift, std::vector<uint64_t>& acc)
+	{
+		if(convert_8bit)
+			_downscale_frame<S, uint8_t>(data, stride, f, log2_f, out_width, out_height, (uint8_t*)out, shift, acc);
+		else
+			_downscale_frame<S, S>(data, stride, f, log2_f, out_width, out_height, (S*)out, 0, acc);
+	}
+} // namespace
+
+LiveView::LiveView()
+	: m_mode(Off),
+	  m_decimation(50),
+	  m_rate(10),
+	  m_downscale(1),
+	  m_convert_8bit(true),
+	  m_bit_depth(8),
+	  m_back(0),
+	  m_front(1),
+	  m_reader(2),
+	  m_fresh(false)
+{
+}
+
+void LiveView::setDecimation(int n)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(n < 1)
+		THROW_HW_ERROR(InvalidValue) << "Live view decimation must be at least 1";
+	this->m_decimation = n;
+}
+
+void LiveView::setRate(double rate)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(rate <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Live view rate must be positive";
+	this->m_rate = rate;
+}
+
+void LiveView::setDownscale(int downscale)
+{
+	DEB_MEMBER_FUNCT();
+
+	if(downscale < 1 || downscale > 16 || (downscale & (downscale - 1)))
+		THROW_HW_ERROR(InvalidValue) << "Live view downscale must be a power of two up to 16";
+	this->m_downscale = downscale;
+}
+
+void LiveView::reset(int bit_depth)
+{
+	AutoMutex reader_lock(this->m_reader_mutex);
+	AutoMutex swap_lock(this->m_swap_mutex);
+	this->m_bit_depth = bit_depth;
+	this->m_last_publish = Timestamp();
+	for(int i = 0; i < 3; ++i)
+		this->m_frames[i].frame_nb = -1;
+	this->m_fresh = false;
+}
+
+bool LiveView::isDue(int frame_nb)
+{
+	switch(this->m_mode)
+	{
+		case EveryNth:
+			return frame_nb % this->m_decimation == 0;
+		case FixedRate:
+			return !this->m_last_publish.isSet() || double(Timestamp::now() - this->m_last_publish) >= 1 / this->m_rate;
+		default:
+			return false;
+	}
+}
+
+void LiveView::publish(const void* data, int pixel_size, int width, int height, size_t stride, int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+
+	this->m_last_publish = Timestamp::now();
+
+	// the back buffer belongs to the grab thread, no lock needed to fill it
+	Frame& frame = this->m_frames[this->m_back];
+	int f = this->m_downscale;
+	int log2_f = 0;
+	while((1 << log2_f) < f)
+		++log2_f;
+	frame.frame_nb = frame_nb;
+	frame.width = width / f;
+	frame.height = height / f;
+	frame.depth = this->m_convert_8bit ? 1 : pixel_size;
+	frame.data.resize(size_t(frame.width) * frame.height * frame.depth);
+
+	int shift = this->m_convert_8bit ? std::max(0, this->m_bit_depth - 8) : 0;
+	const char* src = (const char*)data;
+	char* out = &frame.data[0];
+	switch(pixel_size)
+	{
+		case 1:
+			if(f == 1)
+				_copy_frame<uint8_t>(src, stride, width, height, out, this->m_convert_8bit, shift);
+			else
+				_downscale_frame<uint8_t>(src, stride, f, log2_f, frame.width, frame.height, out, this->m_convert_8bit, shift, this->m_acc);
+			break;
+		case 2:
+			if(f == 1)
+				_copy_frame<uint16_t>(src, stride, width, height, out, this->m_convert_8bit, shift);
+			else
+				_downscale_frame<uint16_t>(src, stride, f, log2_f, frame.width, frame.height, out, this->m_convert_8bit, shift, this->m_acc);
+			break;
+		case 4:
+			if(f == 1)
+				_copy_frame<uint32_t>(src, stride, width, height, out, this->m_convert_8bit, shift);
+			else
+				_downscale_frame<uint32_t>(src, stride, f, log2_f, frame.width, frame.height, out, this->m_convert_8bit, shift, this->m_acc);
+			break;
+		default:
+			return;
+	}
+
+	AutoMutex lock(this->m_swap_mutex);
+	std::swap(this->m_back, this->m_front);
+	this->m_fresh = true;
+}
+
+bool LiveView::getLatest(Frame& frame)
+{
+	AutoMutex reader_lock(this->m_reader_mutex);
+	{
+		AutoMutex swap_lock(this->m_swap_mutex);
+		if(this->m_fresh)
+		{
+			std::swap(this->m_reader, this->m_front);
+			this->m_fresh = false;
+		}
+	}
+
+	const Frame& latest = this->m_frames[this->m_reader];
+	if(latest.frame_nb < 0)
+		return false;
+	frame = latest;
+	return true;
+}
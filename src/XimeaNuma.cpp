@@ -0,0 +1,208 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "XimeaNuma.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+// from <numaif.h>, not to depend on libnuma
+#define XIMEA_MPOL_DEFAULT	0
+#define XIMEA_MPOL_PREFERRED	1
+#define XIMEA_MPOL_F_NODE	(1 << 0)
+#define XIMEA_MPOL_F_ADDR	(1 << 1)
+#define XIMEA_MPOL_MF_MOVE	(1 << 1)
+
+#define MAX_NODES	1024
+
+namespace
+{
+	typedef unsigned long NodeMask[MAX_NODES / (8 * sizeof(unsigned long))];
+
+	bool _read_line(const std::string& path, std::string& line)
+	{
+		std::ifstream f(path.c_str());
+		return std::getline(f, line) && !line.empty();
+	}
+
+	// "0-3,8-11" style lists, calls f on each number
+	template <typename F>
+	bool _parse_list(const std::string& list, F f)
+	{
+		const char* p = list.c_str();
+		while(*p)
+		{
+			int first, last, n;
+			if(sscanf(p, "%d-%d%n", &first, &last, &n) == 2)
+				;
+			else if(sscanf(p, "%d%n", &first, &n) == 1)
+				last = first;
+			else
+				return false;
+			for(int i = first; i <= last; ++i)
+				f(i);
+			p += n;
+			if(*p == ',')
+				++p;
+			else if(*p && !isspace(*p))
+				return false;
+			else
+				break;
+		}
+		return true;
+	}
+
+	struct _MaxOf
+	{
+		int& max;
+		_MaxOf(int& m) : max(m) {}
+		void operator()(int i) { max = i > max ? i : max; }
+	};
+
+	struct _AddCpu
+	{
+		cpu_set_t& cpus;
+		_AddCpu(cpu_set_t& c) : cpus(c) {}
+		void operator()(int i) { if(i < CPU_SETSIZE) CPU_SET(i, &cpus); }
+	};
+
+	// PCI address "dddd:bb:dd.f" at s
+	bool _is_pci_address(const char* s)
+	{
+		static const char pattern[] = "xxxx:xx:xx.x";
+		for(int i = 0; pattern[i]; ++i)
+			if(pattern[i] == 'x' ? !isxdigit(s[i]) : s[i] != pattern[i])
+				return false;
+		return true;
+	}
+} // namespace
+
+int Numa::getNbNodes()
+{
+	std::string online;
+	int max_node = -1;
+	if(!_read_line("/sys/devices/system/node/online", online) || !_parse_list(online, _MaxOf(max_node)))
+		return 1;
+	return max_node + 1;
+}
+
+int Numa::getDeviceNode(const std::string& device_path)
+{
+	// the last address is the device itself, the others are bridges
+	std::string address;
+	for(size_t i = 0; i + 12 <= device_path.size(); ++i)
+		if(_is_pci_address(device_path.c_str() + i))
+			address = device_path.substr(i, 12);
+	if(address.empty())
+		return -1;
+
+	std::string node;
+	if(!_read_line("/sys/bus/pci/devices/" + address + "/numa_node", node))
+		return -1;
+	return atoi(node.c_str());
+}
+
+int Numa::getCurrentNode()
+{
+	unsigned cpu, node;
+	if(syscall(SYS_getcpu, &cpu, &node, NULL))
+		return -1;
+	return int(node);
+}
+
+int Numa::getMemoryNode(const void* addr)
+{
+	int node;
+	if(!addr || syscall(SYS_get_mempolicy, &node, NULL, 0, addr, XIMEA_MPOL_F_NODE | XIMEA_MPOL_F_ADDR))
+		return -1;
+	return node;
+}
+
+bool Numa::bindThread(int node)
+{
+	if(node < 0)
+		return false;
+
+	std::string list;
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	if(!_read_line(path, list) || !_parse_list(list, _AddCpu(cpus)) || !CPU_COUNT(&cpus))
+		return false;
+	return !pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+bool Numa::bindMemory(void* addr, size_t size, int node)
+{
+	if(node < 0 || node >= MAX_NODES || !addr)
+		return false;
+
+	NodeMask mask = {0};
+	int bits = 8 * sizeof(unsigned long);
+	mask[node / bits] = 1UL << (node % bits);
+	// the kernel wants one more than the number of bits
+	return !syscall(SYS_mbind, addr, size, XIMEA_MPOL_PREFERRED, mask, MAX_NODES + 1, XIMEA_MPOL_MF_MOVE);
+}
+
+Numa::PreferredNode::PreferredNode(int node)
+	: m_set(false),
+	  m_old_mode(XIMEA_MPOL_DEFAULT),
+	  m_old_mask(sizeof(NodeMask) / sizeof(unsigned long))
+{
+	DEB_CONSTRUCTOR();
+
+	if(node < 0 || node >= MAX_NODES)
+		return;
+
+	// the caller may run under a policy of its own
+	if(syscall(SYS_get_mempolicy, &this->m_old_mode, &this->m_old_mask[0], MAX_NODES + 1, NULL, 0))
+	{
+		DEB_WARNING() << "Could not read the memory policy, not preferring NUMA node " << node;
+		return;
+	}
+
+	NodeMask mask = {0};
+	int bits = 8 * sizeof(unsigned long);
+	mask[node / bits] = 1UL << (node % bits);
+	this->m_set = !syscall(SYS_set_mempolicy, XIMEA_MPOL_PREFERRED, mask, MAX_NODES + 1);
+	if(!this->m_set)
+		DEB_WARNING() << "Could not prefer NUMA node " << node;
+}
+
+Numa::PreferredNode::~PreferredNode()
+{
+	if(this->m_set)
+		syscall(SYS_set_mempolicy, this->m_old_mode, &this->m_old_mask[0], MAX_NODES + 1);
+}
@@ -0,0 +1,122 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "lima/Exceptions.h"
+#include "XimeaProfile.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+using namespace std;
+
+// floating point values read back from the camera are quantised
+#define VALUE_REL_TOLERANCE	1e-4
+
+void Profile::set(const string& name, const string& value)
+{
+	for(Values::iterator it = this->m_values.begin(); it != this->m_values.end(); ++it)
+		if(it->first == name)
+		{
+			it->second = value;
+			return;
+		}
+	this->m_values.push_back(make_pair(name, value));
+}
+
+bool Profile::get(const string& name, string& value) const
+{
+	for(Values::const_iterator it = this->m_values.begin(); it != this->m_values.end(); ++it)
+		if(it->first == name)
+		{
+			value = it->second;
+			return true;
+		}
+	return false;
+}
+
+void Profile::load(const string& path)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(path);
+
+	ifstream f(path.c_str());
+	if(!f)
+		THROW_HW_ERROR(Error) << "Could not open profile " << path;
+
+	this->m_values.clear();
+	string line;
+	while(getline(f, line))
+	{
+		if(line.empty() || line[0] == '#')
+			continue;
+		size_t sep = line.find(' ');
+		if(sep == string::npos || sep == 0)
+		{
+			DEB_WARNING() << "Ignoring malformed profile line: " << line;
+			continue;
+		}
+		this->set(line.substr(0, sep), line.substr(sep + 1));
+	}
+	DEB_TRACE() << this->m_values.size() << " settings in " << path;
+}
+
+void Profile::save(const string& path, const string& comment) const
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(path);
+
+	ofstream f(path.c_str());
+	if(!f)
+		THROW_HW_ERROR(Error) << "Could not write profile " << path;
+
+	if(!comment.empty())
+		f << "# " << comment << "\n";
+	for(Values::const_iterator it = this->m_values.begin(); it != this->m_values.end(); ++it)
+		f << it->first << " " << it->second << "\n";
+	if(!f)
+		THROW_HW_ERROR(Error) << "Could not write profile " << path;
+}
+
+bool Profile::sameValue(const string& a, const string& b)
+{
+	if(a == b)
+		return true;
+
+	// same count of numbers, pairwise close
+	istringstream ia(a), ib(b);
+	double va, vb;
+	while(ia >> va)
+	{
+		if(!(ib >> vb))
+			return false;
+		if(fabs(va - vb) > VALUE_REL_TOLERANCE * max(fabs(va), fabs(vb)))
+			return false;
+	}
+	return ia.eof() && !(ib >> vb) && ib.eof();
+}
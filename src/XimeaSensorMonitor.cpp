@@ -0,0 +1,191 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "XimeaSensorMonitor.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+// niceness of the monitor thread, below the acquisition
+#define MONITOR_NICE	10
+
+SensorSnapshot::SensorSnapshot()
+	: timestamp(0),
+	  temperature(0),
+	  temp_chip(0),
+	  temp_housing(0),
+	  temp_back(0),
+	  temp_sensor(0),
+	  acq_status(false),
+	  counter_value(0)
+{
+}
+
+SensorMonitor::SensorMonitor(Sampler& sampler)
+	: m_sampler(sampler),
+	  m_thread(NULL),
+	  m_quit(false),
+	  m_wake(false),
+	  m_rate(1.0),
+	  m_history_size(3600),
+	  m_valid(false)
+{
+}
+
+SensorMonitor::~SensorMonitor()
+{
+	this->stop();
+}
+
+void SensorMonitor::start()
+{
+	DEB_MEMBER_FUNCT();
+
+	if(this->m_thread)
+		return;
+	{
+		AutoMutex lock(this->m_cond.mutex());
+		this->m_quit = false;
+		this->m_valid = false;
+	}
+	this->m_thread = new MonitorThread(*this);
+	this->m_thread->start();
+}
+
+void SensorMonitor::stop()
+{
+	DEB_MEMBER_FUNCT();
+
+	if(!this->m_thread)
+		return;
+	{
+		AutoMutex lock(this->m_cond.mutex());
+		this->m_quit = true;
+		this->m_cond.broadcast();
+	}
+	// joins the thread
+	delete this->m_thread;
+	this->m_thread = NULL;
+
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_valid = false;
+}
+
+void SensorMonitor::setRate(double rate)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(rate);
+
+	if(rate <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Monitor rate must be positive";
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_rate = rate;
+	this->m_wake = true;
+	this->m_cond.broadcast();
+}
+
+void SensorMonitor::setHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(size);
+
+	if(size < 0)
+		THROW_HW_ERROR(InvalidValue) << "History size must be positive";
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_history_size = size;
+	while(int(this->m_history.size()) > size)
+		this->m_history.pop_front();
+}
+
+bool SensorMonitor::getSnapshot(SensorSnapshot& snapshot)
+{
+	AutoMutex lock(this->m_cond.mutex());
+	if(this->m_valid)
+		snapshot = this->m_snapshot;
+	return this->m_valid;
+}
+
+void SensorMonitor::getHistory(std::vector<SensorSnapshot>& history)
+{
+	AutoMutex lock(this->m_cond.mutex());
+	history.assign(this->m_history.begin(), this->m_history.end());
+}
+
+void SensorMonitor::invalidate()
+{
+	AutoMutex lock(this->m_cond.mutex());
+	this->m_valid = false;
+	this->m_wake = true;
+	this->m_cond.broadcast();
+}
+
+void SensorMonitor::MonitorThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+
+	SensorMonitor& monitor = this->m_monitor;
+	setpriority(PRIO_PROCESS, syscall(SYS_gettid), MONITOR_NICE);
+
+	AutoMutex lock(monitor.m_cond.mutex());
+	while(!monitor.m_quit)
+	{
+		monitor.m_wake = false;
+		lock.unlock();
+
+		SensorSnapshot snapshot;
+		bool ok = false;
+		try
+		{
+			ok = monitor.m_sampler.sample(snapshot);
+		}
+		catch(Exception& e)
+		{
+			DEB_WARNING() << "Sensor sampling failed: " << e;
+		}
+		snapshot.timestamp = Timestamp::now();
+
+		lock.lock();
+		double next = snapshot.timestamp + 1.0 / monitor.m_rate;
+		// invalidated while sampling: values may predate the change
+		if(ok && !monitor.m_wake)
+		{
+			monitor.m_snapshot = snapshot;
+			monitor.m_valid = true;
+			monitor.m_history.push_back(snapshot);
+			while(int(monitor.m_history.size()) > monitor.m_history_size)
+				monitor.m_history.pop_front();
+		}
+
+		double now;
+		while(!monitor.m_quit && !monitor.m_wake && (now = Timestamp::now()) < next)
+			monitor.m_cond.wait(next - now);
+	}
+}
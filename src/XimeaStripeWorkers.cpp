@@ -0,0 +1,188 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <algorithm>
+
+#include "XimeaStripeWorkers.h"
+#include "XimeaNuma.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+// stripes per thread, more than one to even out uneven stripe costs
+#define STRIPES_PER_THREAD	4
+
+StripeWorkers::StripeWorkers(int nb_threads)
+	: m_nb_running(0),
+	  m_quit(false),
+	  m_generation(0),
+	  m_numa_node(-1),
+	  m_task(NULL),
+	  m_nb_rows(0),
+	  m_stripe_rows(0),
+	  m_next_row(0),
+	  m_nb_busy(0)
+{
+	this->setNbThreads(nb_threads);
+}
+
+StripeWorkers::~StripeWorkers()
+{
+	this->_stop_workers();
+}
+
+void StripeWorkers::setNbThreads(int nb_threads)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_threads);
+
+	nb_threads = std::max(1, nb_threads);
+	if(nb_threads == this->getNbThreads())
+		return;
+
+	this->_stop_workers();
+	this->_start_workers(nb_threads);
+}
+
+void StripeWorkers::setNumaNode(int node)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(node);
+
+	if(node == this->m_numa_node)
+		return;
+
+	// workers bind themselves when they start
+	int nb_threads = this->getNbThreads();
+	this->_stop_workers();
+	this->m_numa_node = node;
+	this->_start_workers(nb_threads);
+}
+
+void StripeWorkers::_start_workers(int nb_threads)
+{
+	this->m_quit = false;
+	for(int i = 1; i < nb_threads; ++i)
+	{
+		Worker* w = new Worker(*this);
+		{
+			AutoMutex lock(this->m_cond.mutex());
+			++this->m_nb_running;
+		}
+		this->m_workers.push_back(w);
+		w->start();
+	}
+}
+
+void StripeWorkers::_stop_workers()
+{
+	{
+		AutoMutex lock(this->m_cond.mutex());
+		this->m_quit = true;
+		this->m_cond.broadcast();
+		while(this->m_nb_running)
+			this->m_cond.wait();
+	}
+	for(std::vector<Worker*>::iterator it = this->m_workers.begin(); it != this->m_workers.end(); ++it)
+		delete *it;
+	this->m_workers.clear();
+}
+
+bool StripeWorkers::_next_stripe(int& first_row, int& last_row)
+{
+	AutoMutex lock(this->m_cond.mutex());
+	if(!this->m_task || this->m_next_row >= this->m_nb_rows)
+		return false;
+	first_row = this->m_next_row;
+	last_row = std::min(first_row + this->m_stripe_rows, this->m_nb_rows);
+	this->m_next_row = last_row;
+	return true;
+}
+
+void StripeWorkers::_process_stripes()
+{
+	// m_task cannot change while this thread is counted in m_nb_busy
+	Task* task = this->m_task;
+	int first_row, last_row;
+	while(this->_next_stripe(first_row, last_row))
+		task->process(first_row, last_row);
+}
+
+void StripeWorkers::run(Task& task, int nb_rows)
+{
+	if(this->m_workers.empty() || nb_rows < 2)
+	{
+		task.process(0, nb_rows);
+		return;
+	}
+
+	AutoMutex lock(this->m_cond.mutex());
+	int nb_stripes = this->getNbThreads() * STRIPES_PER_THREAD;
+	this->m_task = &task;
+	this->m_nb_rows = nb_rows;
+	this->m_stripe_rows = std::max(1, (nb_rows + nb_stripes - 1) / nb_stripes);
+	this->m_next_row = 0;
+	++this->m_generation;
+	++this->m_nb_busy;
+	this->m_cond.broadcast();
+	lock.unlock();
+
+	this->_process_stripes();
+
+	lock.lock();
+	--this->m_nb_busy;
+	while(this->m_nb_busy)
+		this->m_cond.wait();
+	this->m_task = NULL;
+}
+
+void StripeWorkers::Worker::threadFunction()
+{
+	StripeWorkers& pool = this->m_pool;
+	Numa::bindThread(pool.m_numa_node);
+
+	AutoMutex lock(pool.m_cond.mutex());
+	unsigned long generation = pool.m_generation;
+	while(!pool.m_quit)
+	{
+		if(pool.m_generation == generation)
+		{
+			pool.m_cond.wait();
+			continue;
+		}
+		generation = pool.m_generation;
+		if(!pool.m_task)
+			// woke up after the frame was already finished
+			continue;
+
+		++pool.m_nb_busy;
+		lock.unlock();
+		pool._process_stripes();
+		lock.lock();
+		--pool.m_nb_busy;
+		pool.m_cond.broadcast();
+	}
+	--pool.m_nb_running;
+	pool.m_cond.broadcast();
+}
@@ -101,9 +101,10 @@ void SyncCtrlObj::getValidRanges(ValidRangesType& valid_ranges)
 {
 	DEB_MEMBER_FUNCT();
 
-	// TODO: fill these example values with real ones
-	valid_ranges.min_exp_time = 0;
-	valid_ranges.max_exp_time = 10;
+	// latency is a software sleep between frames, see AcqThread: the
+	// camera puts no bound on it, its range is left as it was
+	this->m_cam.getExpTimeRange(valid_ranges.min_exp_time, valid_ranges.max_exp_time);
+	DEB_RETURN() << DEB_VAR2(valid_ranges.min_exp_time, valid_ranges.max_exp_time);
 }
 
 bool SyncCtrlObj::checkAutoExposureMode(HwSyncCtrlObj::AutoExposureMode mode) const
@@ -119,7 +120,6 @@ void SyncCtrlObj::setHwAutoExposureMode(HwSyncCtrlObj::AutoExposureMode mode)
 	DEB_MEMBER_FUNCT();
 	DEB_PARAM() << DEB_VAR1(mode);
 
-	this->m_cam._set_param_int(XI_PRM_AEAG,
-		mode == HwSyncCtrlObj::ON ? XI_ON : XI_OFF
-	);
+	// hardware AEAG or driver closed loop, see Camera::setAutoExposureEngine
+	this->m_cam.setAutoExposureMode(mode == HwSyncCtrlObj::ON);
 }
@@ -0,0 +1,183 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2020
+// European Synchrotron Radiation Facility
+// CS40220 38043 Grenoble Cedex 9
+// FRANCE
+//
+// Contact: lima@esrf.fr
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cmath>
+#include <algorithm>
+
+#include "lima/Exceptions.h"
+#include "XimeaTriggerDiag.h"
+
+using namespace lima;
+using namespace lima::Ximea;
+
+TriggerDiagStats::TriggerDiagStats()
+	: nb_frames(0),
+	  nb_latency(0),
+	  latency_min(0),
+	  latency_mean(0),
+	  latency_max(0),
+	  latency_jitter(0),
+	  latency_p50(0),
+	  latency_p99(0),
+	  readout_mean(0),
+	  readout_jitter(0),
+	  period_mean(0),
+	  period_jitter(0),
+	  level_start_active(0),
+	  level_end_active(0),
+	  missed_overlap(0),
+	  missed_buffer_full(0)
+{
+}
+
+void TriggerDiag::Moments::reset()
+{
+	this->n = 0;
+	this->mean = 0;
+	this->m2 = 0;
+	this->min = 0;
+	this->max = 0;
+}
+
+void TriggerDiag::Moments::add(double x)
+{
+	if(!this->n || x < this->min)
+		this->min = x;
+	if(!this->n || x > this->max)
+		this->max = x;
+	++this->n;
+	double d = x - this->mean;
+	this->mean += d / this->n;
+	this->m2 += d * (x - this->mean);
+}
+
+double TriggerDiag::Moments::stddev() const
+{
+	return this->n > 1 ? sqrt(this->m2 / (this->n - 1)) : 0;
+}
+
+TriggerDiag::TriggerDiag()
+	: m_bin_width(10e-6),
+	  m_histogram(HISTOGRAM_BINS, 0)
+{
+	this->reset();
+}
+
+void TriggerDiag::reset()
+{
+	AutoMutex lock(this->m_mutex);
+	std::fill(this->m_histogram.begin(), this->m_histogram.end(), 0);
+	this->m_latency.reset();
+	this->m_readout.reset();
+	this->m_period.reset();
+	this->m_nb_frames = 0;
+	this->m_level_start_active = 0;
+	this->m_level_end_active = 0;
+	this->m_last_camera_start = -1;
+}
+
+void TriggerDiag::setBinWidth(double width)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(width);
+
+	if(width <= 0)
+		THROW_HW_ERROR(InvalidValue) << "Histogram bin width must be positive";
+	AutoMutex lock(this->m_mutex);
+	this->m_bin_width = width;
+	// bins no longer mean the same, and the percentiles taken from them
+	// would not match the moments
+	std::fill(this->m_histogram.begin(), this->m_histogram.end(), 0);
+	this->m_latency.reset();
+}
+
+double TriggerDiag::getBinWidth()
+{
+	AutoMutex lock(this->m_mutex);
+	return this->m_bin_width;
+}
+
+void TriggerDiag::addFrame(double camera_start, double host_start, double exp_time, double trigger_delay,
+	double arrival, int level_start, int level_end)
+{
+	AutoMutex lock(this->m_mutex);
+	++this->m_nb_frames;
+	if(this->m_last_camera_start >= 0 && camera_start > this->m_last_camera_start)
+		this->m_period.add(camera_start - this->m_last_camera_start);
+	this->m_last_camera_start = camera_start;
+	if(level_start > 0)
+		++this->m_level_start_active;
+	if(level_end > 0)
+		++this->m_level_end_active;
+
+	if(std::isnan(host_start))
+		return;
+	double latency = arrival - (host_start - trigger_delay);
+	this->m_latency.add(latency);
+	this->m_readout.add(arrival - (host_start + exp_time));
+	// a negative latency is a clock sync error, counted in the first bin
+	int bin = std::max(0, int(std::min(latency / this->m_bin_width, double(HISTOGRAM_BINS - 1))));
+	++this->m_histogram[bin];
+}
+
+double TriggerDiag::_percentile(double p)
+{
+	if(!this->m_latency.n)
+		return 0;
+	int rank = int(ceil(p * this->m_latency.n));
+	int count = 0;
+	for(int i = 0; i < HISTOGRAM_BINS - 1; ++i)
+	{
+		count += this->m_histogram[i];
+		if(count >= rank)
+			return (i + 0.5) * this->m_bin_width;
+	}
+	// in the overflow bin
+	return this->m_latency.max;
+}
+
+void TriggerDiag::getStats(TriggerDiagStats& stats)
+{
+	AutoMutex lock(this->m_mutex);
+	stats.nb_frames = this->m_nb_frames;
+	stats.nb_latency = this->m_latency.n;
+	stats.latency_min = this->m_latency.min;
+	stats.latency_mean = this->m_latency.mean;
+	stats.latency_max = this->m_latency.max;
+	stats.latency_jitter = this->m_latency.stddev();
+	stats.latency_p50 = this->_percentile(0.5);
+	stats.latency_p99 = this->_percentile(0.99);
+	stats.readout_mean = this->m_readout.mean;
+	stats.readout_jitter = this->m_readout.stddev();
+	stats.period_mean = this->m_period.mean;
+	stats.period_jitter = this->m_period.stddev();
+	stats.level_start_active = this->m_level_start_active;
+	stats.level_end_active = this->m_level_end_active;
+}
+
+void TriggerDiag::getHistogram(std::vector<int>& histogram)
+{
+	AutoMutex lock(this->m_mutex);
+	histogram = this->m_histogram;
+}
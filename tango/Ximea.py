@@ -26,6 +26,9 @@
 # The Ximea camera plugin TANGO interface
 # ----------------------------------------------------------------------------
 
+import struct
+import time
+
 import PyTango
 
 from Lima import Core
@@ -33,6 +36,19 @@ from Lima import Ximea as Xi
 from Lima.Server import AttrHelper
 
 
+# live images use the Lima VIDEO_IMAGE encoding, as LimaCCDs video_last_image
+_VIDEO_HEADER_FORMAT = '!IHHqiiHHHH'
+_VIDEO_MAGIC = struct.unpack('>I', b'VDEO')[0]
+_VIDEO_MODES = {1: 0, 2: 1, 4: 2}	# Y8, Y16, Y32 by bytes per pixel
+
+
+# image types by bits per pixel, for timing predictions
+_IMAGE_TYPES = {
+	8: Core.Bpp8, 10: Core.Bpp10, 12: Core.Bpp12, 14: Core.Bpp14,
+	16: Core.Bpp16, 24: Core.Bpp24, 32: Core.Bpp32,
+}
+
+
 # this is needed by get_control, so needs to be outside class Ximea
 _Mode = {
 	"12_STD_L": Xi.Camera.Mode_12_STD_L,
@@ -80,6 +96,54 @@ _TempControlMode = {
 }
 
 
+class _SnapshotCam(object):
+	"""
+	Camera getters served from one Camera.getSnapshot() call, read again
+	once older than max_age seconds (0: always ask the camera), or
+	acq_max_age while acquiring to stay off the camera link; setters go
+	through and make the snapshot stale
+	"""
+	def __init__(self, cam, acquiring, max_age=0.5, acq_max_age=5.):
+		self.cam = cam
+		self.acquiring = acquiring
+		self.max_age = max_age
+		self.acq_max_age = acq_max_age
+		self.read_time = 0.
+		self.__values = {}
+		self.__time = None
+
+	def invalidate(self):
+		self.__time = None
+
+	def __get_values(self):
+		now = time.monotonic()
+		max_age = self.max_age
+		if self.__time is not None and self.acquiring():
+			max_age = max(max_age, self.acq_max_age)
+		if self.__time is None or now - self.__time > max_age:
+			timestamp, self.read_time, self.__values = self.cam.getSnapshot()
+			self.__time = now
+		return self.__values
+
+	def __getattr__(self, name):
+		func = getattr(self.cam, name)
+		if name.startswith('set'):
+			def setter(*args):
+				self.invalidate()
+				return func(*args)
+			return setter
+		if name.startswith('get'):
+			key = name[3:]
+			def getter(*args):
+				if self.max_age > 0 and not args:
+					values = self.__get_values()
+					if key in values:
+						return values[key]
+				return func(*args)
+			return getter
+		return func
+
+
 class Ximea(PyTango.Device_4Impl):
 	Core.DEB_CLASS(Core.DebModApplication, 'LimaCCDs')
 
@@ -233,6 +297,7 @@ class Ximea(PyTango.Device_4Impl):
 			"MISSED_TRIGGER_OVERLAP": Xi.Camera.CounterSelector_Missed_Trigger_Overlap,
 			"MISSED_TRIGGER_BUFFER_FULL": Xi.Camera.CounterSelector_Missed_Trigger_Buffer_Full,
 			"FRAME_BUFFER_FULL": Xi.Camera.CounterSelector_Frame_Buffer_Full,
+			"TRANSFERRED_FRAMES": Xi.Camera.CounterSelector_Transferred_Frames,
 		}
 
 		self.__AcqTimingMode = {
@@ -241,6 +306,12 @@ class Ximea(PyTango.Device_4Impl):
 			"FRAME_RATE_LIMIT": Xi.Camera.AcqTimingMode_Frame_Rate_Limit,
 		}
 
+		self.__TriggerOverlap = {
+			"OFF": Xi.Camera.TriggerOverlap_Off,
+			"READ_OUT": Xi.Camera.TriggerOverlap_Read_Out,
+			"PREV_FRAME": Xi.Camera.TriggerOverlap_Prev_Frame,
+		}
+
 		self.__FeatureSelector = {
 			"ZERO_ROT_ENABLE": Xi.Camera.FeatureSelector_Zero_ROT_Enable,
 			"BLACK_LEVEL_CLAMP": Xi.Camera.FeatureSelector_Black_Level_Clamp,
@@ -321,6 +392,38 @@ class Ximea(PyTango.Device_4Impl):
 			"BLINK": Xi.Camera.LEDMode_Blink,
 		}
 
+		self.__AutoExposureEngine = {
+			"HARDWARE": Xi.Camera.AutoExposureEngine_Hardware,
+			"SOFTWARE": Xi.Camera.AutoExposureEngine_Software,
+		}
+		self.__PreTriggerSource = {
+			"GPI": Xi.Camera.PreTriggerSource_Gpi,
+			"SOFTWARE": Xi.Camera.PreTriggerSource_Software,
+		}
+		self.__LiveViewMode = {
+			"OFF": Xi.Camera.LiveViewMode_Off,
+			"EVERY_NTH": Xi.Camera.LiveViewMode_Every_Nth,
+			"FIXED_RATE": Xi.Camera.LiveViewMode_Fixed_Rate,
+		}
+		self.__DemosaicAlgorithm = {
+			"BILINEAR": Xi.Camera.DemosaicAlgorithm_Bilinear,
+			"EDGE_AWARE": Xi.Camera.DemosaicAlgorithm_Edge_Aware,
+		}
+		self.__DarkMatch = {
+			"NONE": Xi.Camera.DarkMatch_None,
+			"EXACT": Xi.Camera.DarkMatch_Exact,
+			"INTERPOLATED": Xi.Camera.DarkMatch_Interpolated,
+		}
+		self.__MetadataSidecarFormat = {
+			"RAW": Xi.Camera.MetadataSidecarFormat_Raw,
+			"NPY": Xi.Camera.MetadataSidecarFormat_Npy,
+		}
+		self.__BufferPages = {
+			"NORMAL": Xi.Camera.BufferPages_Normal,
+			"TRANSPARENT_HUGE": Xi.Camera.BufferPages_Transparent_Huge,
+			"HUGE": Xi.Camera.BufferPages_Huge,
+		}
+
 		self.init_device()
 
 	# ------------------------------------------------------------------
@@ -336,6 +439,7 @@ class Ximea(PyTango.Device_4Impl):
 	def init_device(self):
 		self.set_state(PyTango.DevState.ON)
 		self.get_device_properties(self.get_device_class())
+		_XimeaSnapshot.max_age = self.snapshot_max_age
 
 	# ------------------------------------------------------------------
 	#    getAttrStringValueList command:
@@ -348,6 +452,321 @@ class Ximea(PyTango.Device_4Impl):
 		# use AttrHelper
 		return AttrHelper.get_attr_string_value_list(self, attr_name)
 
+	# ------------------------------------------------------------------
+	#    Dark / flat field correction map commands
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def loadDarkMap(self, path):
+		_XimeaCam.loadDarkMap(path)
+
+	@Core.DEB_MEMBER_FUNCT
+	def loadFlatMap(self, path):
+		_XimeaCam.loadFlatMap(path)
+
+	@Core.DEB_MEMBER_FUNCT
+	def clearDarkMap(self):
+		_XimeaCam.clearDarkMap()
+
+	@Core.DEB_MEMBER_FUNCT
+	def clearFlatMap(self):
+		_XimeaCam.clearFlatMap()
+
+	# ------------------------------------------------------------------
+	#    Live view image, read from the side channel only
+	# ------------------------------------------------------------------
+	def read_live_image(self, attr):
+		frame_nb, width, height, depth, data = _XimeaCam.getLiveImage()
+		endianness = ord(struct.pack('=H', 1)[-1:])
+		header = struct.pack(_VIDEO_HEADER_FORMAT, _VIDEO_MAGIC, 1, _VIDEO_MODES.get(depth, 0),
+			frame_nb, width, height, endianness, struct.calcsize(_VIDEO_HEADER_FORMAT), 0, 0)
+		attr.set_value('VIDEO_IMAGE', header + data)
+
+	# ------------------------------------------------------------------
+	#    Parameter snapshot serving the attribute reads
+	# ------------------------------------------------------------------
+	def read_snapshot_max_age(self, attr):
+		attr.set_value(_XimeaSnapshot.max_age)
+
+	def write_snapshot_max_age(self, attr):
+		_XimeaSnapshot.max_age = attr.get_write_value()
+		_XimeaSnapshot.invalidate()
+
+	def read_snapshot_read_time(self, attr):
+		attr.set_value(_XimeaSnapshot.read_time)
+
+	# ------------------------------------------------------------------
+	#    Sensor monitor history, one row per sample:
+	#    time, temperature, chip, housing, back, sensor, acq_status, counter
+	# ------------------------------------------------------------------
+	def read_monitor_history(self, attr):
+		history = _XimeaCam.getMonitorHistory()
+		attr.set_value([list(h) for h in history] or [[]])
+
+	# ------------------------------------------------------------------
+	#    Frame rate model
+	# ------------------------------------------------------------------
+	def read_predicted_max_fps(self, attr):
+		attr.set_value(_XimeaCam.getTimingPrediction().max_fps)
+
+	def read_predicted_readout_time(self, attr):
+		attr.set_value(_XimeaCam.getTimingPrediction().readout_time)
+
+	def read_predicted_min_lat_time(self, attr):
+		attr.set_value(_XimeaCam.getTimingPrediction().min_lat_time)
+
+	# ------------------------------------------------------------------
+	#    predictTiming command:
+	#
+	#    Description: what-if timing for other settings
+	#    argin: DevVarDoubleArray [exp_time, roi_x, roi_y, roi_w, roi_h, bin_x, bin_y, bits]
+	#    argout: DevVarDoubleArray [min_exp_time, max_exp_time, min_lat_time,
+	#        readout_time, max_fps_sensor, max_fps_bandwidth, max_fps, calibrated]
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def predictTiming(self, argin):
+		exp_time, x, y, w, h, bin_x, bin_y, bits = argin
+		roi = Core.Roi(int(x), int(y), int(w), int(h))
+		bin = Core.Bin(int(bin_x), int(bin_y))
+		p = _XimeaCam.predictTiming(exp_time, roi, bin, _IMAGE_TYPES[int(bits)])
+		return [p.min_exp_time, p.max_exp_time, p.min_lat_time, p.readout_time,
+			p.max_fps_sensor, p.max_fps_bandwidth, p.max_fps, float(p.calibrated)]
+
+	@Core.DEB_MEMBER_FUNCT
+	def calibrateTiming(self):
+		_XimeaCam.calibrateTiming()
+
+	# ------------------------------------------------------------------
+	#    Pre-trigger event command
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def firePreTrigger(self):
+		_XimeaCam.firePreTrigger()
+
+	# ------------------------------------------------------------------
+	#    getAccumulationHwFrames command:
+	#
+	#    Description: first and last hardware frame numbers summed in a frame
+	#    argin: DevLong frame number
+	#    argout: DevVarLongArray
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def getAccumulationHwFrames(self, frame_nb):
+		return list(_XimeaCam.getAccumulationHwFrames(frame_nb))
+
+	# ------------------------------------------------------------------
+	#    HDR merge
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def clearHdrCalibration(self):
+		_XimeaCam.clearHdrCalibration()
+
+	def read_hdr_calibrated_ratio(self, attr):
+		attr.set_value(_XimeaCam.getHdrCalibration()[0])
+
+	def read_hdr_calibrated_knee(self, attr):
+		attr.set_value(_XimeaCam.getHdrCalibration()[1])
+
+	# ------------------------------------------------------------------
+	#    benchmarkDemosaic command:
+	#
+	#    Description: demosaic speed on synthetic frames of the current
+	#    ROI size, one algorithm, bit_depth, frame_time, Mpixel/s row per
+	#    algorithm and bit depth
+	#    argin: DevLong number of frames
+	#    argout: DevVarDoubleArray
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def benchmarkDemosaic(self, nb_frames):
+		return [v for r in _XimeaCam.benchmarkDemosaic(nb_frames)
+			for v in (r.algorithm, r.bit_depth, r.frame_time, r.throughput)]
+
+	# ------------------------------------------------------------------
+	#    Dark frame cache commands
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def acquireDark(self, nb_frames):
+		_XimeaCam.acquireDark(nb_frames)
+
+	@Core.DEB_MEMBER_FUNCT
+	def clearDarkCache(self):
+		_XimeaCam.clearDarkCache()
+
+	# ------------------------------------------------------------------
+	#    Exposure sequence: write the exposures first, gains of another
+	#    length are dropped
+	# ------------------------------------------------------------------
+	def read_sequence_exp_times(self, attr):
+		attr.set_value(_XimeaCam.getExposureSequence()[0])
+
+	def write_sequence_exp_times(self, attr):
+		exp_times = list(attr.get_write_value())
+		gains = _XimeaCam.getExposureSequence()[1]
+		_XimeaCam.setExposureSequence(exp_times, gains if len(gains) == len(exp_times) else [])
+
+	def read_sequence_gains(self, attr):
+		attr.set_value(_XimeaCam.getExposureSequence()[1])
+
+	def write_sequence_gains(self, attr):
+		_XimeaCam.setExposureSequence(_XimeaCam.getExposureSequence()[0], list(attr.get_write_value()))
+
+	# ------------------------------------------------------------------
+	#    getFrameParams command:
+	#
+	#    Description: exposure time and gain in effect for a frame
+	#    argin: DevLong frame number
+	#    argout: DevVarDoubleArray
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def getFrameParams(self, frame_nb):
+		return list(_XimeaCam.getFrameParams(frame_nb))
+
+	# ------------------------------------------------------------------
+	#    getFrameMetadata command:
+	#
+	#    Description: metadata of a frame still in the Lima buffers
+	#    argin: DevLong frame number
+	#    argout: DevVarDoubleArray
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def getFrameMetadata(self, frame_nb):
+		m = _XimeaCam.getFrameMetadata(frame_nb)
+		return [m.host_time, m.data_saturation, m.frame_nb, m.acq_nframe, m.nframe,
+			m.ts_sec, m.ts_usec, m.exposure_time_us, m.gain_db, m.black_level,
+			m.gpi_level, m.flags, m.image_user_data, m.width, m.height,
+			m.offset_x, m.offset_y, m.sequence_step]
+
+	# ------------------------------------------------------------------
+	#    Mode characterization: modes by name, ROIs as x, y, w, h
+	#    quadruplets, empty lists for all modes, full frame and the
+	#    current bit depth
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def runBenchmark(self, report_path):
+		_XimeaCam.runBenchmark(report_path)
+
+	def __set_benchmark_points(self, modes=None, rois=None, bit_depths=None):
+		_XimeaCam.setBenchmarkPoints(
+			_XimeaCam.getBenchmarkModes() if modes is None else modes,
+			_XimeaCam.getBenchmarkRois() if rois is None else rois,
+			_XimeaCam.getBenchmarkBitDepths() if bit_depths is None else bit_depths)
+
+	def read_benchmark_modes(self, attr):
+		names = dict((v, k) for k, v in self.__Mode.items())
+		attr.set_value([names.get(m, str(m)) for m in _XimeaCam.getBenchmarkModes()])
+
+	def write_benchmark_modes(self, attr):
+		self.__set_benchmark_points(modes=[self.__Mode[m.upper()] for m in attr.get_write_value() or []])
+
+	def read_benchmark_rois(self, attr):
+		attr.set_value([v for roi in _XimeaCam.getBenchmarkRois() for v in roi])
+
+	def write_benchmark_rois(self, attr):
+		values = list(attr.get_write_value() or [])
+		if len(values) % 4:
+			raise ValueError("benchmark_rois takes x, y, w, h quadruplets")
+		self.__set_benchmark_points(rois=[tuple(values[i:i + 4]) for i in range(0, len(values), 4)])
+
+	def read_benchmark_bit_depths(self, attr):
+		attr.set_value(_XimeaCam.getBenchmarkBitDepths())
+
+	def write_benchmark_bit_depths(self, attr):
+		self.__set_benchmark_points(bit_depths=list(attr.get_write_value() or []))
+
+	# ------------------------------------------------------------------
+	#    syncClock command:
+	#
+	#    Description: pair the camera and host clocks now
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def syncClock(self):
+		_XimeaCam.syncClock()
+
+	# ------------------------------------------------------------------
+	#    Trigger diagnostics
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def resetTriggerDiag(self):
+		_XimeaCam.resetTriggerDiag()
+
+	def __read_trigger_diag(self, attr, name):
+		attr.set_value(getattr(_XimeaCam.getTriggerDiagStats(), name))
+
+	def read_trigger_diag_nb_frames(self, attr):
+		self.__read_trigger_diag(attr, 'nb_frames')
+
+	def read_trigger_latency_min(self, attr):
+		self.__read_trigger_diag(attr, 'latency_min')
+
+	def read_trigger_latency_mean(self, attr):
+		self.__read_trigger_diag(attr, 'latency_mean')
+
+	def read_trigger_latency_max(self, attr):
+		self.__read_trigger_diag(attr, 'latency_max')
+
+	def read_trigger_latency_jitter(self, attr):
+		self.__read_trigger_diag(attr, 'latency_jitter')
+
+	def read_trigger_latency_p99(self, attr):
+		self.__read_trigger_diag(attr, 'latency_p99')
+
+	def read_trigger_readout_mean(self, attr):
+		self.__read_trigger_diag(attr, 'readout_mean')
+
+	def read_trigger_period_jitter(self, attr):
+		self.__read_trigger_diag(attr, 'period_jitter')
+
+	def read_trigger_missed_overlap(self, attr):
+		self.__read_trigger_diag(attr, 'missed_overlap')
+
+	def read_trigger_missed_buffer_full(self, attr):
+		self.__read_trigger_diag(attr, 'missed_buffer_full')
+
+	def read_trigger_latency_histogram(self, attr):
+		attr.set_value(_XimeaCam.getTriggerDiagHistogram())
+
+	# ------------------------------------------------------------------
+	#    saveProfile command:
+	#
+	#    Description: save the camera settings as a named profile
+	#    argin: DevString profile name, or path
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def saveProfile(self, name):
+		_XimeaCam.saveProfile(name)
+
+	# ------------------------------------------------------------------
+	#    loadProfile command:
+	#
+	#    Description: apply a profile, writing only what differs; the
+	#    geometry, trigger and exposure are passed on to Lima so that the
+	#    next prepareAcq keeps them
+	#    argin: DevString profile name, or path
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def loadProfile(self, name):
+		try:
+			_XimeaCam.loadProfile(name)
+		finally:
+			_XimeaSnapshot.invalidate()
+		image = _XimeaControl.image()
+		image.setImageType(_XimeaCam.getImageType())
+		image.setBin(_XimeaCam.getBin())
+		image.setRoi(_XimeaCam.getRoi())
+		acq = _XimeaControl.acquisition()
+		acq.setTriggerMode(_XimeaCam.getTrigMode())
+		acq.setAcqExpoTime(_XimeaCam.getExpTime())
+		acq.setLatencyTime(_XimeaCam.getLatTime())
+
+	# ------------------------------------------------------------------
+	#    getProfileList command:
+	#
+	#    Description: profiles in the profile directory
+	#    argout: DevVarStringArray
+	# ------------------------------------------------------------------
+	@Core.DEB_MEMBER_FUNCT
+	def getProfileList(self):
+		return _XimeaCam.getProfileList()
+
 	# ------------------------------------------------------------------
 	#
 	#    Ximea read/write attribute methods
@@ -355,7 +774,7 @@ class Ximea(PyTango.Device_4Impl):
 	# ------------------------------------------------------------------
 	def __getattr__(self, name):
 		# use AttrHelper
-		return AttrHelper.get_attr_4u(self, name, _XimeaCam)
+		return AttrHelper.get_attr_4u(self, name, _XimeaSnapshot)
 
 
 # ------------------------------------------------------------------
@@ -397,6 +816,11 @@ class XimeaClass(PyTango.DeviceClass):
 			PyTango.DevString,
 			"Startup camera mode",
 			"2_12_HDR_HL"
+		],
+		"snapshot_max_age": [
+			PyTango.DevDouble,
+			"Attribute reads are served from a parameter snapshot at most this old (s), 0 to read the camera each time",
+			0.5
 		]
 	}
 
@@ -405,6 +829,86 @@ class XimeaClass(PyTango.DeviceClass):
 			[PyTango.DevString, "Attribute name"],
 			[PyTango.DevVarStringArray, "Authorized String value list"]
 		],
+		'loadDarkMap': [
+			[PyTango.DevString, "Full sensor dark map, raw float32 file"],
+			[PyTango.DevVoid, ""]
+		],
+		'loadFlatMap': [
+			[PyTango.DevString, "Full sensor flat map, raw float32 file"],
+			[PyTango.DevVoid, ""]
+		],
+		'clearDarkMap': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'clearFlatMap': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'predictTiming': [
+			[PyTango.DevVarDoubleArray, "exp_time, roi x, y, w, h, bin x, y, bits per pixel"],
+			[PyTango.DevVarDoubleArray, "min/max exp_time, min_lat_time, readout_time, max fps sensor/bandwidth/overall, calibrated"]
+		],
+		'calibrateTiming': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'firePreTrigger': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'getAccumulationHwFrames': [
+			[PyTango.DevLong, "Frame number"],
+			[PyTango.DevVarLongArray, "First and last hardware frame numbers"]
+		],
+		'clearHdrCalibration': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'benchmarkDemosaic': [
+			[PyTango.DevLong, "Number of frames per algorithm and bit depth"],
+			[PyTango.DevVarDoubleArray, "algorithm, bit_depth, frame_time (s), throughput (Mpixel/s) per point"]
+		],
+		'acquireDark': [
+			[PyTango.DevLong, "Number of frames to average, beam must be off"],
+			[PyTango.DevVoid, ""]
+		],
+		'clearDarkCache': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'getFrameParams': [
+			[PyTango.DevLong, "Frame number"],
+			[PyTango.DevVarDoubleArray, "Exposure time (s) and gain (dB)"]
+		],
+		'getFrameMetadata': [
+			[PyTango.DevLong, "Frame number"],
+			[PyTango.DevVarDoubleArray, "host_time, data_saturation, frame_nb, acq_nframe, nframe, ts_sec, ts_usec, exposure_time_us, gain_db, black_level, gpi_level, flags, image_user_data, width, height, offset_x, offset_y, sequence_step"]
+		],
+		'runBenchmark': [
+			[PyTango.DevString, "JSON report path, empty for none"],
+			[PyTango.DevVoid, ""]
+		],
+		'syncClock': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'resetTriggerDiag': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVoid, ""]
+		],
+		'saveProfile': [
+			[PyTango.DevString, "Profile name, or path"],
+			[PyTango.DevVoid, ""]
+		],
+		'loadProfile': [
+			[PyTango.DevString, "Profile name, or path"],
+			[PyTango.DevVoid, ""]
+		],
+		'getProfileList': [
+			[PyTango.DevVoid, ""],
+			[PyTango.DevVarStringArray, "Profiles in the profile directory"]
+		],
 	}
 
 	attr_list = {
@@ -416,6 +920,30 @@ class XimeaClass(PyTango.DeviceClass):
 				'description': 'Select trigger polarity',
 			}
 		],
+		"trigger_overlap": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Trigger accepted during readout (READ_OUT) or latched before (PREV_FRAME)',
+			}
+		],
+		"trigger_period": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Expected external trigger period, checked on prepareAcq (0 to skip)',
+			}
+		],
+		"max_trigger_rate": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'Hz',
+				'format': '',
+				'description': 'Highest external trigger rate for the current settings',
+			}
+		],
 		"software_trigger": [
 			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
 			{
@@ -931,6 +1459,1039 @@ class XimeaClass(PyTango.DeviceClass):
 				'memorized': 'true',
 			}
 		],
+		"stats_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Enable per-frame statistics in the acquisition loop',
+			}
+		],
+		"stats_window": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'frames',
+				'format': '',
+				'description': 'Number of frames used for rolling statistics',
+			}
+		],
+		"stats_min": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Minimum pixel value of the last frame',
+			}
+		],
+		"stats_max": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Maximum pixel value of the last frame',
+			}
+		],
+		"stats_mean": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Mean pixel value of the last frame',
+			}
+		],
+		"stats_sum": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Sum of pixel values of the last frame',
+			}
+		],
+		"stats_histogram": [
+			[PyTango.DevLong, PyTango.SPECTRUM, PyTango.READ, 256],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': '256 bin histogram of the last frame',
+			}
+		],
+		"stats_rolling_min": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Minimum pixel value over the statistics window',
+			}
+		],
+		"stats_rolling_max": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Maximum pixel value over the statistics window',
+			}
+		],
+		"stats_rolling_mean": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Mean pixel value over the statistics window',
+			}
+		],
+		"stats_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Time spent computing statistics of the last frame',
+			}
+		],
+		"stats_time_fraction": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Statistics time relative to the frame period',
+			}
+		],
+		"auto_exposure_engine": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Auto exposure engine used when Lima auto exposure is on',
+			}
+		],
+		"auto_exposure_mode": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Enable auto exposure with the selected engine',
+			}
+		],
+		"soft_ae_percentile": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Histogram percentile steered by software auto exposure (0-1)',
+			}
+		],
+		"soft_ae_target_level": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Target level of the percentile as fraction of full scale',
+			}
+		],
+		"soft_ae_max_saturation": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Maximum fraction of saturated pixels',
+			}
+		],
+		"soft_ae_tolerance": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Relative tolerance on the target level',
+			}
+		],
+		"soft_ae_max_exposure": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Maximum exposure used by software auto exposure',
+			}
+		],
+		"soft_ae_max_gain": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'dB',
+				'format': '',
+				'description': 'Maximum gain used by software auto exposure',
+			}
+		],
+		"auto_exposure_convergence": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'frames',
+				'format': '',
+				'description': 'Frames needed to reach the target level, -1 if not reached',
+			}
+		],
+		"auto_exposure_level": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Measured percentile level of the last frame',
+			}
+		],
+		"correction_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Apply dark subtraction and flat-field normalisation to frames',
+			}
+		],
+		"processing_threads": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Number of threads used for per-frame processing',
+			}
+		],
+		"correction_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Time spent correcting the last frame',
+			}
+		],
+		"correction_throughput": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'GB/s',
+				'format': '',
+				'description': 'Correction throughput on the last frame',
+			}
+		],
+		"dark_cache_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Use cached darks matching the acquisition settings',
+			}
+		],
+		"dark_cache_dir": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Directory of the dark cache, empty to keep darks in memory',
+				'memorized': 'true',
+			}
+		],
+		"dark_temp_tolerance": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '*C',
+				'format': '',
+				'description': 'Sensor temperature drift after which a dark is stale',
+			}
+		],
+		"dark_cache_size": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Number of cached darks',
+			}
+		],
+		"dark_match": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'How the dark of the last prepareAcq was found: NONE, EXACT or INTERPOLATED',
+			}
+		],
+		"dark_stale": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Sensor temperature drifted away from the dark in use',
+			}
+		],
+		"pre_trigger_mode": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Acquire into a ring buffer and commit frames around an event',
+			}
+		],
+		"pre_trigger_frames": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Number of frames kept before the event',
+			}
+		],
+		"pre_trigger_source": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Event source: GPI (trigger GPI port and polarity) or SOFTWARE',
+			}
+		],
+		"pre_trigger_event_frame": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Lima frame number of the event frame, -1 until the event',
+			}
+		],
+		"accumulation_frames": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Number of sensor frames summed in each 32 bit frame, 1 to disable',
+			}
+		],
+		"live_view_mode": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Live view publishing: OFF, EVERY_NTH frame or latest frame at FIXED_RATE',
+			}
+		],
+		"live_view_decimation": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Publish one frame every N frames in EVERY_NTH mode',
+			}
+		],
+		"live_view_rate": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'Hz',
+				'format': '',
+				'description': 'Publishing rate in FIXED_RATE mode',
+			}
+		],
+		"live_view_downscale": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Live image downscale factor: 1, 2, 4, 8 or 16',
+			}
+		],
+		"live_view_8_bit": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Convert live images to 8 bit',
+			}
+		],
+		"live_image": [
+			[PyTango.DevEncoded, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Latest live view image, VIDEO_IMAGE encoded',
+			}
+		],
+		"predicted_max_fps": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'Hz',
+				'format': '',
+				'description': 'Predicted maximum frame rate for the current settings',
+			}
+		],
+		"predicted_readout_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Predicted readout time for the current settings',
+			}
+		],
+		"predicted_min_lat_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Shortest latency giving the predicted frame rate',
+			}
+		],
+		"sdk_burst_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Time of frames at the highest rate the SDK queue absorbs',
+			}
+		],
+		"sdk_queue_size_override": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'frames',
+				'format': '',
+				'description': 'SDK queue size, 0 for automatic',
+			}
+		],
+		"sdk_acq_buffer_size_override": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'MiB',
+				'format': '',
+				'description': 'SDK acquisition buffer size, 0 for automatic',
+			}
+		],
+		"sdk_transport_buffer_size_override": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'B',
+				'format': '',
+				'description': 'Transport buffer size, 0 for automatic',
+			}
+		],
+		"sdk_queue_size": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'frames',
+				'format': '',
+				'description': 'SDK queue size in use',
+			}
+		],
+		"sdk_acq_buffer_size": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'MiB',
+				'format': '',
+				'description': 'SDK acquisition buffer size in use',
+			}
+		],
+		"sdk_transport_buffer_size": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'B',
+				'format': '',
+				'description': 'Transport buffer size in use',
+			}
+		],
+		"sdk_queue_occupancy": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'frames',
+				'format': '',
+				'description': 'Frames waiting in the SDK queue',
+			}
+		],
+		"sdk_queue_high_water": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'frames',
+				'format': '',
+				'description': 'Highest SDK queue occupancy seen in this acquisition',
+			}
+		],
+		"buffer_huge_pages": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Allocate frame buffers on 2 MB pages',
+			}
+		],
+		"buffer_prefault": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Fault frame buffers in at prepareAcq',
+			}
+		],
+		"buffer_lock": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Lock frame buffers in memory at prepareAcq',
+			}
+		],
+		"buffer_pages": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Pages backing the frame buffers',
+			}
+		],
+		"buffer_prefault_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Time spent faulting frame buffers in',
+			}
+		],
+		"numa_nb_nodes": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Number of NUMA nodes',
+			}
+		],
+		"numa_device_node": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'NUMA node of the camera PCIe device, -1 if unknown',
+			}
+		],
+		"numa_node": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'NUMA node for buffers and threads, -1 to follow the camera',
+			}
+		],
+		"numa_placement_node": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'NUMA node applied at prepareAcq, -1 for none',
+			}
+		],
+		"numa_buffer_node": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'NUMA node holding the frame buffers',
+			}
+		],
+		"numa_acq_thread_node": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'NUMA node the acquisition thread runs on',
+			}
+		],
+		"exp_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Exposure time, queued and applied between frames while acquiring',
+			}
+		],
+		"last_frame_exp_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Exposure time of the last frame',
+			}
+		],
+		"last_frame_gain": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'dB',
+				'format': '',
+				'description': 'Gain of the last frame',
+			}
+		],
+		"metadata_sidecar_path": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Per-frame metadata file name, numbered per acquisition, empty to disable',
+			}
+		],
+		"metadata_sidecar_file": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Metadata file of the last acquisition',
+			}
+		],
+		"metadata_sidecar_format": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Metadata file format, RAW records or NPY structured array',
+			}
+		],
+		"monitor_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Sample temperatures, acquisition status and counter in the background',
+			}
+		],
+		"monitor_rate": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'Hz',
+				'format': '',
+				'description': 'Sensor monitor sampling rate',
+			}
+		],
+		"monitor_history_size": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Number of sensor monitor samples kept',
+			}
+		],
+		"monitor_history": [
+			[PyTango.DevDouble, PyTango.IMAGE, PyTango.READ, 8, 86400],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Sensor monitor samples: time, temperature, chip, housing, back, sensor, acq_status, counter',
+			}
+		],
+		"event_max_rate": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'Hz',
+				'format': '',
+				'description': 'Maximum events per second of each type, 0 for no limit',
+			}
+		],
+		"event_coalesce_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Identical events within this time are reported once',
+			}
+		],
+		"events_delivered": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Events reported to Lima',
+			}
+		],
+		"events_coalesced": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Events merged into an identical one',
+			}
+		],
+		"events_suppressed": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Events dropped by the rate limit',
+			}
+		],
+		"events_lost": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Events lost with the event queue full',
+			}
+		],
+		"temp_alarm": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '*C',
+				'format': '',
+				'description': 'Sensor board temperature raising an alarm event, 0 to disable',
+			}
+		],
+		"snapshot_max_age": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Attribute reads are served from a parameter snapshot at most this old, 0 to read the camera each time',
+			}
+		],
+		"snapshot_read_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Time taken by the last parameter snapshot',
+			}
+		],
+		"profile_dir": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Directory of the configuration profiles',
+			}
+		],
+		"profile_name": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Last profile saved or loaded',
+			}
+		],
+		"profile_switch_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Time taken to apply the last profile',
+			}
+		],
+		"profile_nb_writes": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Settings written when applying the last profile',
+			}
+		],
+		"clock_sync_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Time stamp frames with the camera clock converted to host time instead of their arrival, off by default',
+			}
+		],
+		"clock_sync_interval": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Time between camera and host clock pairings',
+			}
+		],
+		"clock_sync_window": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Clock pairings the offset and drift are fitted on',
+			}
+		],
+		"clock_sync_nb_samples": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Clock pairings in the fit',
+			}
+		],
+		"clock_sync_drift": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'ppm',
+				'format': '',
+				'description': 'Camera clock drift against the host clock',
+			}
+		],
+		"clock_sync_offset": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Host time at camera time 0',
+			}
+		],
+		"clock_sync_error": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Bound of the camera to host time conversion error',
+			}
+		],
+		"trigger_diag_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Measure trigger latency and jitter in external trigger modes',
+			}
+		],
+		"trigger_diag_bin_width": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Trigger latency histogram bin width',
+			}
+		],
+		"trigger_diag_nb_frames": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Frames measured by the trigger diagnostics',
+			}
+		],
+		"trigger_latency_min": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Shortest trigger to host latency',
+			}
+		],
+		"trigger_latency_mean": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Mean trigger to host latency',
+			}
+		],
+		"trigger_latency_max": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Longest trigger to host latency',
+			}
+		],
+		"trigger_latency_jitter": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Standard deviation of the trigger to host latency',
+			}
+		],
+		"trigger_latency_p99": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': '99th percentile of the trigger to host latency',
+			}
+		],
+		"trigger_readout_mean": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Mean exposure end to host latency',
+			}
+		],
+		"trigger_period_jitter": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Standard deviation of the period between exposures, camera clock',
+			}
+		],
+		"trigger_missed_overlap": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Triggers missed during the acquisition, exposure overlap',
+			}
+		],
+		"trigger_missed_buffer_full": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Triggers missed during the acquisition, frame buffer full',
+			}
+		],
+		"trigger_latency_histogram": [
+			[PyTango.DevLong, PyTango.SPECTRUM, PyTango.READ, 1000],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Trigger to host latency histogram, last bin counts overflows',
+			}
+		],
+		"sequence_exp_times": [
+			[PyTango.DevDouble, PyTango.SPECTRUM, PyTango.READ_WRITE, 1024],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Exposure sequence, frame n uses entry n modulo its length; empty to disable',
+			}
+		],
+		"sequence_gains": [
+			[PyTango.DevDouble, PyTango.SPECTRUM, PyTango.READ_WRITE, 1024],
+			{
+				'unit': 'dB',
+				'format': '',
+				'description': 'Gains of the exposure sequence steps, empty to keep the gain',
+			}
+		],
+		"sequence_mismatches": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': '',
+				'format': '',
+				'description': 'Frames whose reported exposure or gain differs from their sequence step',
+			}
+		],
+		"hdr_merge_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Merge the high and low gain channels of the HL modes into one linear frame',
+			}
+		],
+		"hdr_output_depth": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'bit',
+				'format': '',
+				'description': 'Merged frame depth, 16 (clipped) or 32',
+			}
+		],
+		"hdr_gain_ratio": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'High to low gain ratio, 0 to calibrate',
+			}
+		],
+		"hdr_knee": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'ADU',
+				'format': '',
+				'description': 'High gain level above black handing over to low gain, 0 to calibrate',
+			}
+		],
+		"hdr_calibrated_ratio": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Gain ratio in use, 0 until calibrated',
+			}
+		],
+		"hdr_calibrated_knee": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'ADU',
+				'format': '',
+				'description': 'Knee in use, 0 until calibrated',
+			}
+		],
+		"hdr_merge_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Merge time of the last frame',
+			}
+		],
+		"benchmark_modes": [
+			[PyTango.DevString, PyTango.SPECTRUM, PyTango.READ_WRITE, 32],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Modes to characterize, empty for all',
+			}
+		],
+		"benchmark_rois": [
+			[PyTango.DevLong, PyTango.SPECTRUM, PyTango.READ_WRITE, 256],
+			{
+				'unit': 'pixel',
+				'format': '',
+				'description': 'ROIs to characterize as x, y, w, h quadruplets, empty for full frame',
+			}
+		],
+		"benchmark_bit_depths": [
+			[PyTango.DevLong, PyTango.SPECTRUM, PyTango.READ_WRITE, 8],
+			{
+				'unit': 'bit',
+				'format': '',
+				'description': 'Bit depths to characterize, empty for the current one',
+			}
+		],
+		"benchmark_frames": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Frames read per benchmark point',
+			}
+		],
+		"demosaic_enabled": [
+			[PyTango.DevBoolean, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Bayer demosaic of Raw8 / Raw16 frames into 32 bit B G R A frames',
+			}
+		],
+		"demosaic_algorithm": [
+			[PyTango.DevString, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Demosaic algorithm: BILINEAR or EDGE_AWARE',
+			}
+		],
+		"demosaic_threads": [
+			[PyTango.DevLong, PyTango.SCALAR, PyTango.READ_WRITE],
+			{
+				'unit': 'N/A',
+				'format': '',
+				'description': 'Threads converting each frame, the demosaic thread included',
+			}
+		],
+		"demosaic_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Demosaic time of the last frame',
+			}
+		],
+		"demosaic_throughput": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 'Mpixel/s',
+				'format': '',
+				'description': 'Demosaic throughput of the last frame',
+			}
+		],
+		"format_conversion_time": [
+			[PyTango.DevDouble, PyTango.SCALAR, PyTango.READ],
+			{
+				'unit': 's',
+				'format': '',
+				'description': 'Conversion of the last frame to packed B G R A, 0 if the format needs none',
+			}
+		],
 	}
 
 	def __init__(self, name):
@@ -943,6 +2504,8 @@ class XimeaClass(PyTango.DeviceClass):
 # ----------------------------------------------------------------------------
 _XimeaCam = None
 _XimeaInterface = None
+_XimeaControl = None
+_XimeaSnapshot = None
 
 
 def get_control(
@@ -953,6 +2516,8 @@ def get_control(
 ):
 	global _XimeaCam
 	global _XimeaInterface
+	global _XimeaControl
+	global _XimeaSnapshot
 
 	print("Ximea camera_id:", camera_id)
 
@@ -966,7 +2531,10 @@ def get_control(
 			_Mode[startup_mode.upper()]
 		)
 		_XimeaInterface = Xi.Interface(_XimeaCam)
-	return Core.CtControl(_XimeaInterface)
+		_XimeaControl = Core.CtControl(_XimeaInterface)
+		_XimeaSnapshot = _SnapshotCam(_XimeaCam,
+			lambda: _XimeaControl.getStatus().AcquisitionStatus == Core.AcqRunning)
+	return _XimeaControl
 
 
 def get_tango_specific_class_n_device():
@@ -3,9 +3,11 @@ import pytest
 import PyTango
 
 ximea_devel_device = "id16ni/limaccd/ximea_devel"
+ximea_devel_camera = "id16ni/ximea/ximea_devel"
 
 def pytest_addoption(parser):
     parser.addoption('--device', default=ximea_devel_device, help='device name to run tests on')
+    parser.addoption('--camera', default=ximea_devel_camera, help='Ximea specific device name')
 
 @pytest.fixture(scope='session')
 def device(pytestconfig):
@@ -16,3 +18,11 @@ def device(pytestconfig):
         raise ValueError("cannot import device %s" % devname)
 
 
+
+@pytest.fixture(scope='session')
+def camera(pytestconfig):
+    devname = pytestconfig.getoption('--camera')
+    try:
+        return PyTango.DeviceProxy(devname)
+    except:
+        raise ValueError("cannot import device %s" % devname)
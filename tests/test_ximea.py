@@ -2,6 +2,10 @@
 import pytest
 import PyTango
 import time
+import math
+import os
+import json
+import struct
  
 def test_bin_read(device):
     try:
@@ -75,3 +79,682 @@ def test_stopacq(device):
 
        time.sleep(0.5)
 
+
+def _acquire(device, nb_frames, expo_time):
+    device.acq_mode = "SINGLE"
+    device.acq_trigger_mode = "INTERNAL_TRIGGER"
+    device.acq_nb_frames = nb_frames
+    device.acq_expo_time = expo_time
+    device.prepareAcq()
+    device.startAcq()
+
+    start_wait = time.time()
+    while str(device.acq_status).lower() != "ready":
+        if time.time() - start_wait > 10 + nb_frames * expo_time:
+            return False
+        time.sleep(0.1)
+    return True
+
+def _get_counter(camera, selector):
+    camera.counter_selector = selector
+    return camera.counter_value
+
+def test_stats_cost(device, camera):
+    """ checks that per-frame statistics cost a small fraction of frame time"""
+
+    camera.stats_enabled = True
+    try:
+        assert _acquire(device, 100, 0.001)
+
+        print(" stats time: {} s, fraction of frame period: {}".format(
+            camera.stats_time, camera.stats_time_fraction))
+        print(" min/max/mean: {} {} {}".format(camera.stats_min, camera.stats_max, camera.stats_mean))
+
+        assert camera.stats_min <= camera.stats_mean <= camera.stats_max
+        assert sum(camera.stats_histogram) > 0
+        assert camera.stats_time_fraction < 0.1
+    finally:
+        camera.stats_enabled = False
+
+
+def test_auto_exposure_convergence(device, camera):
+    """ compares convergence of the software controller with camera AEAG"""
+
+    nb_frames = 50
+    results = {}
+    try:
+        for engine in ("HARDWARE", "SOFTWARE"):
+            camera.auto_exposure_engine = engine
+            camera.auto_exposure_mode = True
+            # same start, well under the target, for both
+            device.acq_expo_time = 0.0001
+            assert _acquire(device, nb_frames, 0.0001)
+            results[engine] = camera.auto_exposure_convergence
+            camera.auto_exposure_mode = False
+    finally:
+        camera.auto_exposure_mode = False
+
+    print(" convergence in frames: {}".format(results))
+    # -1 when the target level was never reached
+    for engine, frames in results.items():
+        assert 0 <= frames < nb_frames, engine
+    # the driver loop settles about as fast as the camera one
+    assert results["SOFTWARE"] <= 2 * results["HARDWARE"] + 5
+
+
+def test_correction_throughput(device, camera, tmp_path):
+    """ benchmarks dark/flat correction throughput against thread count"""
+
+    # maps are full sensor size and read by the device server, which runs on the test host
+    device.image_bin = 1, 1
+    device.image_roi = 0, 0, 0, 0
+    width, height = device.image_roi[2], device.image_roi[3]
+    dark = tmp_path / "dark.raw"
+    dark.write_bytes(struct.pack("{}f".format(width * height), *([10.0] * (width * height))))
+
+    camera.loadDarkMap(str(dark))
+    camera.correction_enabled = True
+    try:
+        for nb_threads in (1, 2, 4):
+            camera.processing_threads = nb_threads
+            assert _acquire(device, 50, 0.001)
+            print(" {} thread(s): {:.2f} GB/s".format(nb_threads, camera.correction_throughput))
+            assert camera.correction_throughput > 0
+    finally:
+        camera.correction_enabled = False
+        camera.clearDarkMap()
+
+
+def test_benchmark(device, camera, tmp_path):
+    """ characterizes the current mode at two ROIs and checks settings are restored"""
+
+    mode = camera.mode
+    roi = device.image_roi
+    camera.benchmark_modes = [mode]
+    camera.benchmark_rois = [0, 0, 256, 256, 0, 0, 512, 512]
+    camera.benchmark_frames = 10
+    report = tmp_path / "benchmark.json"
+    try:
+        camera.runBenchmark(str(report))
+    finally:
+        camera.benchmark_modes = []
+        camera.benchmark_rois = []
+
+    results = json.loads(report.read_text())["results"]
+    assert len(results) == 2
+    for r in results:
+        print(" {}x{}: {:.1f} fps, noise {:.2f} ADU, {:.0f}% of the link".format(
+            r["width"], r["height"], r["frame_rate"], r["dark_noise"], r["bandwidth_use"] * 100))
+        assert r["ok"], r["error"]
+        assert r["frame_rate"] > 0
+        # measured at the shortest exposure, within one frame period
+        assert 0 < r["readout_time"] <= 1 / r["frame_rate"] * 1.01
+    # smaller frames read out faster
+    assert results[0]["frame_rate"] >= results[1]["frame_rate"]
+    assert camera.mode == mode
+    assert list(device.image_roi) == list(roi)
+
+
+def test_dark_cache(device, camera, tmp_path):
+    """ checks cached darks are matched exactly and interpolated at prepareAcq"""
+
+    camera.dark_cache_dir = str(tmp_path)
+    camera.correction_enabled = True
+    camera.dark_cache_enabled = True
+    try:
+        for expo_time in (0.001, 0.003):
+            device.acq_expo_time = expo_time
+            camera.acquireDark(5)
+        assert camera.dark_cache_size == 2
+
+        for expo_time, match in ((0.001, "EXACT"), (0.002, "INTERPOLATED"), (0.01, "NONE")):
+            device.acq_expo_time = expo_time
+            device.prepareAcq()
+            print(" {} s: {}, stale: {}".format(expo_time, camera.dark_match, camera.dark_stale))
+            assert camera.dark_match == match
+    finally:
+        camera.dark_cache_enabled = False
+        camera.correction_enabled = False
+        camera.clearDarkCache()
+        camera.dark_cache_dir = ""
+
+
+def test_pre_trigger(device, camera):
+    """ checks a software event commits the ring then the following frames"""
+
+    nb_pre, nb_frames = 10, 30
+    camera.pre_trigger_mode = True
+    camera.pre_trigger_frames = nb_pre
+    camera.pre_trigger_source = "SOFTWARE"
+    try:
+        device.acq_mode = "SINGLE"
+        device.acq_trigger_mode = "INTERNAL_TRIGGER"
+        device.acq_nb_frames = nb_frames
+        device.acq_expo_time = 0.001
+        device.prepareAcq()
+        device.startAcq()
+
+        # let the ring fill up before the event
+        time.sleep(0.5)
+        assert device.last_image_ready == -1
+        camera.firePreTrigger()
+
+        start_wait = time.time()
+        while str(device.acq_status).lower() != "ready":
+            assert time.time() - start_wait < 10
+            time.sleep(0.1)
+
+        assert camera.pre_trigger_event_frame == nb_pre
+        assert device.last_image_ready == nb_frames - 1
+    finally:
+        camera.pre_trigger_mode = False
+
+
+def test_accumulation(device, camera):
+    """ checks each frame sums the requested number of sensor frames"""
+
+    nb_sum = 10
+    camera.accumulation_frames = nb_sum
+    try:
+        assert device.image_type == "Bpp32"
+        assert _acquire(device, 20, 0.0001)
+
+        first, last = camera.getAccumulationHwFrames(19)
+        print(" frame 19: hardware frames {} to {}".format(first, last))
+        assert last - first == nb_sum - 1
+    finally:
+        camera.accumulation_frames = 1
+
+
+def test_hdr_merge(device, camera):
+    """ checks both gain channels are merged with a calibrated ratio and knee"""
+
+    mode = camera.mode
+    camera.mode = "2_12_HDR_HL"
+    camera.hdr_merge_enabled = True
+    try:
+        assert device.image_type == "Bpp16"
+        assert _acquire(device, 10, 0.001)
+
+        ratio, knee = camera.hdr_calibrated_ratio, camera.hdr_calibrated_knee
+        print(" gain ratio {:.2f}, knee {:.0f} ADU, merge {:.2f} ms".format(ratio, knee, camera.hdr_merge_time * 1e3))
+        if ratio == 0:
+            pytest.skip("not enough light to calibrate the gain ratio")
+        assert ratio > 1
+        assert knee > 0
+    finally:
+        camera.hdr_merge_enabled = False
+        camera.mode = mode
+
+
+def test_image_format(device, camera):
+    """ checks each image format gives its Lima type and converted formats reach Lima"""
+
+    fmt = camera.image_format
+    try:
+        for image_format, image_type in (("MONO8", "Bpp8"), ("RAW32_FLOAT", "Bpp32F"),
+                                         ("RGB32", "Bpp32"), ("RGB24", "Bpp32"), ("RGB_PLANAR", "Bpp32")):
+            try:
+                camera.image_format = image_format
+            except Exception:
+                print(" {} not supported by this camera".format(image_format))
+                continue
+            assert device.image_type == image_type
+            assert _acquire(device, 5, 0.001)
+            print(" {}: conversion {:.2f} ms".format(image_format, camera.format_conversion_time * 1e3))
+            assert (camera.format_conversion_time > 0) == (image_format in ("RGB24", "RGB_PLANAR"))
+        # refused before the camera is changed
+        current = camera.image_format
+        with pytest.raises(Exception):
+            camera.image_format = "TRANSPORT"
+        assert camera.image_format == current
+    finally:
+        camera.image_format = fmt
+
+
+def test_demosaic(device, camera):
+    """ checks colour frames come out as Bpp32 with both algorithms, and their speed"""
+
+    fmt = camera.image_format
+    camera.image_format = "RAW8"
+    camera.demosaic_enabled = True
+    try:
+        assert device.image_type == "Bpp32"
+        for algorithm in ("BILINEAR", "EDGE_AWARE"):
+            camera.demosaic_algorithm = algorithm
+            try:
+                assert _acquire(device, 10, 0.001)
+            except Exception as e:
+                if "Bayer" in str(e):
+                    pytest.skip("monochrome camera")
+                raise
+            print(" {}: {:.2f} ms, {:.0f} Mpixel/s".format(
+                algorithm, camera.demosaic_time * 1e3, camera.demosaic_throughput))
+            assert camera.demosaic_throughput > 0
+    finally:
+        camera.demosaic_enabled = False
+        camera.demosaic_algorithm = "BILINEAR"
+        camera.image_format = fmt
+
+    results = camera.benchmarkDemosaic(5)
+    assert len(results) == 4 * 4
+    for i in range(0, len(results), 4):
+        algorithm, bit_depth, frame_time, throughput = results[i:i + 4]
+        print(" algorithm {:.0f}, {:.0f} bits: {:.0f} Mpixel/s".format(algorithm, bit_depth, throughput))
+        assert frame_time > 0
+
+
+def test_live_view(device, camera):
+    """ checks the live view publishes decimated, downscaled 8 bit frames"""
+
+    camera.live_view_mode = "EVERY_NTH"
+    camera.live_view_decimation = 10
+    camera.live_view_downscale = 4
+    camera.live_view_8_bit = True
+    try:
+        assert _acquire(device, 100, 0.001)
+
+        fmt, data = camera.live_image
+        magic, version, mode, frame_nb, width, height = struct.unpack('!IHHqii', data[:24])
+        print(" live frame {}: {}x{}".format(frame_nb, width, height))
+        assert fmt == "VIDEO_IMAGE"
+        assert mode == 0
+        assert frame_nb == 90
+        assert len(data) == 32 + width * height
+    finally:
+        camera.live_view_mode = "OFF"
+
+
+def test_frame_rate_model(device, camera):
+    """ compares the predicted frame rate with a free running acquisition"""
+
+    device.image_bin = 1, 1
+    device.image_roi = 0, 0, 0, 0
+    nb_frames, expo_time = 200, 0.0001
+    device.acq_expo_time = expo_time
+    device.latency_time = 0
+    # seeded from the camera limit, calibrated or not
+    assert camera.predicted_readout_time > 0
+    camera.calibrateTiming()
+    predicted = camera.predicted_max_fps
+
+    start = time.time()
+    assert _acquire(device, nb_frames, expo_time)
+    measured = nb_frames / (time.time() - start)
+    print(" predicted {:.1f} fps, measured {:.1f} fps".format(predicted, measured))
+
+    # what-if: a quarter of the rows reads out faster
+    full = camera.predictTiming([expo_time, 0, 0, 0, 0, 1, 1, 8])
+    width, height = device.image_roi[2], device.image_roi[3]
+    quarter = camera.predictTiming([expo_time, 0, 0, width, height // 4, 1, 1, 8])
+    assert quarter[3] < full[3]
+    assert measured <= predicted * 1.1
+
+
+def test_sdk_buffers(device, camera):
+    """ checks the SDK queue follows the burst time and reports its occupancy"""
+
+    nb_frames, expo_time = 500, 0.0001
+    device.acq_mode = "SINGLE"
+    device.acq_trigger_mode = "INTERNAL_TRIGGER"
+    device.acq_nb_frames = nb_frames
+    device.acq_expo_time = expo_time
+    camera.sdk_burst_time = 0.2
+    device.prepareAcq()
+    short_queue = camera.sdk_queue_size
+    camera.sdk_burst_time = 1.0
+    device.prepareAcq()
+    assert camera.sdk_queue_size >= short_queue
+    print(" queue {} frames, buffer {} MiB, transport {} B".format(
+        camera.sdk_queue_size, camera.sdk_acq_buffer_size, camera.sdk_transport_buffer_size))
+
+    device.startAcq()
+    start_wait = time.time()
+    while str(device.acq_status).lower() != "ready":
+        assert camera.sdk_queue_occupancy <= camera.sdk_queue_size
+        assert time.time() - start_wait < 10
+        time.sleep(0.01)
+    print(" queue high water: {} frames".format(camera.sdk_queue_high_water))
+
+    camera.sdk_queue_size_override = 16
+    try:
+        device.prepareAcq()
+        assert camera.sdk_queue_size == 16
+    finally:
+        camera.sdk_queue_size_override = 0
+        camera.sdk_burst_time = 0.5
+
+
+def test_buffer_first_pass(device, camera):
+    """ compares the first pass over fresh frame buffers with and without
+    hugepages and prefaulting"""
+
+    nb_frames, expo_time = 400, 0.0001
+    device.acq_mode = "SINGLE"
+    device.acq_trigger_mode = "INTERNAL_TRIGGER"
+    device.acq_expo_time = expo_time
+    try:
+        # a new number of frames gives new buffers, every frame hits fresh pages
+        for i, prefault in enumerate((False, True)):
+            camera.buffer_huge_pages = prefault
+            camera.buffer_prefault = prefault
+            device.acq_nb_frames = nb_frames + i
+            device.prepareAcq()
+            prefault_time = camera.buffer_prefault_time
+            device.startAcq()
+            start_wait = time.time()
+            while str(device.acq_status).lower() != "ready":
+                assert time.time() - start_wait < 10
+                time.sleep(0.005)
+            fps = (nb_frames + i) / (time.time() - start_wait)
+            print(" {}: prefault {:.3f} s, {:.0f} fps, queue high water {} frames, skipped {} frames".format(
+                camera.buffer_pages, prefault_time, fps, camera.sdk_queue_high_water,
+                _get_counter(camera, "SKIPPED_FRAMES_API")))
+            assert device.last_image_ready == nb_frames + i - 1
+            assert math.isfinite(fps) and fps > 0
+            if prefault:
+                assert math.isfinite(prefault_time) and prefault_time > 0
+    finally:
+        camera.buffer_huge_pages = False
+        camera.buffer_prefault = False
+
+
+def test_numa_placement(device, camera):
+    """ checks buffers and acquisition thread follow a forced NUMA node"""
+
+    print(" {} node(s), camera on node {}".format(camera.numa_nb_nodes, camera.numa_device_node))
+    node = camera.numa_nb_nodes - 1
+    camera.numa_node = node
+    try:
+        camera.buffer_prefault = True
+        assert _acquire(device, 10, 0.001)
+        print(" buffers on node {}, acquisition thread on node {}".format(
+            camera.numa_buffer_node, camera.numa_acq_thread_node))
+        assert camera.numa_placement_node == node
+        assert camera.numa_acq_thread_node == node
+        assert camera.numa_buffer_node == node
+    finally:
+        camera.numa_node = -1
+        camera.buffer_prefault = False
+
+
+def test_live_param_update(device, camera):
+    """ checks exposure changes are applied during a continuous acquisition"""
+
+    device.acq_mode = "SINGLE"
+    device.acq_trigger_mode = "INTERNAL_TRIGGER"
+    device.acq_nb_frames = 0
+    device.acq_expo_time = 0.001
+    device.prepareAcq()
+    device.startAcq()
+    try:
+        time.sleep(0.2)
+        camera.exp_time = 0.002
+        changed = time.time()
+        while abs(camera.last_frame_exp_time - 0.002) > 1e-5:
+            assert time.time() - changed < 1
+            time.sleep(0.005)
+        print(" exposure in effect after {:.3f} s".format(time.time() - changed))
+
+        last = device.last_image_ready
+        print(" frame {}: exposure {} s, gain {} dB".format(last, *camera.getFrameParams(last)))
+        assert abs(camera.getFrameParams(last)[0] - 0.002) < 1e-5
+    finally:
+        device.stopAcq()
+        camera.exp_time = 0.001
+
+
+def test_frame_metadata(device, camera, tmp_path):
+    """ checks per-frame metadata is kept and written to the sidecar"""
+
+    nb_frames = 10
+    path = tmp_path / "metadata.npy"
+    camera.metadata_sidecar_path = str(path)
+    camera.metadata_sidecar_format = "NPY"
+    try:
+        assert _acquire(device, nb_frames, 0.001)
+        m = camera.getFrameMetadata(nb_frames - 1)
+        print(" last frame: camera frame {}, timestamp {}.{:06d}, exposure {} us".format(
+            int(m[4]), int(m[5]), int(m[6]), int(m[7])))
+        assert m[2] == nb_frames - 1
+        assert abs(m[7] - 1000) < 10
+        # 1024 bytes .npy header then 80 byte records, closed when the
+        # acquisition thread ends
+        first = camera.metadata_sidecar_file
+        assert first == str(tmp_path / "metadata_0000.npy")
+        start_wait = time.time()
+        while os.path.getsize(first) != 1024 + nb_frames * 80:
+            assert time.time() - start_wait < 1
+            time.sleep(0.01)
+        # the next acquisition does not overwrite it
+        assert _acquire(device, nb_frames, 0.001)
+        assert camera.metadata_sidecar_file != first
+        assert os.path.getsize(first) == 1024 + nb_frames * 80
+    finally:
+        camera.metadata_sidecar_path = ""
+
+
+def test_sensor_monitor(device, camera):
+    """ checks temperature reads are served by the monitor, even while acquiring"""
+
+    camera.monitor_rate = 10
+    camera.monitor_history_size = 20
+    camera.monitor_enabled = True
+    time.sleep(0.5)
+
+    start = time.time()
+    for i in range(100):
+        camera.temp_sensor
+    print(" temperature read: {:.3f} ms".format((time.time() - start) * 10))
+
+    device.acq_nb_frames = 0
+    device.acq_expo_time = 0.001
+    device.prepareAcq()
+    device.startAcq()
+    try:
+        time.sleep(0.5)
+        assert camera.acq_status
+        assert camera.temp_sensor > 0
+    finally:
+        device.stopAcq()
+
+    time.sleep(2.2)
+    history = camera.monitor_history
+    print(" {} samples, last at {:.1f} *C".format(len(history), history[-1][5]))
+    assert len(history) == 20
+    assert history[-1][0] > history[0][0]
+
+
+def test_event_storm(device, camera):
+    """ checks a timeout storm is merged and rate limited instead of flooding"""
+
+    camera.event_max_rate = 5
+    camera.event_coalesce_time = 0.2
+    timeout = camera.timeout
+    delivered = camera.events_delivered
+    coalesced = camera.events_coalesced
+    suppressed = camera.events_suppressed
+
+    # nothing on the trigger input: every read times out
+    camera.timeout = 1
+    device.acq_trigger_mode = "EXTERNAL_TRIGGER"
+    device.acq_nb_frames = 1
+    device.acq_expo_time = 0.001
+    device.prepareAcq()
+    device.startAcq()
+    try:
+        time.sleep(2)
+    finally:
+        device.stopAcq()
+        device.acq_trigger_mode = "INTERNAL_TRIGGER"
+        camera.timeout = timeout
+    time.sleep(0.5)
+
+    merged = camera.events_coalesced - coalesced
+    reported = camera.events_delivered - delivered
+    print(" {} events reported, {} merged, {} suppressed, {} lost".format(
+        reported, merged, camera.events_suppressed - suppressed, camera.events_lost))
+    assert merged > 100
+    # one per coalesce period at most, plus the summary
+    assert reported <= 2.5 / 0.2 + 1
+
+
+def test_snapshot_reads(device, camera):
+    """ checks a full attribute panel read is served by one snapshot"""
+
+    names = ["gpi_mode", "gpo_mode", "led_mode", "gain_selector", "gain", "thermometer",
+             "downsampling", "image_format", "horizontal_flip", "vertical_flip",
+             "binning_engine", "decimation_engine", "counter_selector", "acq_timing_mode",
+             "trigger_delay", "bandwidth_limit", "bandwidth_limit_enabled", "frame_rate"]
+
+    def panel_read(max_age):
+        camera.snapshot_max_age = max_age
+        start = time.time()
+        for i in range(10):
+            camera.read_attributes(names)
+        return (time.time() - start) / 10
+
+    direct = panel_read(0)
+    cached = panel_read(1)
+    print(" panel read: {:.1f} ms direct, {:.1f} ms from snapshot ({:.1f} ms to take it)".format(
+        direct * 1e3, cached * 1e3, camera.snapshot_read_time * 1e3))
+    assert cached < direct
+
+    # writes make the snapshot stale
+    flip = camera.horizontal_flip
+    camera.horizontal_flip = not flip
+    try:
+        assert camera.horizontal_flip == (not flip)
+    finally:
+        camera.horizontal_flip = flip
+        camera.snapshot_max_age = 0.5
+
+
+def test_profiles(device, camera, tmp_path):
+    """ checks loading a profile writes only the settings that differ"""
+
+    camera.profile_dir = str(tmp_path)
+    flip = camera.horizontal_flip
+    camera.saveProfile("base")
+    camera.horizontal_flip = not flip
+    camera.saveProfile("flipped")
+    assert list(camera.getProfileList()) == ["base", "flipped"]
+
+    try:
+        camera.loadProfile("base")
+        print(" switch: {} settings in {:.1f} ms".format(
+            camera.profile_nb_writes, camera.profile_switch_time * 1e3))
+        assert camera.profile_nb_writes == 1
+        assert camera.horizontal_flip == flip
+
+        camera.loadProfile("base")
+        assert camera.profile_nb_writes == 0
+        assert camera.profile_name == "base"
+    finally:
+        camera.horizontal_flip = flip
+
+
+def test_clock_sync(device, camera):
+    """ checks camera timestamps are converted to host time"""
+
+    assert not camera.clock_sync_enabled
+    camera.clock_sync_enabled = True
+    try:
+        camera.syncClock()
+        time.sleep(0.5)
+        camera.syncClock()
+        print(" {} pairs, drift {:.1f} ppm, error {:.1f} us".format(
+            camera.clock_sync_nb_samples, camera.clock_sync_drift, camera.clock_sync_error * 1e6))
+        assert camera.clock_sync_nb_samples >= 2
+        assert camera.clock_sync_error < 0.001
+
+        # camera exposure timestamps, on the host clock, precede the arrival
+        nb_frames = 10
+        camera.metadata_sidecar_path = ""
+        assert _acquire(device, nb_frames, 0.01)
+        # still on: the frame stamps follow the clock that was paired
+        assert camera.clock_sync_enabled
+        m = camera.getFrameMetadata(nb_frames - 1)
+        host = camera.clock_sync_offset + (m[5] + m[6] * 1e-6) * (1 + camera.clock_sync_drift * 1e-6)
+        print(" last frame exposed {:.3f} ms before arrival".format((m[0] - host) * 1e3))
+        assert 0 < m[0] - host < 0.1
+    finally:
+        camera.clock_sync_enabled = False
+
+
+def test_trigger_diag(device, camera):
+    """ checks trigger latency and jitter are measured, needs pulses on the trigger input"""
+
+    camera.trigger_diag_enabled = True
+    camera.clock_sync_enabled = True
+    device.acq_trigger_mode = "EXTERNAL_TRIGGER_MULTI"
+    device.acq_nb_frames = 0
+    device.acq_expo_time = 0.001
+    device.prepareAcq()
+    device.startAcq()
+    try:
+        time.sleep(3)
+    finally:
+        device.stopAcq()
+        device.acq_trigger_mode = "INTERNAL_TRIGGER"
+        camera.trigger_diag_enabled = False
+        camera.clock_sync_enabled = False
+
+    nb_frames = camera.trigger_diag_nb_frames
+    if not nb_frames:
+        pytest.skip("no trigger on the input")
+    print(" {} frames, latency {:.1f} us (jitter {:.1f} us, p99 {:.1f} us), {} missed (overlap)".format(
+        nb_frames, camera.trigger_latency_mean * 1e6, camera.trigger_latency_jitter * 1e6,
+        camera.trigger_latency_p99 * 1e6, camera.trigger_missed_overlap))
+    # the frame cannot reach the host before the end of its exposure
+    assert camera.trigger_readout_mean > 0
+    assert camera.trigger_latency_min <= camera.trigger_latency_mean <= camera.trigger_latency_max
+    assert 0 < sum(camera.trigger_latency_histogram) <= nb_frames
+
+
+def test_trigger_overlap(device, camera):
+    """ checks overlap raises the triggered rate and a too short period is refused"""
+
+    device.acq_trigger_mode = "EXTERNAL_TRIGGER_MULTI"
+    device.acq_expo_time = 0.001
+    try:
+        camera.calibrateTiming()
+        camera.trigger_overlap = "OFF"
+        rate_off = camera.max_trigger_rate
+        camera.trigger_overlap = "READ_OUT"
+        # read back from the camera
+        assert camera.trigger_overlap == "READ_OUT"
+        rate_overlap = camera.max_trigger_rate
+        print(" max triggered rate {:.1f} Hz, {:.1f} Hz with overlap".format(rate_off, rate_overlap))
+        assert rate_overlap >= rate_off
+
+        camera.trigger_period = 0.5 / rate_overlap
+        with pytest.raises(PyTango.DevFailed):
+            device.prepareAcq()
+        camera.trigger_period = 1.1 / rate_overlap
+        device.prepareAcq()
+    finally:
+        camera.trigger_period = 0
+        camera.trigger_overlap = "OFF"
+        device.acq_trigger_mode = "INTERNAL_TRIGGER"
+
+
+def test_exposure_sequence(device, camera):
+    """ checks an exposure sweep is applied frame by frame within one acquisition"""
+
+    sequence = [0.001, 0.01, 0.1]
+    nb_repeats = 3
+    camera.sequence_exp_times = sequence
+    try:
+        assert _acquire(device, len(sequence) * nb_repeats, 0.001)
+    finally:
+        camera.sequence_exp_times = []
+
+    for frame_nb in range(len(sequence) * nb_repeats):
+        m = camera.getFrameMetadata(frame_nb)
+        step = int(m[17])
+        assert step == frame_nb % len(sequence)
+        assert abs(m[7] * 1e-6 - sequence[step]) <= 0.01 * sequence[step]
+    assert camera.sequence_mismatches == 0
+    # exposure restored afterwards
+    assert abs(device.acq_expo_time - 0.001) < 1e-5